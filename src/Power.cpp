@@ -569,6 +569,7 @@ Power::Power() : OSThread("Power")
 {
     statusHandler = {};
     low_voltage_counter = 0;
+    slackMsec = 5 * 1000; // The battery is read every 20 seconds, a bit later doesn't matter
 #ifdef DEBUG_HEAP
     lastheap = memGet.getFreeHeap();
 #endif
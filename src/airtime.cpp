@@ -1,6 +1,7 @@
 #include "airtime.h"
 #include "NodeDB.h"
 #include "configuration.h"
+#include "mesh/Metrics.h"
 
 AirTime *airTime = NULL;
 
@@ -157,7 +158,16 @@ uint8_t AirTime::getSilentMinutes(float txPercent, float dutyCycle)
     return MINUTES_IN_HOUR;
 }
 
-AirTime::AirTime() : concurrency::OSThread("AirTime"), airtimes({}) {}
+AirTime::AirTime() : concurrency::OSThread("AirTime"), airtimes({})
+{
+    slackMsec = 500; // Only rotates periods that are much longer than this
+#if HAS_METRICS
+    metrics.addGauge("meshtastic_channel_utilization_percent", "Channel utilization (RX, TX and noise) of the last minute",
+                     []() -> float { return airTime ? airTime->channelUtilizationPercent() : 0; });
+    metrics.addGauge("meshtastic_air_util_tx_percent", "TX airtime of the last hour",
+                     []() -> float { return airTime ? airTime->utilizationTXPercent() : 0; });
+#endif
+}
 
 int32_t AirTime::runOnce()
 {
@@ -2,6 +2,11 @@
 
 #include "../freertosinc.h"
 
+#ifdef ARCH_PORTDUINO
+#include <condition_variable>
+#include <mutex>
+#endif
+
 namespace concurrency
 {
 
@@ -10,6 +15,12 @@ namespace concurrency
 class BinarySemaphorePosix
 {
     // SemaphoreHandle_t semaphore;
+#ifdef ARCH_PORTDUINO
+    // Other threads (web server, UDP, GPIO interrupts) give to wake up the main loop
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool given = false;
+#endif
 
   public:
     BinarySemaphorePosix();
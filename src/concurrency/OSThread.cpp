@@ -1,7 +1,15 @@
 #include "OSThread.h"
 #include "configuration.h"
 #include "memGet.h"
+#include <algorithm>
 #include <assert.h>
+#if HAS_THREAD_PROFILER
+#include "Throttle.h"
+#include "concurrency/ThreadTrace.h"
+#endif
+
+#define THREAD_PROFILE_LOG_INTERVAL_MSEC (15 * 60 * 1000) // How often HAS_THREAD_PROFILER dumps the profile to the log
+#define THREAD_PROFILE_LOG_THREADS 10                     // Only the threads that used the most CPU are logged
 
 namespace concurrency
 {
@@ -17,6 +25,10 @@ bool OSThread::showWaiting = false;
 
 const OSThread *OSThread::currentThread;
 
+std::vector<OSThread *> OSThread::mainThreads;
+
+OSThread *OSThread::nextWaker;
+
 ThreadController mainController, timerController;
 InterruptableDelay mainDelay;
 
@@ -37,12 +49,17 @@ OSThread::OSThread(const char *_name, uint32_t period, ThreadController *_contro
         bool added = controller->add(this);
         assert(added);
     }
+    if (controller == &mainController)
+        mainThreads.push_back(this);
 }
 
 OSThread::~OSThread()
 {
     if (controller)
         controller->remove(this);
+    mainThreads.erase(std::remove(mainThreads.begin(), mainThreads.end(), this), mainThreads.end());
+    if (nextWaker == this)
+        nextWaker = NULL;
 }
 
 /**
@@ -57,6 +74,54 @@ void OSThread::setIntervalFromNow(unsigned long _interval)
     _cached_next_run = millis() + interval;
 }
 
+long OSThread::coalesceDelay(long delayMsec)
+{
+    unsigned long now = millis();
+    OSThread *waker = NULL;
+    int64_t latest = INT32_MAX;
+    for (OSThread *thread : mainThreads) {
+        if (!thread->enabled)
+            continue;
+        int32_t due = (int32_t)(thread->_cached_next_run - now);
+        int64_t threadLatest = (int64_t)(due > 0 ? due : 0) + thread->slackMsec;
+        if (threadLatest < latest) {
+            latest = threadLatest;
+            waker = thread;
+        }
+    }
+    // Only a sleep that ends when the waker is due is one it is responsible for
+    nextWaker = (latest > 0 && latest >= delayMsec) ? waker : NULL;
+    return latest > delayMsec ? (long)latest : delayMsec;
+}
+
+void OSThread::sleptFullDelay()
+{
+#if HAS_THREAD_PROFILER
+    if (nextWaker)
+        nextWaker->wakeups++;
+#endif
+    nextWaker = NULL;
+}
+
+#if HAS_THREAD_PROFILER
+void OSThread::logProfile()
+{
+    std::vector<OSThread *> threads = mainThreads;
+    std::sort(threads.begin(), threads.end(), [](const OSThread *a, const OSThread *b) { return a->runMicros > b->runMicros; });
+    if (threads.size() > THREAD_PROFILE_LOG_THREADS)
+        threads.resize(THREAD_PROFILE_LOG_THREADS);
+
+    LOG_INFO("Thread profile after %u s:", millis() / 1000);
+    for (const OSThread *thread : threads) {
+        if (thread->runCount == 0)
+            continue;
+        LOG_INFO("  %s: runs=%u cpu=%ums max=%ums late avg=%ums max=%ums wakeups=%u", thread->ThreadName.c_str(),
+                 thread->runCount, (uint32_t)(thread->runMicros / 1000), thread->maxRunMicros / 1000,
+                 thread->lateMsec / thread->runCount, thread->maxLateMsec, thread->wakeups);
+    }
+}
+#endif
+
 bool OSThread::shouldRun(unsigned long time)
 {
     bool r = Thread::shouldRun(time);
@@ -82,7 +147,39 @@ void OSThread::run()
     auto heap = memGet.getFreeHeap();
 #endif
     currentThread = this;
+#if HAS_THREAD_PROFILER
+    int32_t late = (int32_t)(millis() - _cached_next_run);
+    if (late > 0) {
+        lateMsec += late;
+        if ((uint32_t)late > maxLateMsec)
+            maxLateMsec = late;
+    }
+#endif
+    uint32_t start = micros();
     auto newDelay = runOnce();
+    uint32_t elapsed = micros() - start;
+    runMicros += elapsed;
+    runCount++;
+#if HAS_THREAD_PROFILER
+    if (elapsed > maxRunMicros)
+        maxRunMicros = elapsed;
+#if ARCH_PORTDUINO
+    if (threadTrace.isOpen()) {
+        // Timestamps in usec, micros() wraps after 71 minutes
+        static uint64_t wraps = 0;
+        static uint32_t lastStart = 0;
+        if (start < lastStart)
+            wraps += 1ULL << 32;
+        lastStart = start;
+        threadTrace.add(ThreadName.c_str(), wraps + start, elapsed);
+    }
+#endif
+    static uint32_t lastLog = 0;
+    if (lastLog == 0 || !Throttle::isWithinTimespanMs(lastLog, THREAD_PROFILE_LOG_INTERVAL_MSEC)) {
+        lastLog = millis();
+        logProfile();
+    }
+#endif
 #ifdef DEBUG_HEAP
     auto newHeap = memGet.getFreeHeap();
     if (newHeap < heap)
@@ -2,6 +2,7 @@
 
 #include <cstdlib>
 #include <stdint.h>
+#include <vector>
 
 #include "Thread.h"
 #include "ThreadController.h"
@@ -32,6 +33,12 @@ class OSThread : public Thread
 {
     ThreadController *controller;
 
+    /// The threads of mainController, for coalesceDelay()
+    static std::vector<OSThread *> mainThreads;
+
+    /// The thread the last delay from coalesceDelay() was timed for, if any
+    static OSThread *nextWaker;
+
     /// Show debugging info for disabled threads
     static bool showDisabled;
 
@@ -45,6 +52,25 @@ class OSThread : public Thread
     /// For debug printing only (might be null)
     static const OSThread *currentThread;
 
+    /// Times runOnce() was called, and the time spent in it
+    uint32_t runCount = 0;
+    uint64_t runMicros = 0;
+
+    // HAS_THREAD_PROFILER changes the layout of every thread, so it is a build flag rather than set in architecture.h,
+    // which can't be included here
+#if HAS_THREAD_PROFILER
+    /// Times the main loop slept until this thread was due, see sleptFullDelay()
+    uint32_t wakeups = 0;
+
+    /// Longest runOnce(), and how late runs started compared to when the thread was due
+    uint32_t maxRunMicros = 0;
+    uint32_t lateMsec = 0;
+    uint32_t maxLateMsec = 0;
+
+    /// Dump the profile of the threads of mainController to the log, the ones that used the most CPU first
+    static void logProfile();
+#endif
+
     OSThread(const char *name, uint32_t period = 0, ThreadController *controller = &mainController);
 
     virtual ~OSThread();
@@ -60,6 +86,20 @@ class OSThread : public Thread
      */
     void setIntervalFromNow(unsigned long _interval);
 
+    /**
+     * How long the main loop may sleep, given the delay from mainController.runOrDelay() until the next thread is due.
+     *
+     * Threads with slackMsec may run that much late, so that a thread that is due soon can wait for another one to wake
+     * the CPU instead of waking it by itself. No thread ever runs early.
+     */
+    static long coalesceDelay(long delayMsec);
+
+    /**
+     * Call when the main loop slept all of the delay from coalesceDelay(), without being interrupted, to count a wakeup
+     * for the thread the delay was timed for
+     */
+    static void sleptFullDelay();
+
   protected:
     /**
      * The method that will be called each time our thread gets a chance to run
@@ -69,6 +109,9 @@ class OSThread : public Thread
     virtual int32_t runOnce() = 0;
     bool sleepOnNextExecution = false;
 
+    /// How many msecs late this thread can run without harm, set for periodic work that is not time critical
+    uint32_t slackMsec = 0;
+
     // Do not override this
     virtual void run();
 };
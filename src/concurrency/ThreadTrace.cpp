@@ -0,0 +1,51 @@
+#include "ThreadTrace.h"
+
+#if HAS_THREAD_PROFILER && defined(ARCH_PORTDUINO)
+#include <cstdio>
+
+namespace concurrency
+{
+
+ThreadTrace threadTrace;
+
+bool ThreadTrace::open(const std::string &_path, uint64_t _maxBytes)
+{
+    path = _path;
+    maxBytes = _maxBytes;
+    return start();
+}
+
+bool ThreadTrace::start()
+{
+    file.open(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+        return false;
+    file << "[\n";
+    events = 0;
+    return true;
+}
+
+void ThreadTrace::add(const char *name, uint64_t startMicros, uint32_t durationMicros)
+{
+    if (!file.is_open())
+        return;
+    // The separator goes before an event, so that the array can be terminated after any of them
+    file << (events++ ? ",\n" : "") << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"ts\":" << startMicros
+         << ",\"dur\":" << durationMicros << ",\"pid\":1,\"tid\":1}";
+    if ((uint64_t)file.tellp() >= maxBytes) {
+        close();
+        std::rename(path.c_str(), (path + ".1").c_str());
+        start();
+    }
+}
+
+void ThreadTrace::close()
+{
+    if (!file.is_open())
+        return;
+    file << "\n]\n";
+    file.close();
+}
+
+} // namespace concurrency
+#endif
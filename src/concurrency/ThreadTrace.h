@@ -0,0 +1,44 @@
+#pragma once
+
+#include "configuration.h"
+
+#if HAS_THREAD_PROFILER && defined(ARCH_PORTDUINO)
+#include <fstream>
+#include <string>
+
+#define THREAD_TRACE_MAX_BYTES (64 * 1024 * 1024) // Size at which the thread trace file is rotated
+
+namespace concurrency
+{
+
+/**
+ * Writes every thread run to a file in the Chrome trace event format, to open in chrome://tracing or ui.perfetto.dev
+ *
+ * Once the file reaches maxBytes it is closed and renamed to <path>.1, replacing the one before, and a new file is started,
+ * so the trace never takes more than about twice maxBytes. Every closed file is a complete JSON array.
+ */
+class ThreadTrace
+{
+  public:
+    bool open(const std::string &path, uint64_t maxBytes = THREAD_TRACE_MAX_BYTES);
+
+    bool isOpen() const { return file.is_open(); }
+
+    void add(const char *name, uint64_t startMicros, uint32_t durationMicros);
+
+    /// Terminate the array and close the file, must be called before exit for the file to be valid JSON
+    void close();
+
+  private:
+    std::ofstream file;
+    std::string path;
+    uint64_t maxBytes = 0;
+    uint32_t events = 0; // in the current file
+
+    bool start();
+};
+
+extern ThreadTrace threadTrace;
+
+} // namespace concurrency
+#endif
@@ -344,6 +344,30 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef HAS_BLUETOOTH
 #define HAS_BLUETOOTH 0
 #endif
+#ifndef HAS_PACKET_TRACE
+#define HAS_PACKET_TRACE 0
+#endif
+#ifndef HAS_METRICS
+#define HAS_METRICS 0
+#endif
+#ifndef HAS_PHONEAPI_CACHE
+#define HAS_PHONEAPI_CACHE 0
+#endif
+#ifndef HAS_THREAD_PROFILER
+#define HAS_THREAD_PROFILER 0
+#endif
+#ifndef HAS_MEMORY_STATS
+#define HAS_MEMORY_STATS 0
+#endif
+#ifndef HAS_TELEMETRY_HISTORY
+#define HAS_TELEMETRY_HISTORY 0
+#endif
+#ifndef PKI_SHARED_KEY_CACHE
+#define PKI_SHARED_KEY_CACHE 0 // PKI shared secrets CryptoEngine caches by remote public key, 72 bytes each
+#endif
+#ifndef TELEMETRY_HISTORY_BYTES
+#define TELEMETRY_HISTORY_BYTES (16 * 1024) // Memory ceiling of the telemetry history, platforms with more RAM raise it
+#endif
 
 #ifndef HW_VENDOR
 #error HW_VENDOR must be defined
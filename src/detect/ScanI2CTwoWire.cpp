@@ -2,6 +2,7 @@
 
 #if !MESHTASTIC_EXCLUDE_I2C
 
+#include "SafeFile.h"
 #include "concurrency/LockGuard.h"
 #if defined(ARCH_PORTDUINO)
 #include "linux/LinuxHardwareI2C.h"
@@ -157,20 +158,7 @@ void ScanI2CTwoWire::scanPort(I2CPort port, uint8_t *address, uint8_t asize)
                 continue;
             LOG_DEBUG("Scan address 0x%x", (uint8_t)addr.address);
         }
-        i2cBus->beginTransmission(addr.address);
-#ifdef ARCH_PORTDUINO
-        err = 2;
-        if ((addr.address >= 0x30 && addr.address <= 0x37) || (addr.address >= 0x50 && addr.address <= 0x5F)) {
-            if (i2cBus->read() != -1)
-                err = 0;
-        } else {
-            err = i2cBus->writeQuick((uint8_t)0);
-        }
-        if (err != 0)
-            err = 2;
-#else
-        err = i2cBus->endTransmission();
-#endif
+        err = probePresence(i2cBus, addr.address);
         type = NONE;
         if (err == 0) {
             switch (addr.address) {
@@ -527,6 +515,8 @@ void ScanI2CTwoWire::scanPort(I2CPort port, uint8_t *address, uint8_t asize)
             deviceAddresses[type] = addr;
             foundDevices[addr] = type;
         }
+        if (err == 0)
+            presentDevices[addr] = type;
     }
 }
 
@@ -535,6 +525,182 @@ void ScanI2CTwoWire::scanPort(I2CPort port)
     scanPort(port, nullptr, 0);
 }
 
+void ScanI2CTwoWire::scanPortCached(I2CPort port)
+{
+    if (!cacheValid) {
+        scanPort(port);
+        return;
+    }
+
+    uint8_t addresses[120];
+    uint8_t count = 0;
+    for (auto &device : cachedDevices) {
+        if (device.first.port == port)
+            addresses[count++] = device.first.address;
+    }
+
+    // Presence only, so a device plugged in since the last boot still triggers a full scan
+    TwoWire *i2cBus = fetchI2CBus(DeviceAddress(port, 0));
+    bool same = true;
+    {
+        concurrency::LockGuard guard((concurrency::Lock *)&lock);
+        for (uint8_t address = 8; address < 120 && same; address++) {
+            if ((probePresence(i2cBus, address) == 0) != in_array(addresses, count, address)) {
+                LOG_INFO("I2C device at 0x%x appeared or disappeared", address);
+                same = false;
+            }
+        }
+    }
+
+    if (same && count > 0) {
+        scanPort(port, addresses, count);
+        for (auto &device : cachedDevices) {
+            if (device.first.port != port)
+                continue;
+            auto found = presentDevices.find(device.first);
+            if (found == presentDevices.end() || found->second != device.second) {
+                LOG_INFO("I2C device at 0x%x changed", device.first.address);
+                same = false;
+            }
+        }
+    }
+
+    if (same) {
+        LOG_DEBUG("I2C devices on port %d match the cache", port);
+    } else {
+        scanPort(port);
+    }
+}
+
+#ifdef FSCom
+#define I2C_CACHE_FILE "/prefs/i2c.dat"
+#define I2C_CACHE_MAGIC 0x49324331 // "I2C1"
+
+static bool sameDevices(const std::map<ScanI2C::DeviceAddress, ScanI2C::DeviceType> &a,
+                        const std::map<ScanI2C::DeviceAddress, ScanI2C::DeviceType> &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (auto i = a.begin(), j = b.begin(); i != a.end(); ++i, ++j) {
+        if (i->first.port != j->first.port || i->first.address != j->first.address || i->second != j->second)
+            return false;
+    }
+    return true;
+}
+
+/*
+ * File layout: magic, firmware version (nul terminated), count, then port, address and type for each device. Devices we
+ * identify can change with the firmware, so any other version is ignored.
+ */
+bool ScanI2CTwoWire::loadCache()
+{
+    concurrency::LockGuard g(spiLock);
+    cachedDevices.clear();
+    cacheValid = false;
+
+    auto f = FSCom.open(I2C_CACHE_FILE, FILE_O_READ);
+    if (!f)
+        return false;
+
+    uint32_t magic = 0;
+    char version[33] = {0};
+    uint8_t count = 0;
+    bool ok = f.read((uint8_t *)&magic, sizeof(magic)) == sizeof(magic) && magic == I2C_CACHE_MAGIC;
+    for (size_t i = 0; ok && i < sizeof(version) - 1; i++) {
+        ok = f.read((uint8_t *)&version[i], 1) == 1;
+        if (version[i] == 0)
+            break;
+    }
+    ok = ok && strcmp(version, optstr(APP_VERSION)) == 0 && f.read(&count, 1) == 1;
+    for (uint8_t i = 0; ok && i < count; i++) {
+        uint8_t entry[3];
+        ok = f.read(entry, sizeof(entry)) == sizeof(entry) && entry[0] != NO_I2C && entry[0] <= WIRE1;
+        if (ok)
+            cachedDevices[DeviceAddress((I2CPort)entry[0], entry[1])] = (DeviceType)entry[2];
+    }
+    f.close();
+
+    if (!ok) {
+        LOG_INFO("Ignore I2C device cache");
+        cachedDevices.clear();
+        return false;
+    }
+    cacheValid = true;
+    return true;
+}
+
+bool ScanI2CTwoWire::saveCache()
+{
+    if (cacheValid && sameDevices(presentDevices, cachedDevices))
+        return false;
+
+    LOG_INFO("Save %u I2C devices to cache", (uint32_t)presentDevices.size());
+    spiLock->lock();
+    FSCom.mkdir("/prefs");
+    spiLock->unlock();
+    SafeFile f(I2C_CACHE_FILE);
+    uint32_t magic = I2C_CACHE_MAGIC;
+    f.write((uint8_t *)&magic, sizeof(magic));
+    f.write((const uint8_t *)optstr(APP_VERSION), strlen(optstr(APP_VERSION)) + 1);
+    f.write((uint8_t)presentDevices.size());
+    for (auto &device : presentDevices) {
+        uint8_t entry[3] = {(uint8_t)device.first.port, device.first.address, (uint8_t)device.second};
+        f.write(entry, sizeof(entry));
+    }
+    if (!f.close()) {
+        LOG_ERROR("Can't write %s", I2C_CACHE_FILE);
+        return false;
+    }
+    cachedDevices = presentDevices;
+    cacheValid = true;
+    return true;
+}
+
+bool ScanI2CTwoWire::clearCache()
+{
+    concurrency::LockGuard g(spiLock);
+    if (!FSCom.exists(I2C_CACHE_FILE))
+        return false;
+    LOG_INFO("Clear I2C device cache");
+    return FSCom.remove(I2C_CACHE_FILE);
+}
+#else
+bool ScanI2CTwoWire::loadCache()
+{
+    return false;
+}
+
+bool ScanI2CTwoWire::saveCache()
+{
+    return false;
+}
+
+bool ScanI2CTwoWire::clearCache()
+{
+    return false;
+}
+#endif
+
+uint8_t ScanI2CTwoWire::probePresence(TwoWire *i2cBus, uint8_t address) const
+{
+    uint8_t err;
+    i2cBus->beginTransmission(address);
+#ifdef ARCH_PORTDUINO
+    err = 2;
+    if ((address >= 0x30 && address <= 0x37) || (address >= 0x50 && address <= 0x5F)) {
+        if (i2cBus->read() != -1)
+            err = 0;
+    } else {
+        err = i2cBus->writeQuick((uint8_t)0);
+    }
+    if (err != 0)
+        err = 2;
+#else
+    err = i2cBus->endTransmission();
+#endif
+    return err;
+}
+
 TwoWire *ScanI2CTwoWire::fetchI2CBus(ScanI2C::DeviceAddress address) const
 {
     if (address.port == ScanI2C::I2CPort::WIRE) {
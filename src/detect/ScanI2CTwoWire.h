@@ -29,9 +29,27 @@ class ScanI2CTwoWire : public ScanI2C
 
     size_t countDevices() const override;
 
+    /**
+     * Like scanPort(), but using the devices found on a previous boot (see loadCache()): only the cached addresses are
+     * identified again, all others are just checked for presence. Any difference falls back to a full scanPort().
+     */
+    void scanPortCached(ScanI2C::I2CPort);
+
+    /// Load the devices found on a previous boot, returns false if there are none (or they are from another firmware)
+    bool loadCache();
+
+    /// Save what was found if it differs from the cache, returns true if the cache file was written
+    bool saveCache();
+
+    /// Delete the cache file, so the next boot identifies every device again. Returns true if there was one
+    static bool clearCache();
+
   protected:
     FoundDevice firstOfOrNONE(size_t, DeviceType[]) const override;
 
+    /// Check whether a device answers at an address, 0 if it does (the Wire error code otherwise)
+    virtual uint8_t probePresence(TwoWire *, uint8_t) const;
+
   private:
     typedef struct RegisterLocation {
         DeviceAddress i2cAddress;
@@ -51,6 +69,12 @@ class ScanI2CTwoWire : public ScanI2C
     // note: prone to overwriting if multiple devices of a type are added at different addresses (rare?)
     std::map<ScanI2C::DeviceType, ScanI2C::DeviceAddress> deviceAddresses;
 
+    // Every address that answered, including devices we could not identify (NONE), as saved to the cache
+    std::map<ScanI2C::DeviceAddress, ScanI2C::DeviceType> presentDevices;
+
+    std::map<ScanI2C::DeviceAddress, ScanI2C::DeviceType> cachedDevices;
+    bool cacheValid = false;
+
     concurrency::Lock lock;
 
     uint16_t getRegisterValue(const RegisterLocation &, ResponseWidth, bool) const;
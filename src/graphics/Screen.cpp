@@ -460,6 +460,7 @@ void Screen::handleSetOn(bool on, FrameCallback einkScreensaver)
 
 void Screen::setup()
 {
+    MemTagScope memTag(MemTag::Screen);
 
     // === Enable display rendering ===
     useDisplay = true;
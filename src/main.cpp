@@ -30,6 +30,8 @@
 #include "graphics/RAKled.h"
 #include "graphics/Screen.h"
 #include "main.h"
+#include "mesh/Metrics.h"
+#include "mesh/TelemetryHistory.h"
 #include "mesh/generated/meshtastic/config.pb.h"
 #include "meshUtils.h"
 #include "modules/Modules.h"
@@ -89,6 +91,8 @@ NRF52Bluetooth *nrf52Bluetooth = nullptr;
 
 #ifdef ARCH_PORTDUINO
 #include "linux/LinuxHardwareI2C.h"
+#include "mesh/PacketCapture.h"
+#include "mesh/api/ShmPacketAPI.h"
 #include "mesh/raspihttp/PiWebServer.h"
 #include "platform/portduino/PortduinoGlue.h"
 #include "platform/portduino/USBHal.h"
@@ -511,6 +515,13 @@ void setup()
     // We need to scan here to decide if we have a screen for nodeDB.init() and because power has been applied to
     // accessories
     auto i2cScanner = std::unique_ptr<ScanI2CTwoWire>(new ScanI2CTwoWire());
+    uint32_t i2cScanStart = millis();
+    // Devices found on the last boot are only checked again, a full scan is done if anything changed
+#ifdef ARCH_PORTDUINO
+    if (rescanI2C)
+        ScanI2CTwoWire::clearCache();
+#endif
+    i2cScanner->loadCache();
 #if HAS_WIRE
     LOG_INFO("Scan for i2c devices");
 #endif
@@ -519,30 +530,32 @@ void setup()
     Wire1.setSDA(I2C_SDA1);
     Wire1.setSCL(I2C_SCL1);
     Wire1.begin();
-    i2cScanner->scanPort(ScanI2C::I2CPort::WIRE1);
+    i2cScanner->scanPortCached(ScanI2C::I2CPort::WIRE1);
 #elif defined(I2C_SDA1) && !defined(ARCH_RP2040)
     Wire1.begin(I2C_SDA1, I2C_SCL1);
-    i2cScanner->scanPort(ScanI2C::I2CPort::WIRE1);
+    i2cScanner->scanPortCached(ScanI2C::I2CPort::WIRE1);
 #elif defined(NRF52840_XXAA) && (WIRE_INTERFACES_COUNT == 2)
-    i2cScanner->scanPort(ScanI2C::I2CPort::WIRE1);
+    i2cScanner->scanPortCached(ScanI2C::I2CPort::WIRE1);
 #endif
 
 #if defined(I2C_SDA) && defined(ARCH_RP2040)
     Wire.setSDA(I2C_SDA);
     Wire.setSCL(I2C_SCL);
     Wire.begin();
-    i2cScanner->scanPort(ScanI2C::I2CPort::WIRE);
+    i2cScanner->scanPortCached(ScanI2C::I2CPort::WIRE);
 #elif defined(I2C_SDA) && !defined(ARCH_RP2040)
     Wire.begin(I2C_SDA, I2C_SCL);
-    i2cScanner->scanPort(ScanI2C::I2CPort::WIRE);
+    i2cScanner->scanPortCached(ScanI2C::I2CPort::WIRE);
 #elif defined(ARCH_PORTDUINO)
     if (settingsStrings[i2cdev] != "") {
         LOG_INFO("Scan for i2c devices");
-        i2cScanner->scanPort(ScanI2C::I2CPort::WIRE);
+        i2cScanner->scanPortCached(ScanI2C::I2CPort::WIRE);
     }
 #elif HAS_WIRE
-    i2cScanner->scanPort(ScanI2C::I2CPort::WIRE);
+    i2cScanner->scanPortCached(ScanI2C::I2CPort::WIRE);
 #endif
+    i2cScanner->saveCache();
+    LOG_INFO("I2C scan took %u ms", millis() - i2cScanStart);
 
     auto i2cCount = i2cScanner->countDevices();
     if (i2cCount == 0) {
@@ -732,6 +745,10 @@ void setup()
     // We do this as early as possible because this loads preferences from flash
     // but we need to do this after main cpu init (esp32setup), because we need the random seed set
     nodeDB = new NodeDB;
+#ifdef ARCH_PORTDUINO
+    // Saves are debounced, whatever is still pending has to reach the disk however meshtasticd exits
+    std::atexit([] { nodeDB->flushPendingSaves(); });
+#endif
 
 #if HAS_TFT
     if (config.display.displaymode == meshtastic_Config_DisplayConfig_DisplayMode_COLOR) {
@@ -898,6 +915,7 @@ void setup()
     LOG_DEBUG("Start multicast thread");
     udpHandler = new UdpMulticastHandler();
 #ifdef ARCH_PORTDUINO
+    udpHandler->setBatchDelay(settingsMap[udp_batch_msec]);
     // FIXME: portduino does not ever call onNetworkConnected so call it here because I don't know what happen if I call
     // onNetworkConnected there
     if (config.network.enabled_protocols & meshtastic_Config_NetworkConfig_ProtocolFlags_UDP_BROADCAST) {
@@ -913,6 +931,14 @@ void setup()
         rebootAtMsec = (millis() + DEFAULT_REBOOT_SECONDS * 1000);
     }
 
+#if HAS_TELEMETRY_HISTORY
+#ifdef BOARD_HAS_PSRAM
+    // The flag is set for some boards that come without PSRAM too
+    if (memGet.getFreePsram() >= TELEMETRY_HISTORY_BYTES)
+#endif
+        telemetryHistory = new TelemetryHistory(TELEMETRY_HISTORY_BYTES);
+#endif
+
     // Now that the mesh service is created, create any modules
     setupModules();
 
@@ -1408,15 +1434,33 @@ void setup()
     }
 #endif
     initApiServer(TCPPort);
+#ifdef PORTDUINO_LINUX_HARDWARE
+    if (settingsStrings[shm_api_name] != "") {
+        ShmPacketAPI::create(settingsStrings[shm_api_name].c_str());
+        std::atexit([] { delete shmPacketAPI; });
+    }
+#endif
 #endif
 
     // Start airtime logger thread.
     airTime = new AirTime();
 
+#if HAS_METRICS
+    memGet.registerMetrics();
+    metrics.addCounter("meshtastic_prefs_file_writes_total", "Protobuf files written to flash", &nodeDB->fileWrites);
+    metrics.addCounter("meshtastic_prefs_writes_avoided_total", "Segment writes merged into a pending one",
+                       &nodeDB->writesAvoided);
+    metrics.addCounter("meshtastic_prefs_bytes_written_total", "Protobuf bytes written to flash", &nodeDB->bytesWritten);
+#endif
+
     if (!rIf)
         RECORD_CRITICALERROR(meshtastic_CriticalErrorCode_NO_RADIO);
     else {
         router->addInterface(rIf);
+        LOG_INFO("Radio ready %u ms after boot", millis());
+#if HAS_METRICS
+        rIf->registerMetrics();
+#endif
 
         // Log bit rate to debug output
         LOG_DEBUG("LoRA bitrate = %f bytes / sec", (float(meshtastic_Constants_DATA_PAYLOAD_LEN) /
@@ -1424,6 +1468,17 @@ void setup()
                                                        1000);
     }
 
+#if HAS_METRICS
+    // Everything is registered now, render it for the web server from here on
+    metricsSnapshot = new MetricsSnapshot();
+#endif
+
+#ifdef ARCH_PORTDUINO
+    // Field traffic from a capture, to reproduce routing problems and measure CPU and latency against it
+    if (replayPath)
+        packetReplay = new PacketReplay(replayPath, replaySpeed);
+#endif
+
     // This must be _after_ service.init because we need our preferences loaded from flash to have proper timeout values
     PowerFSM_setup(); // we will transition to ON in a couple of seconds, FIXME, only do this for cold boots, not waking from SDS
     powerFSMthread = new PowerFSMThread();
@@ -1546,11 +1601,12 @@ void loop()
 
     service->loop();
 
-    long delayMsec = mainController.runOrDelay();
+    long delayMsec = OSThread::coalesceDelay(mainController.runOrDelay());
 
     // We want to sleep as long as possible here - because it saves power
     if (!runASAP && loopCanSleep()) {
-        mainDelay.delay(delayMsec);
+        if (mainDelay.delay(delayMsec))
+            OSThread::sleptFullDelay();
     }
 }
 #endif
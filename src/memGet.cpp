@@ -10,6 +10,15 @@
 #include "memGet.h"
 #include "configuration.h"
 
+#if HAS_MEMORY_STATS
+#include <atomic>
+#include <cstddef>
+#include <new>
+#endif
+#if HAS_METRICS
+#include "mesh/Metrics.h"
+#endif
+
 MemGet memGet;
 
 /**
@@ -78,4 +87,258 @@ uint32_t MemGet::getPsramSize()
 #else
     return 0;
 #endif
-}
\ No newline at end of file
+}
+
+/**
+ * Returns the size of the largest block that can be allocated from the heap.
+ * @return uint32_t The largest free block in bytes, the free heap where the platform can't tell.
+ */
+uint32_t MemGet::getLargestFreeBlock()
+{
+#ifdef ARCH_ESP32
+    return ESP.getMaxAllocHeap();
+#else
+    return getFreeHeap();
+#endif
+}
+
+/**
+ * Returns how much of the free heap is unusable for large allocations.
+ * @return uint8_t The percentage of the free heap outside of the largest free block, 0 if unknown.
+ */
+uint8_t MemGet::getFragmentation()
+{
+    uint32_t freeHeap = getFreeHeap();
+    uint32_t largest = getLargestFreeBlock();
+    if (freeHeap == 0 || freeHeap == UINT32_MAX || largest >= freeHeap)
+        return 0;
+    return 100 - (uint64_t)largest * 100 / freeHeap;
+}
+
+const char *MemGet::getTagName(MemTag tag)
+{
+    switch (tag) {
+    case MemTag::Router:
+        return "router";
+    case MemTag::NodeDB:
+        return "nodedb";
+    case MemTag::MQTT:
+        return "mqtt";
+    case MemTag::Screen:
+        return "screen";
+    case MemTag::StoreForward:
+        return "storeforward";
+    default:
+        return "other";
+    }
+}
+
+#if HAS_MEMORY_STATS
+
+static std::atomic<uint32_t> tagBytes[(size_t)MemTag::Count];
+static std::atomic<uint32_t> tagObjects[(size_t)MemTag::Count];
+static thread_local MemTag currentTag = MemTag::Other;
+
+void MemGet::countAlloc(MemTag tag, size_t bytes)
+{
+    tagBytes[(size_t)tag].fetch_add(bytes, std::memory_order_relaxed);
+    tagObjects[(size_t)tag].fetch_add(1, std::memory_order_relaxed);
+}
+
+void MemGet::countFree(MemTag tag, size_t bytes)
+{
+    tagBytes[(size_t)tag].fetch_sub(bytes, std::memory_order_relaxed);
+    tagObjects[(size_t)tag].fetch_sub(1, std::memory_order_relaxed);
+}
+
+uint32_t MemGet::getTagBytes(MemTag tag)
+{
+    return tagBytes[(size_t)tag].load(std::memory_order_relaxed);
+}
+
+uint32_t MemGet::getTagObjects(MemTag tag)
+{
+    return tagObjects[(size_t)tag].load(std::memory_order_relaxed);
+}
+
+MemTagScope::MemTagScope(MemTag tag) : prev(currentTag)
+{
+    currentTag = tag;
+}
+
+MemTagScope::~MemTagScope()
+{
+    currentTag = prev;
+}
+
+// Every block of operator new carries the size and tag it was counted with, so delete can take it off again from any thread
+struct alignas(alignof(std::max_align_t)) AllocHeader {
+    size_t size;
+    MemTag tag;
+};
+
+static void *countedAlloc(size_t size)
+{
+    AllocHeader *header = (AllocHeader *)malloc(sizeof(AllocHeader) + size);
+    if (!header)
+        return NULL;
+    header->size = size;
+    header->tag = currentTag;
+    memGet.countAlloc(header->tag, size);
+    return header + 1;
+}
+
+static void *countedAllocOrThrow(size_t size)
+{
+    void *p = countedAlloc(size);
+    if (!p) {
+#if __cpp_exceptions
+        throw std::bad_alloc();
+#else
+        abort();
+#endif
+    }
+    return p;
+}
+
+static void countedFree(void *p)
+{
+    if (!p)
+        return;
+    AllocHeader *header = (AllocHeader *)p - 1;
+    memGet.countFree(header->tag, header->size);
+    free(header);
+}
+
+void *operator new(size_t size)
+{
+    return countedAllocOrThrow(size);
+}
+
+void *operator new[](size_t size)
+{
+    return countedAllocOrThrow(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAlloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAlloc(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    countedFree(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    countedFree(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    countedFree(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    countedFree(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+    countedFree(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+    countedFree(p);
+}
+
+void MemGet::logStats()
+{
+    LOG_INFO("Heap free %u of %u bytes, largest block %u bytes (%u%% fragmented)", getFreeHeap(), getHeapSize(),
+             getLargestFreeBlock(), getFragmentation());
+    for (size_t i = 0; i < (size_t)MemTag::Count; i++) {
+        if (tagObjects[i].load(std::memory_order_relaxed) > 0)
+            LOG_INFO("  %s: %u bytes in %u objects", getTagName((MemTag)i), getTagBytes((MemTag)i), getTagObjects((MemTag)i));
+    }
+}
+
+#else
+
+void MemGet::countAlloc(MemTag tag, size_t bytes) {}
+
+void MemGet::countFree(MemTag tag, size_t bytes) {}
+
+uint32_t MemGet::getTagBytes(MemTag tag)
+{
+    return 0;
+}
+
+uint32_t MemGet::getTagObjects(MemTag tag)
+{
+    return 0;
+}
+
+MemTagScope::MemTagScope(MemTag tag) {}
+
+MemTagScope::~MemTagScope() {}
+
+void MemGet::logStats()
+{
+    LOG_INFO("Heap free %u of %u bytes, largest block %u bytes (%u%% fragmented)", getFreeHeap(), getHeapSize(),
+             getLargestFreeBlock(), getFragmentation());
+}
+
+#endif
+
+#if HAS_METRICS
+
+#if HAS_MEMORY_STATS
+template <MemTag tag> static float getTagBytesMetric()
+{
+    return memGet.getTagBytes(tag);
+}
+
+template <MemTag tag> static float getTagObjectsMetric()
+{
+    return memGet.getTagObjects(tag);
+}
+
+struct TagMetric {
+    const char *labels;
+    Metrics::ValueFn bytes;
+    Metrics::ValueFn objects;
+};
+
+static const TagMetric tagMetrics[] = {
+    {"tag=\"other\"", getTagBytesMetric<MemTag::Other>, getTagObjectsMetric<MemTag::Other>},
+    {"tag=\"router\"", getTagBytesMetric<MemTag::Router>, getTagObjectsMetric<MemTag::Router>},
+    {"tag=\"nodedb\"", getTagBytesMetric<MemTag::NodeDB>, getTagObjectsMetric<MemTag::NodeDB>},
+    {"tag=\"mqtt\"", getTagBytesMetric<MemTag::MQTT>, getTagObjectsMetric<MemTag::MQTT>},
+    {"tag=\"screen\"", getTagBytesMetric<MemTag::Screen>, getTagObjectsMetric<MemTag::Screen>},
+    {"tag=\"storeforward\"", getTagBytesMetric<MemTag::StoreForward>, getTagObjectsMetric<MemTag::StoreForward>},
+};
+#endif
+
+void MemGet::registerMetrics()
+{
+    metrics.addGauge("meshtastic_heap_free_bytes", "Free heap", []() -> float { return memGet.getFreeHeap(); });
+    metrics.addGauge("meshtastic_heap_size_bytes", "Total heap", []() -> float { return memGet.getHeapSize(); });
+    metrics.addGauge("meshtastic_heap_largest_free_block_bytes", "Largest block that can be allocated",
+                     []() -> float { return memGet.getLargestFreeBlock(); });
+#if HAS_MEMORY_STATS
+    for (const TagMetric &m : tagMetrics)
+        metrics.addGauge("meshtastic_heap_tag_bytes", "Heap in use per subsystem", m.bytes, m.labels);
+    for (const TagMetric &m : tagMetrics)
+        metrics.addGauge("meshtastic_heap_tag_objects", "Live allocations per subsystem", m.objects, m.labels);
+#endif
+}
+
+#endif
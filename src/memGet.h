@@ -4,6 +4,9 @@
 
 #include <Arduino.h>
 
+/// Subsystems the allocation accounting (HAS_MEMORY_STATS) attributes memory to
+enum class MemTag : uint8_t { Other, Router, NodeDB, MQTT, Screen, StoreForward, Count };
+
 class MemGet
 {
   public:
@@ -11,8 +14,43 @@ class MemGet
     uint32_t getHeapSize();
     uint32_t getFreePsram();
     uint32_t getPsramSize();
+    uint32_t getLargestFreeBlock();
+    uint8_t getFragmentation();
+
+    /**
+     * Allocation accounting, compiled in with HAS_MEMORY_STATS and a no-op otherwise.
+     *
+     * operator new and delete are counted against the MemTagScope that is active on the allocating thread, Allocator<T>
+     * pools and direct malloc() users report their blocks themselves.
+     */
+    void countAlloc(MemTag tag, size_t bytes);
+    void countFree(MemTag tag, size_t bytes);
+    uint32_t getTagBytes(MemTag tag);
+    uint32_t getTagObjects(MemTag tag);
+    static const char *getTagName(MemTag tag);
+
+    /// Log the heap state and the bytes/objects of every tag
+    void logStats();
+
+    /// Export the heap and the per tag accounting, with HAS_METRICS
+    void registerMetrics();
 };
 
 extern MemGet memGet;
 
+/**
+ * Attributes the operator new calls of the current thread to a tag for as long as it lives, e.g.
+ *   MemTagScope memTag(MemTag::NodeDB);
+ * Scopes nest, blocks keep their tag when they are freed from somewhere else.
+ */
+class MemTagScope
+{
+  public:
+    explicit MemTagScope(MemTag tag);
+    ~MemTagScope();
+
+  private:
+    MemTag prev;
+};
+
 #endif
@@ -3,6 +3,7 @@
 #include "CryptoEngine.h"
 #include "Default.h"
 #include "DisplayFormatters.h"
+#include "MeshModule.h"
 #include "NodeDB.h"
 #include "RadioInterface.h"
 #include "configuration.h"
@@ -293,6 +294,7 @@ void Channels::onConfigChanged()
         if (ch.role == meshtastic_Channel_Role_PRIMARY)
             primaryIndex = i;
     }
+    MeshModule::onChannelsChanged();
 #if !MESHTASTIC_EXCLUDE_MQTT
     if (channels.anyMqttEnabled() && mqtt && !mqtt->isEnabled()) {
         LOG_DEBUG("MQTT is enabled on at least one channel, so set MQTT thread to run immediately");
@@ -341,6 +343,7 @@ void Channels::setChannel(const meshtastic_Channel &c)
                 channelFile.channels[i].role = meshtastic_Channel_Role_SECONDARY;
 
     old = c; // slam in the new settings/role
+    MeshModule::onChannelsChanged();
 }
 
 bool Channels::anyMqttEnabled()
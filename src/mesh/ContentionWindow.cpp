@@ -0,0 +1,91 @@
+#include "ContentionWindow.h"
+
+// Weight of a new sample in the duplicate ratio EWMA, as a shift (1/16)
+#define DUPE_EWMA_SHIFT 4
+
+ContentionWindow::ContentionWindow(uint8_t _cwMin, uint8_t _cwMax) : cwMin(_cwMin), cwMax(_cwMax)
+{
+    reset();
+}
+
+void ContentionWindow::reset()
+{
+    windowSlots = minSlots();
+    dupePermille = 0;
+    unclassifiedRx = 0;
+    stats = {};
+}
+
+uint16_t ContentionWindow::floorSlots() const
+{
+    // At most raise the floor to the middle of the range, so an idle channel can still recover quickly
+    uint32_t range = (maxSlots() - minSlots()) / 2;
+    return minSlots() + (range * dupePermille) / 1000;
+}
+
+void ContentionWindow::increase()
+{
+    uint32_t next = (uint32_t)windowSlots * 2;
+    windowSlots = next > maxSlots() ? maxSlots() : next;
+    stats.increases++;
+}
+
+void ContentionWindow::onChannelBusy()
+{
+    stats.cadBusy++;
+    increase();
+}
+
+void ContentionWindow::onChannelIdle()
+{
+    stats.cadIdle++;
+    uint16_t step = minSlots() / 2;
+    uint16_t floor = floorSlots();
+    if (windowSlots > floor) {
+        windowSlots = (windowSlots - floor > step) ? windowSlots - step : floor;
+        stats.decreases++;
+    } else {
+        // The floor may have moved up because of duplicates
+        windowSlots = floor;
+    }
+}
+
+void ContentionWindow::onReceived(bool corrupted)
+{
+    if (corrupted) {
+        stats.rxCorrupt++;
+        increase();
+    } else {
+        stats.rxGood++;
+        // Sampled as not a duplicate, onDuplicate() turns the sample around once the router knows better
+        dupePermille -= dupePermille >> DUPE_EWMA_SHIFT;
+        if (unclassifiedRx < UINT8_MAX)
+            unclassifiedRx++;
+    }
+}
+
+void ContentionWindow::onDuplicate()
+{
+    stats.rxDupe++;
+    // Replace the sample of the reception instead of adding a second one, which would keep the ratio below one half
+    if (unclassifiedRx == 0)
+        return; // Not one of our receptions, e.g. from MQTT
+    unclassifiedRx--;
+    uint32_t ratio = dupePermille + (1000 >> DUPE_EWMA_SHIFT);
+    dupePermille = ratio > 1000 ? 1000 : ratio;
+}
+
+uint8_t ContentionWindow::getCWsize() const
+{
+    uint8_t cw = cwMin;
+    while (cw < cwMax && (1 << cw) < windowSlots)
+        cw++;
+    return cw;
+}
+
+const ContentionWindow::Stats &ContentionWindow::getStats()
+{
+    stats.windowSlots = windowSlots;
+    stats.dupePermille = dupePermille;
+    return stats;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Adaptive contention window for the LoRa MAC.
+ *
+ * The default scheme maps the 6x10s averaged channel utilization linearly onto CWmin..CWmax, which reacts slowly to
+ * bursts of traffic. This controller instead tunes the window online from per-slot outcomes (AIMD):
+ *
+ *  - a busy CAD or a corrupted reception (most likely a collision) doubles the window, up to 2^CWmax slots;
+ *  - an idle CAD shrinks it additively by half of the minimum window, down to a floor;
+ *  - the floor itself is raised by the (EWMA) ratio of duplicate receptions, because a high duplicate ratio means many
+ *    neighbours contend for the same flood.
+ *
+ * The window is kept in slots, getCWsize() returns the equivalent exponent for formulas that still work on CW sizes.
+ */
+class ContentionWindow
+{
+  public:
+    struct Stats {
+        uint32_t cadBusy;      // CAD found activity on the channel
+        uint32_t cadIdle;      // CAD found the channel clear
+        uint32_t rxCorrupt;    // Received frames that failed to decode, counted as collisions
+        uint32_t rxGood;       // Received frames that decoded fine
+        uint32_t rxDupe;       // Duplicates reported by the router
+        uint32_t increases;    // Number of multiplicative increases applied
+        uint32_t decreases;    // Number of additive decreases applied
+        uint16_t windowSlots;  // Current window size in slots
+        uint16_t dupePermille; // Current EWMA duplicate ratio in 1/1000
+    };
+
+    ContentionWindow(uint8_t cwMin, uint8_t cwMax);
+
+    /** CAD outcome, called right before we would transmit */
+    void onChannelBusy();
+    void onChannelIdle();
+
+    /** Reception outcome, corrupted frames are treated as collisions */
+    void onReceived(bool corrupted);
+
+    /** The router saw a duplicate of a packet already in the history */
+    void onDuplicate();
+
+    /** Current window in slots, a random delay should be picked from [0, getWindowSlots()) */
+    uint16_t getWindowSlots() const { return windowSlots; }
+
+    /** The CW exponent closest to (and not smaller than) the current window, within CWmin..CWmax */
+    uint8_t getCWsize() const;
+
+    const Stats &getStats();
+
+    /** Go back to the initial state, e.g. after a modem config change */
+    void reset();
+
+  private:
+    const uint8_t cwMin, cwMax;
+    uint16_t windowSlots;
+
+    // EWMA of the duplicate ratio in 1/1000, updated for every reception
+    uint16_t dupePermille = 0;
+
+    // Good receptions the router hasn't reported as duplicates (yet), their samples can still be turned into one
+    uint8_t unclassifiedRx = 0;
+
+    Stats stats = {};
+
+    uint16_t minSlots() const { return 1 << cwMin; }
+    uint16_t maxSlots() const { return 1 << cwMax; }
+
+    /** Lowest window we will shrink to, raised when we see many duplicates */
+    uint16_t floorSlots() const;
+
+    void increase();
+};
@@ -33,6 +33,7 @@ void CryptoEngine::generateKeyPair(uint8_t *pubKey, uint8_t *privKey)
 
     LOG_DEBUG("Generate Curve25519 keypair");
     Curve25519::dh1(public_key, private_key);
+    clearSharedKeyCache();
     memcpy(pubKey, public_key, sizeof(public_key));
     memcpy(privKey, private_key, sizeof(private_key));
 }
@@ -54,6 +55,7 @@ bool CryptoEngine::regeneratePublicKey(uint8_t *pubKey, uint8_t *privKey)
         }
         memcpy(private_key, privKey, sizeof(private_key));
         memcpy(public_key, pubKey, sizeof(public_key));
+        clearSharedKeyCache();
     } else {
         LOG_WARN("X25519 key generation failed due to blank private key");
         return false;
@@ -65,6 +67,7 @@ void CryptoEngine::clearKeys()
 {
     memset(public_key, 0, sizeof(public_key));
     memset(private_key, 0, sizeof(private_key));
+    clearSharedKeyCache();
 }
 
 /**
@@ -92,10 +95,9 @@ bool CryptoEngine::encryptCurve25519(uint32_t toNode, uint32_t fromNode, meshtas
         LOG_DEBUG("Node %d or their public_key not found", toNode);
         return false;
     }
-    if (!crypto->setDHPublicKey(remotePublic.bytes)) {
+    if (!setSharedKey(remotePublic.bytes)) {
         return false;
     }
-    crypto->hash(shared_key, 32);
     initNonce(fromNode, packetNum, extraNonceTmp);
 
     // Calculate the shared secret with the destination node and encrypt
@@ -134,10 +136,9 @@ bool CryptoEngine::decryptCurve25519(uint32_t fromNode, meshtastic_UserLite_publ
     }
 
     // Calculate the shared secret with the sending node and decrypt
-    if (!crypto->setDHPublicKey(remotePublic.bytes)) {
+    if (!setSharedKey(remotePublic.bytes)) {
         return false;
     }
-    crypto->hash(shared_key, 32);
 
     initNonce(fromNode, packetNum, extraNonce);
     printBytes("Attempt decrypt with nonce: ", nonce, 13);
@@ -145,9 +146,46 @@ bool CryptoEngine::decryptCurve25519(uint32_t fromNode, meshtastic_UserLite_publ
     return aes_ccm_ad(shared_key, 32, nonce, 8, bytes, numBytes - 12, nullptr, 0, auth, bytesOut);
 }
 
+bool CryptoEngine::setSharedKey(const uint8_t *publicKey)
+{
+#if PKI_SHARED_KEY_CACHE
+    CachedSharedKey *slot = &sharedKeyCache[0];
+    for (auto &cached : sharedKeyCache) {
+        if (cached.lastUsed && memcmp(cached.publicKey, publicKey, sizeof(cached.publicKey)) == 0) {
+            cached.lastUsed = ++sharedKeyCacheUses;
+            memcpy(shared_key, cached.sharedKey, sizeof(shared_key));
+            return cached.valid;
+        }
+        if (cached.lastUsed < slot->lastUsed)
+            slot = &cached; // Least recently used, or a free one
+    }
+
+    memcpy(slot->publicKey, publicKey, sizeof(slot->publicKey));
+    slot->valid = setDHPublicKey(slot->publicKey);
+    if (slot->valid)
+        hash(shared_key, 32);
+    memcpy(slot->sharedKey, shared_key, sizeof(slot->sharedKey));
+    slot->lastUsed = ++sharedKeyCacheUses;
+    return slot->valid;
+#else
+    if (!setDHPublicKey((uint8_t *)publicKey))
+        return false;
+    hash(shared_key, 32);
+    return true;
+#endif
+}
+
+void CryptoEngine::clearSharedKeyCache()
+{
+#if PKI_SHARED_KEY_CACHE
+    memset(sharedKeyCache, 0, sizeof(sharedKeyCache));
+#endif
+}
+
 void CryptoEngine::setDHPrivateKey(uint8_t *_private_key)
 {
     memcpy(private_key, _private_key, 32);
+    clearSharedKeyCache();
 }
 
 /**
@@ -82,6 +82,27 @@ class CryptoEngine
 #if !(MESHTASTIC_EXCLUDE_PKI)
     uint8_t shared_key[32] = {0};
     uint8_t private_key[32] = {0};
+
+#if PKI_SHARED_KEY_CACHE
+    /// Cached PKI shared secret: a remote public key, and the outcome of the DH and hash for it with our private key
+    struct CachedSharedKey {
+        uint8_t publicKey[32];
+        uint8_t sharedKey[32];
+        uint32_t lastUsed; // 0 for a free slot
+        bool valid;        // false if the DH failed, e.g. for a weak key
+    };
+    CachedSharedKey sharedKeyCache[PKI_SHARED_KEY_CACHE] = {};
+    uint32_t sharedKeyCacheUses = 0;
+#endif
+
+    /**
+     * Set shared_key for a remote public key, running the DH and hash only the first time the key is seen
+     * @return false if the key can't be used
+     */
+    bool setSharedKey(const uint8_t *publicKey);
+
+    /// Drop the shared keys of sharedKeyCache, must be called whenever private_key changes
+    void clearSharedKeyCache();
 #endif
     /**
      * Init our 128 bit nonce for a new packet
@@ -0,0 +1,117 @@
+#include "FloodGuard.h"
+#include "configuration.h"
+#if ARCH_PORTDUINO
+#include "platform/portduino/PortduinoGlue.h"
+#endif
+
+#include <algorithm>
+
+FloodGuard::FloodGuard()
+{
+#if ARCH_PORTDUINO
+    setLimit(LOCAL, settingsMap[flood_guard_local_per_minute], settingsMap[flood_guard_local_burst]);
+    setLimit(RELAY, settingsMap[flood_guard_relay_per_minute], settingsMap[flood_guard_relay_burst]);
+#else
+    setLimit(LOCAL, FLOOD_GUARD_LOCAL_PER_MINUTE, FLOOD_GUARD_LOCAL_BURST);
+    setLimit(RELAY, FLOOD_GUARD_RELAY_PER_MINUTE, FLOOD_GUARD_RELAY_BURST);
+#endif
+    clear();
+}
+
+void FloodGuard::setLimit(Budget budget, uint16_t perMinute, uint16_t burst)
+{
+    limits[budget].perMinute = perMinute;
+    limits[budget].burst = burst ? burst : 1;
+}
+
+bool FloodGuard::allow(const meshtastic_MeshPacket *p)
+{
+    Budget budget = (isBroadcast(p->to) || isToUs(p)) ? LOCAL : RELAY;
+    const Limit &limit = limits[budget];
+    if (limit.perMinute == 0 || p->from == 0 || isFromUs(p))
+        return true;
+
+    uint32_t now = millis();
+    if (now == 0) // 0 is special
+        now = 1;
+
+    Entry *e = lookup(p->from, now);
+    e->lastHeardMsec = now;
+
+    Bucket &b = e->buckets[budget];
+    refill(b, budget, now);
+
+    if (b.milliTokens < 1000) {
+        b.dropped++;
+        dropped[budget]++;
+        if (b.dropped == 1 || b.dropped % 100 == 0)
+            LOG_WARN("Flood guard: drop %s packets of 0x%x, %u so far", budget == LOCAL ? "local" : "relay", p->from, b.dropped);
+        return false;
+    }
+    b.milliTokens -= 1000;
+    return true;
+}
+
+uint32_t FloodGuard::refill(Bucket &b, Budget budget, uint32_t now) const
+{
+    // perMinute tokens per 60000 msec, in 1/1000 of a token
+    const Limit &limit = limits[budget];
+    uint32_t full = limit.burst * 1000;
+    uint64_t earned = (uint64_t)(now - b.refillMsec) * limit.perMinute / 60;
+    b.milliTokens = (uint32_t)std::min<uint64_t>((uint64_t)b.milliTokens + earned, full);
+    b.refillMsec = now;
+    return (uint64_t)b.milliTokens * 1000 / full;
+}
+
+FloodGuard::Entry *FloodGuard::lookup(NodeNum from, uint32_t now)
+{
+    Entry *evict = NULL;
+    uint32_t evictFill = 0;
+    for (Entry *it = entries; it < entries + FLOOD_GUARD_TABLE_SIZE; ++it) {
+        if (it->from == from)
+            return it;
+        if (evict && evict->from == 0)
+            continue;
+        if (it->from == 0) {
+            evict = it;
+            continue;
+        }
+        // Evicting the sender with the most tokens left forgets the least, a full one is no different from a new one.
+        // Of equally full ones evict the one heard least recently
+        uint32_t fill = refill(it->buckets[LOCAL], LOCAL, now) + refill(it->buckets[RELAY], RELAY, now);
+        if (!evict || fill > evictFill ||
+            (fill == evictFill && (now - it->lastHeardMsec) > (now - evict->lastHeardMsec))) {
+            evict = it;
+            evictFill = fill;
+        }
+    }
+
+    memset(evict, 0, sizeof(*evict));
+    evict->from = from;
+    for (Bucket &b : evict->buckets)
+        b.milliTokens = UINT32_MAX; // Filled up to the burst by refill()
+    return evict;
+}
+
+const FloodGuard::Entry *FloodGuard::find(NodeNum from) const
+{
+    for (const Entry *it = entries; it < entries + FLOOD_GUARD_TABLE_SIZE; ++it) {
+        if (from != 0 && it->from == from)
+            return it;
+    }
+    return NULL;
+}
+
+void FloodGuard::clear()
+{
+    memset(entries, 0, sizeof(entries));
+}
+
+void FloodGuard::log() const
+{
+    LOG_INFO("Flood guard dropped local=%u relay=%u", dropped[LOCAL], dropped[RELAY]);
+    for (const Entry *it = entries; it < entries + FLOOD_GUARD_TABLE_SIZE; ++it) {
+        if (it->from != 0 && (it->buckets[LOCAL].dropped || it->buckets[RELAY].dropped))
+            LOG_INFO("  from=0x%x local=%u relay=%u", it->from, it->buckets[LOCAL].dropped, it->buckets[RELAY].dropped);
+    }
+}
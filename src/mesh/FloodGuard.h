@@ -0,0 +1,85 @@
+#pragma once
+
+#include "MeshTypes.h"
+
+#define FLOOD_GUARD_TABLE_SIZE 32 // Number of senders we keep budgets for
+
+// Default budgets, in packets per minute with the burst a quiet sender may spend at once. A rate of 0 turns a budget off,
+// which is the default: set them as build flags, or in config.yaml on native
+#ifndef FLOOD_GUARD_LOCAL_PER_MINUTE
+#define FLOOD_GUARD_LOCAL_PER_MINUTE 0
+#endif
+#ifndef FLOOD_GUARD_LOCAL_BURST
+#define FLOOD_GUARD_LOCAL_BURST 10
+#endif
+#ifndef FLOOD_GUARD_RELAY_PER_MINUTE
+#define FLOOD_GUARD_RELAY_PER_MINUTE 0
+#endif
+#ifndef FLOOD_GUARD_RELAY_BURST
+#define FLOOD_GUARD_RELAY_BURST 6
+#endif
+
+/**
+ * Token buckets per sender (the from field), checked by Router before a received packet gets decrypted, so a single node
+ * sending at an unbounded rate can't make us decode, dispatch and rebroadcast all of it.
+ *
+ * Packets for us (including broadcasts) and packets we would only relay for someone else draw from separate budgets.
+ *
+ * When the table is full a new sender takes the entry with the most tokens left, so cycling through spoofed from fields
+ * can't reset a drained sender, and every new sender still gets a budget of its own.
+ */
+class FloodGuard
+{
+  public:
+    enum Budget : uint8_t { LOCAL, RELAY, NUM_BUDGETS };
+
+    struct Bucket {
+        uint32_t milliTokens;
+        uint32_t refillMsec;
+        uint32_t dropped;
+    };
+
+    struct Entry {
+        NodeNum from; // 0 means empty
+        uint32_t lastHeardMsec;
+        Bucket buckets[NUM_BUDGETS];
+    };
+
+    FloodGuard();
+
+    /** Change the rate (packets per minute, 0 for unlimited) and burst of a budget */
+    void setLimit(Budget budget, uint16_t perMinute, uint16_t burst);
+
+    /** Spend a token of the sender of this packet, @return false if it is over its budget and the packet should be dropped */
+    bool allow(const meshtastic_MeshPacket *p);
+
+    /** Find the entry for a sender, NULL if not known */
+    const Entry *find(NodeNum from) const;
+
+    /** Whether any budget is on */
+    bool isEnabled() const { return limits[LOCAL].perMinute || limits[RELAY].perMinute; }
+
+    /** Forget all senders, but not the totals */
+    void clear();
+
+    /** Dump the senders we dropped packets of to the log, for diagnostics */
+    void log() const;
+
+    /// Packets dropped over all senders, per budget
+    uint32_t dropped[NUM_BUDGETS] = {};
+
+  private:
+    struct Limit {
+        uint16_t perMinute;
+        uint16_t burst;
+    };
+
+    Limit limits[NUM_BUDGETS];
+    Entry entries[FLOOD_GUARD_TABLE_SIZE] = {};
+
+    /** Add the tokens earned since the last refill, @return how full the bucket is, in 1/1000 */
+    uint32_t refill(Bucket &b, Budget budget, uint32_t now) const;
+
+    /** The entry of a sender, a new one if not known yet */
+    Entry *lookup(NodeNum from, uint32_t now);
+};
@@ -1,7 +1,13 @@
 #include "FloodingRouter.h"
 
+#include "Throttle.h"
 #include "configuration.h"
 #include "mesh-pb-constants.h"
+#if ARCH_PORTDUINO
+#include "platform/portduino/PortduinoGlue.h"
+#endif
+
+#define NEIGHBOR_LINKS_LOG_INTERVAL_MSEC (15 * 60 * 1000)
 
 FloodingRouter::FloodingRouter() {}
 
@@ -21,9 +27,13 @@ ErrorCode FloodingRouter::send(meshtastic_MeshPacket *p)
 
 bool FloodingRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
 {
+    recordNeighborLink(p);
+
     if (wasSeenRecently(p)) { // Note: this will also add a recent packet record
         printPacket("Ignore dupe incoming msg", p);
         rxDupe++;
+        if (iface)
+            iface->getContentionWindow().onDuplicate();
 
         /* If the original transmitter is doing retransmissions (hopStart equals hopLimit) for a reliable transmission, e.g., when
         the ACK got lost, we will handle the packet again to make sure it gets an implicit ACK. */
@@ -51,12 +61,61 @@ void FloodingRouter::perhapsCancelDupe(const meshtastic_MeshPacket *p)
         // cancel rebroadcast of this message *if* there was already one, unless we're a router/repeater!
         if (Router::cancelSending(p->from, p->id))
             txRelayCanceled++;
+    } else if (isCoveredByNeighbors(p)) {
+        // Enough strong neighbors already relayed this, our rebroadcast would only add airtime
+        if (Router::cancelSending(p->from, p->id)) {
+            LOG_DEBUG("Cancel rebroadcast of 0x%x, covered by neighbors", p->id);
+            txRelayCanceled++;
+            return;
+        }
     }
     if (config.device.role == meshtastic_Config_DeviceConfig_Role_ROUTER_LATE && iface) {
         iface->clampToLateRebroadcastWindow(getFrom(p), p->id);
     }
 }
 
+void FloodingRouter::recordNeighborLink(const meshtastic_MeshPacket *p)
+{
+    static uint32_t lastLog = 0;
+
+    neighborLinks.record(p);
+    if (lastLog == 0 || !Throttle::isWithinTimespanMs(lastLog, NEIGHBOR_LINKS_LOG_INTERVAL_MSEC)) {
+        lastLog = millis();
+        neighborLinks.log();
+    }
+}
+
+uint8_t FloodingRouter::getCoverageSuppressionMinNeighbors()
+{
+#ifdef USERPREFS_LORA_COVERAGE_SUPPRESSION
+    // A packet record only keeps NUM_RELAYERS relayers, more could never be counted
+    static_assert(USERPREFS_LORA_COVERAGE_SUPPRESSION <= NUM_RELAYERS,
+                  "USERPREFS_LORA_COVERAGE_SUPPRESSION can't be more than NUM_RELAYERS");
+    return USERPREFS_LORA_COVERAGE_SUPPRESSION;
+#elif ARCH_PORTDUINO
+    return settingsMap[lora_coverage_suppression];
+#else
+    return 0;
+#endif
+}
+
+bool FloodingRouter::isCoveredByNeighbors(const meshtastic_MeshPacket *p)
+{
+    uint8_t minNeighbors = getCoverageSuppressionMinNeighbors();
+    if (minNeighbors == 0)
+        return false;
+
+    uint8_t ourRelayID = nodeDB->getLastByteOfNodeNum(getNodeNum());
+    uint8_t relayers[NUM_RELAYERS];
+    uint8_t numRelayers = getRelayers(relayers, p->id, getFrom(p));
+    uint8_t strong = 0;
+    for (uint8_t i = 0; i < numRelayers; i++) {
+        if (relayers[i] != ourRelayID && neighborLinks.isStrong(relayers[i]))
+            strong++;
+    }
+    return strong >= minNeighbors;
+}
+
 bool FloodingRouter::isRebroadcaster()
 {
     return config.device.role != meshtastic_Config_DeviceConfig_Role_CLIENT_MUTE &&
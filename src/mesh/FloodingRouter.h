@@ -1,5 +1,6 @@
 #pragma once
 
+#include "NeighborLinkTable.h"
 #include "Router.h"
 
 /**
@@ -45,7 +46,22 @@ class FloodingRouter : public Router
      */
     virtual ErrorCode send(meshtastic_MeshPacket *p) override;
 
+    /** Link quality of the relayers we hear directly, for diagnostics */
+    const NeighborLinkTable &getNeighborLinks() const { return neighborLinks; }
+
   protected:
+    NeighborLinkTable neighborLinks;
+
+    /* Update the neighbor link table with the relayer of a received packet */
+    void recordNeighborLink(const meshtastic_MeshPacket *p);
+
+    /* Minimum number of strong neighbors that must have relayed a packet before a router/repeater skips its own
+     * rebroadcast, 0 if coverage suppression is disabled */
+    static uint8_t getCoverageSuppressionMinNeighbors();
+
+    /* Check whether enough strong neighbors already relayed this packet that our rebroadcast adds no coverage */
+    bool isCoveredByNeighbors(const meshtastic_MeshPacket *p);
+
     /**
      * Should this incoming filter be dropped?
      *
@@ -6,6 +6,7 @@
 #include <memory>
 
 #include "PointerQueue.h"
+#include "memGet.h"
 
 template <class T> class Allocator
 {
@@ -80,10 +81,14 @@ template <class T> class Allocator
 template <class T> class MemoryDynamic : public Allocator<T>
 {
   public:
+    /// tag is the subsystem the buffers are accounted to with HAS_MEMORY_STATS
+    explicit MemoryDynamic(MemTag tag = MemTag::Other) : tag(tag) {}
+
     /// Return a buffer for use by others
     virtual void release(T *p) override
     {
         assert(p);
+        memGet.countFree(tag, sizeof(T));
         free(p);
     }
 
@@ -93,6 +98,11 @@ template <class T> class MemoryDynamic : public Allocator<T>
     {
         T *p = (T *)malloc(sizeof(T));
         assert(p);
+        if (p)
+            memGet.countAlloc(tag, sizeof(T));
         return p;
     }
+
+  private:
+    const MemTag tag;
 };
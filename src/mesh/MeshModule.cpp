@@ -8,6 +8,13 @@
 #include <assert.h>
 
 std::vector<MeshModule *> *MeshModule::modules;
+std::vector<MeshModule *> *MeshModule::portTable;
+std::vector<MeshModule *> *MeshModule::anyPortTable;
+std::vector<MeshModule *> *MeshModule::promiscuousTable;
+bool MeshModule::tablesDirty = true;
+bool MeshModule::boundChannelsDirty = true;
+uint8_t MeshModule::dispatchDepth = 0;
+uint32_t MeshModule::nextRegistrationOrder = 0;
 
 const meshtastic_MeshPacket *MeshModule::currentRequest;
 uint8_t MeshModule::numPeriodicModules = 0;
@@ -25,6 +32,9 @@ MeshModule::MeshModule(const char *_name) : name(_name)
         modules = new std::vector<MeshModule *>();
 
     modules->push_back(this);
+    registrationOrder = nextRegistrationOrder++;
+    tablesDirty = true;
+    boundChannelsDirty = true;
 }
 
 void MeshModule::setup() {}
@@ -34,6 +44,7 @@ MeshModule::~MeshModule()
     auto it = std::find(modules->begin(), modules->end(), this);
     assert(it != modules->end());
     modules->erase(it);
+    tablesDirty = true;
 }
 
 // ⚠️ **Only call once** to set the initial delay before a module starts broadcasting periodically
@@ -85,6 +96,49 @@ meshtastic_MeshPacket *MeshModule::allocErrorResponse(meshtastic_Routing_Error e
     return r;
 }
 
+void MeshModule::buildDispatchTables()
+{
+    if (!portTable) {
+        portTable = new std::vector<MeshModule *>();
+        anyPortTable = new std::vector<MeshModule *>();
+        promiscuousTable = new std::vector<MeshModule *>();
+    }
+    portTable->clear();
+    anyPortTable->clear();
+    promiscuousTable->clear();
+
+    for (auto m : *modules) {
+        m->dispatchPort = m->getPortNum();
+        if (m->dispatchPort != meshtastic_PortNum_UNKNOWN_APP) {
+            portTable->push_back(m);
+        } else {
+            anyPortTable->push_back(m);
+            if (m->isPromiscuous)
+                promiscuousTable->push_back(m);
+        }
+    }
+    // modules is in registration order, a stable sort keeps it within each portnum
+    std::stable_sort(portTable->begin(), portTable->end(),
+                     [](const MeshModule *a, const MeshModule *b) { return a->dispatchPort < b->dispatchPort; });
+
+    LOG_DEBUG("Module dispatch: %u on a portnum, %u on any portnum (%u promiscuous)", (uint32_t)portTable->size(),
+              (uint32_t)anyPortTable->size(), (uint32_t)promiscuousTable->size());
+    tablesDirty = false;
+}
+
+void MeshModule::resolveBoundChannels()
+{
+    for (auto m : *modules) {
+        m->boundChannelMask = 0;
+        if (!m->boundChannel)
+            continue;
+        for (ChannelIndex i = 0; i < channels.getNumChannels() && i < MAX_NUM_CHANNELS; i++)
+            if (strcasecmp(channels.getByIndex(i).settings.name, m->boundChannel) == 0)
+                m->boundChannelMask |= 1 << i;
+    }
+    boundChannelsDirty = false;
+}
+
 void MeshModule::callModules(meshtastic_MeshPacket &mp, RxSource src)
 {
     // LOG_DEBUG("In call modules");
@@ -101,8 +155,30 @@ void MeshModule::callModules(meshtastic_MeshPacket &mp, RxSource src)
     auto ourNodeNum = nodeDB->getNodeNum();
     bool toUs = isBroadcast(mp.to) || isToUs(&mp);
 
-    for (auto i = modules->begin(); i != modules->end(); ++i) {
-        auto &pi = **i;
+    // A module that registers while we are dispatching only makes it into the tables once the outermost call is done
+    if (tablesDirty && dispatchDepth == 0)
+        buildDispatchTables();
+    dispatchDepth++;
+
+    // Only walk the modules that can want this packet: the ones declared for its portnum and the ones that look at every
+    // portnum (of those, just the promiscuous ones if we are sniffing), merged back into registration order.  Encrypted
+    // packets have no portnum yet, so they still go past every module.
+    auto portIt = modules->end(), portEnd = modules->end();
+    auto anyIt = modules->begin(), anyEnd = modules->end();
+    if (isDecoded && !tablesDirty) {
+        meshtastic_PortNum port = mp.decoded.portnum;
+        portIt = std::lower_bound(portTable->begin(), portTable->end(), port,
+                                  [](const MeshModule *m, meshtastic_PortNum p) { return m->dispatchPort < p; });
+        portEnd = std::upper_bound(portIt, portTable->end(), port,
+                                   [](meshtastic_PortNum p, const MeshModule *m) { return p < m->dispatchPort; });
+        auto &anyTable = toUs ? *anyPortTable : *promiscuousTable;
+        anyIt = anyTable.begin();
+        anyEnd = anyTable.end();
+    }
+
+    while (portIt != portEnd || anyIt != anyEnd) {
+        bool takePort = portIt != portEnd && (anyIt == anyEnd || (*portIt)->registrationOrder < (*anyIt)->registrationOrder);
+        auto &pi = takePort ? **portIt++ : **anyIt++;
 
         pi.currentRequest = &mp;
 
@@ -121,8 +197,8 @@ void MeshModule::callModules(meshtastic_MeshPacket &mp, RxSource src)
 
             moduleFound = true;
 
-            /// received channel (or NULL if not decoded)
-            meshtastic_Channel *ch = isDecoded ? &channels.getByIndex(mp.channel) : NULL;
+            if (boundChannelsDirty)
+                resolveBoundChannels();
 
             /// Is the channel this packet arrived on acceptable? (security check)
             /// Note: we can't know channel names for encrypted packets, so those are NEVER sent to boundChannel modules
@@ -130,7 +206,8 @@ void MeshModule::callModules(meshtastic_MeshPacket &mp, RxSource src)
             /// Also: if a packet comes in on the local PC interface, we don't check for bound channels, because it is TRUSTED and
             /// it needs to to be able to fetch the initial admin packets without yet knowing any channels.
 
-            bool rxChannelOk = !pi.boundChannel || (mp.from == 0) || (ch && strcasecmp(ch->settings.name, pi.boundChannel) == 0);
+            bool rxChannelOk = !pi.boundChannel || (mp.from == 0) ||
+                               (isDecoded && mp.channel < MAX_NUM_CHANNELS && (pi.boundChannelMask & (1 << mp.channel)));
 
             if (!rxChannelOk) {
                 // no one should have already replied!
@@ -178,6 +255,7 @@ void MeshModule::callModules(meshtastic_MeshPacket &mp, RxSource src)
 
         pi.currentRequest = NULL;
     }
+    dispatchDepth--;
 
     if (isDecoded && mp.decoded.want_response && toUs) {
         if (currentReply) {
@@ -63,6 +63,23 @@ class MeshModule
 {
     static std::vector<MeshModule *> *modules;
 
+    /** Dispatch tables of callModules(), built from getPortNum() of all modules the first time a packet arrives after a
+     * module registered or went away.  portTable is sorted by portnum and keeps registration order within one portnum.
+     */
+    static std::vector<MeshModule *> *portTable, *anyPortTable, *promiscuousTable;
+    static bool tablesDirty, boundChannelsDirty;
+    static uint8_t dispatchDepth;
+    static uint32_t nextRegistrationOrder;
+
+    uint32_t registrationOrder;
+    meshtastic_PortNum dispatchPort = meshtastic_PortNum_UNKNOWN_APP;
+
+    /// Bit n is set if channel n has the name of boundChannel
+    uint32_t boundChannelMask = 0;
+
+    static void buildDispatchTables();
+    static void resolveBoundChannels();
+
   public:
     /** Constructor
      * name is for debugging output
@@ -75,6 +92,10 @@ class MeshModule
      */
     static void callModules(meshtastic_MeshPacket &mp, RxSource src = RX_SRC_RADIO);
 
+    /** Called by Channels whenever the channel settings change, so the bound channel names get resolved to indices again
+     */
+    static void onChannelsChanged() { boundChannelsDirty = true; }
+
     static std::vector<MeshModule *> GetMeshModulesWithUIFrames(int startIndex);
     static void observeUIEvents(Observer<const UIFrameEvent *> *observer);
     static AdminMessageHandleResult handleAdminMessageForAllModules(const meshtastic_MeshPacket &mp,
@@ -144,6 +165,13 @@ class MeshModule
      */
     virtual bool wantPacket(const meshtastic_MeshPacket *p) = 0;
 
+    /**
+     * @return the only portnum this module wants, callModules() asks wantPacket() only for packets with that portnum.
+     * meshtastic_PortNum_UNKNOWN_APP (the default) means wantPacket() is asked about every packet, so any module that
+     * overrides wantPacket() to look at other portnums must keep returning that.
+     */
+    virtual meshtastic_PortNum getPortNum() { return meshtastic_PortNum_UNKNOWN_APP; }
+
     /** Called to handle a particular incoming message
 
     @return ProcessMessage::STOP if you've guaranteed you've handled this message and no other handlers should be considered for
@@ -0,0 +1,149 @@
+#include "Metrics.h"
+
+#if HAS_METRICS
+
+#include <stdio.h>
+#include <string.h>
+
+Metrics metrics;
+MetricsSnapshot *metricsSnapshot;
+
+Metrics::Entry *Metrics::add(const char *name, const char *help, Type type, const char *labels)
+{
+    uint8_t n = count.load(std::memory_order_relaxed);
+    if (n >= METRICS_MAX) {
+        LOG_WARN("Metrics registry full, drop %s", name);
+        return NULL;
+    }
+    Entry *e = &entries[n];
+    e->name = name;
+    e->help = help;
+    e->type = type;
+    e->labels = labels;
+    return e;
+}
+
+bool Metrics::addCounter(const char *name, const char *help, const uint32_t *value, const char *labels)
+{
+    Entry *e = add(name, help, COUNTER, labels);
+    if (!e)
+        return false;
+    e->counter = value;
+    publish();
+    return true;
+}
+
+bool Metrics::addGauge(const char *name, const char *help, ValueFn fn, const char *labels)
+{
+    Entry *e = add(name, help, GAUGE, labels);
+    if (!e)
+        return false;
+    e->gauge = fn;
+    publish();
+    return true;
+}
+
+bool Metrics::addHistogram(const char *name, const char *help, const Histogram &histogram, const char *labels)
+{
+    Entry *e = add(name, help, HISTOGRAM, labels);
+    if (!e)
+        return false;
+    e->histogram = histogram;
+    publish();
+    return true;
+}
+
+bool Metrics::isFirstOfName(uint8_t index) const
+{
+    for (uint8_t i = 0; i < index; i++) {
+        if (strcmp(entries[i].name, entries[index].name) == 0)
+            return false;
+    }
+    return true;
+}
+
+void Metrics::writeEntry(std::string &out, const Entry &e) const
+{
+    char line[192];
+    const char *labels = e.labels ? e.labels : "";
+    const char *open = e.labels ? "{" : "";
+    const char *close = e.labels ? "}" : "";
+
+    switch (e.type) {
+    case COUNTER:
+        snprintf(line, sizeof(line), "%s%s%s%s %u\n", e.name, open, labels, close, *e.counter);
+        out += line;
+        break;
+    case GAUGE:
+        snprintf(line, sizeof(line), "%s%s%s%s %g\n", e.name, open, labels, close, e.gauge());
+        out += line;
+        break;
+    case HISTOGRAM: {
+        const Histogram &h = e.histogram;
+        const char *sep = e.labels ? "," : "";
+        uint32_t cumulative = 0;
+        for (uint8_t i = 0; i < h.numBuckets; i++) {
+            cumulative += h.buckets[i];
+            if (i < h.numBuckets - 1)
+                snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"%g\"} %u\n", e.name, labels, sep,
+                         h.upperBound(i) * h.boundScale, cumulative);
+            else
+                snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"+Inf\"} %u\n", e.name, labels, sep, cumulative);
+            out += line;
+        }
+        snprintf(line, sizeof(line), "%s_sum%s%s%s %g\n", e.name, open, labels, close, *h.sum * h.sumScale);
+        out += line;
+        snprintf(line, sizeof(line), "%s_count%s%s%s %u\n", e.name, open, labels, close, *h.count);
+        out += line;
+        break;
+    }
+    }
+}
+
+void Metrics::writePrometheus(std::string &out) const
+{
+    static const char *typeNames[] = {"counter", "gauge", "histogram"};
+    char line[192];
+
+    uint8_t n = size();
+    for (uint8_t i = 0; i < n; i++) {
+        if (!isFirstOfName(i))
+            continue;
+        // Group all series of this name under a single HELP/TYPE header, as the format requires
+        snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n", entries[i].name, entries[i].help, entries[i].name,
+                 typeNames[entries[i].type]);
+        out += line;
+        for (uint8_t j = i; j < n; j++) {
+            if (strcmp(entries[i].name, entries[j].name) == 0)
+                writeEntry(out, entries[j]);
+        }
+    }
+}
+
+MetricsSnapshot::MetricsSnapshot() : concurrency::OSThread("MetricsSnapshot")
+{
+    update();
+}
+
+void MetricsSnapshot::update()
+{
+    std::string rendered;
+    metrics.writePrometheus(rendered);
+
+    std::lock_guard<std::mutex> guard(lock);
+    text.swap(rendered);
+}
+
+void MetricsSnapshot::get(std::string &out)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    out = text;
+}
+
+int32_t MetricsSnapshot::runOnce()
+{
+    update();
+    return METRICS_SNAPSHOT_INTERVAL_MSEC;
+}
+
+#endif
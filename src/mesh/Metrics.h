@@ -0,0 +1,112 @@
+#pragma once
+
+#include "configuration.h"
+
+#if HAS_METRICS
+
+#include "concurrency/OSThread.h"
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+
+// Maximum number of registered series. Every label set is an entry of its own (memGet alone registers 15), only the
+// buckets of a histogram share one. A portduino build registers 46, so this leaves room for about as many again.
+#define METRICS_MAX 96
+
+/**
+ * Central registry of the counters, gauges and histograms that are otherwise scattered over the code base.
+ *
+ * Metrics are not copied into the registry: a site registers a pointer to the value it already maintains (or a function
+ * returning it), so updating a metric costs nothing more than before. Those values belong to the main thread, so the
+ * registry must only be read there: other threads (the web server) get the text rendered by MetricsSnapshot.
+ *
+ * Compiled in on portduino, where it is scraped in Prometheus text format from the /metrics endpoint of the web server.
+ */
+class Metrics
+{
+  public:
+    enum Type : uint8_t { COUNTER, GAUGE, HISTOGRAM };
+
+    typedef float (*ValueFn)();
+
+    /** Read-only view on a histogram maintained elsewhere */
+    struct Histogram {
+        const uint32_t *buckets;                // Per-bucket (non cumulative) counts
+        uint8_t numBuckets;                     // The last bucket is open ended
+        uint32_t (*upperBound)(uint8_t bucket); // Upper bound of a bucket, multiplied by boundScale
+        float boundScale;
+        const uint32_t *count; // Number of observations
+        const uint64_t *sum;   // Sum of the observations, multiplied by sumScale
+        float sumScale;
+    };
+
+    /**
+     * Register a metric. name must follow the Prometheus conventions (e.g. meshtastic_rx_good_total), labels is either NULL
+     * or a list like stage="rx". Series of the same name must share help and type. All strings must outlive the registry.
+     * @return false if the registry is full
+     */
+    bool addCounter(const char *name, const char *help, const uint32_t *value, const char *labels = NULL);
+    bool addGauge(const char *name, const char *help, ValueFn fn, const char *labels = NULL);
+    bool addHistogram(const char *name, const char *help, const Histogram &histogram, const char *labels = NULL);
+
+    /** Number of registered series */
+    uint8_t size() const { return count.load(std::memory_order_acquire); }
+
+    /** Append all metrics to out, in Prometheus text exposition format */
+    void writePrometheus(std::string &out) const;
+
+  private:
+    struct Entry {
+        const char *name;
+        const char *help;
+        const char *labels;
+        Type type;
+        union {
+            const uint32_t *counter;
+            ValueFn gauge;
+            Histogram histogram;
+        };
+    };
+
+    static_assert(METRICS_MAX <= UINT8_MAX, "count is a uint8_t");
+    Entry entries[METRICS_MAX] = {};
+    std::atomic<uint8_t> count{0};
+
+    Entry *add(const char *name, const char *help, Type type, const char *labels);
+    void publish() { count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+    bool isFirstOfName(uint8_t index) const;
+    void writeEntry(std::string &out, const Entry &e) const;
+};
+
+// Constant initialized, so it can be used from constructors of other globals
+extern Metrics metrics;
+
+#define METRICS_SNAPSHOT_INTERVAL_MSEC (5 * 1000) // Prometheus scrapes every 15s or more, that is fresh enough
+
+/**
+ * Renders the registry in Prometheus text format on the main thread, where the registered values are maintained, and keeps
+ * the result for the web server thread to serve.
+ */
+class MetricsSnapshot : private concurrency::OSThread
+{
+  public:
+    MetricsSnapshot();
+
+    /** Copy the last rendered text into out, may be called from any thread */
+    void get(std::string &out);
+
+    /** Render the registry now, main thread only */
+    void update();
+
+  protected:
+    virtual int32_t runOnce() override;
+
+  private:
+    std::mutex lock; // concurrency::Lock does nothing without FreeRTOS, and the web server is a real thread
+    std::string text;
+};
+
+extern MetricsSnapshot *metricsSnapshot;
+
+#endif
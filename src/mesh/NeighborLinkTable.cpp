@@ -0,0 +1,86 @@
+#include "NeighborLinkTable.h"
+#include "configuration.h"
+
+// Weight of a new sample in the EWMAs, as a shift (1/4)
+#define NEIGHBOR_EWMA_SHIFT 2
+
+void NeighborLinkTable::record(const meshtastic_MeshPacket *p)
+{
+    // Only packets received over LoRa carry a meaningful relayer and link quality
+    if (p->relay_node == NO_RELAY_NODE || p->via_mqtt || (p->rx_snr == 0 && p->rx_rssi == 0))
+        return;
+
+    uint32_t now = millis();
+    if (now == 0) // 0 is special
+        now = 1;
+
+    Entry *e = NULL;
+    Entry *oldest = &entries[0];
+    for (Entry *it = entries; it < entries + NEIGHBOR_LINK_TABLE_SIZE; ++it) {
+        if (it->lastHeardMsec != 0 && it->relayer == p->relay_node) {
+            e = it;
+            break;
+        }
+        if (it->lastHeardMsec == 0 || (oldest->lastHeardMsec != 0 && (now - it->lastHeardMsec) > (now - oldest->lastHeardMsec)))
+            oldest = it;
+    }
+
+    int16_t snrQ2 = (int16_t)(p->rx_snr * 4);
+    if (e == NULL || isStale(*e)) {
+        // New relayer, or one we lost for a while: start its statistics over
+        if (e == NULL)
+            e = oldest;
+        e->relayer = p->relay_node;
+        e->heardCount = 0;
+        e->snrQ2 = snrQ2;
+        e->rssi = p->rx_rssi;
+    } else {
+        e->snrQ2 += (snrQ2 - e->snrQ2) >> NEIGHBOR_EWMA_SHIFT;
+        e->rssi += (p->rx_rssi - e->rssi) >> NEIGHBOR_EWMA_SHIFT;
+    }
+    if (e->heardCount < UINT16_MAX)
+        e->heardCount++;
+    e->lastHeardMsec = now;
+}
+
+const NeighborLinkTable::Entry *NeighborLinkTable::find(uint8_t relayer) const
+{
+    for (const Entry *it = entries; it < entries + NEIGHBOR_LINK_TABLE_SIZE; ++it) {
+        if (it->lastHeardMsec != 0 && it->relayer == relayer)
+            return it;
+    }
+    return NULL;
+}
+
+bool NeighborLinkTable::isStale(const Entry &e) const
+{
+    return e.lastHeardMsec == 0 || (millis() - e.lastHeardMsec) > maxAgeMsec;
+}
+
+bool NeighborLinkTable::isStrong(uint8_t relayer) const
+{
+    const Entry *e = find(relayer);
+    return e && !isStale(*e) && e->heardCount >= NEIGHBOR_STRONG_MIN_HEARD && e->snrQ2 >= NEIGHBOR_STRONG_MIN_SNR * 4;
+}
+
+uint8_t NeighborLinkTable::size() const
+{
+    uint8_t n = 0;
+    for (const Entry *it = entries; it < entries + NEIGHBOR_LINK_TABLE_SIZE; ++it) {
+        if (it->lastHeardMsec != 0)
+            n++;
+    }
+    return n;
+}
+
+void NeighborLinkTable::log() const
+{
+    uint32_t now = millis();
+    LOG_INFO("Neighbor links (%u):", size());
+    for (const Entry *it = entries; it < entries + NEIGHBOR_LINK_TABLE_SIZE; ++it) {
+        if (it->lastHeardMsec == 0)
+            continue;
+        LOG_INFO("  relay=0x%02x snr=%.2f rssi=%d heard=%u age=%us%s", it->relayer, it->snrQ2 / 4.0, it->rssi, it->heardCount,
+                 (now - it->lastHeardMsec) / 1000, isStrong(it->relayer) ? " strong" : (isStale(*it) ? " stale" : ""));
+    }
+}
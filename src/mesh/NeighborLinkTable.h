@@ -0,0 +1,57 @@
+#pragma once
+
+#include "MeshTypes.h"
+
+#define NEIGHBOR_LINK_TABLE_SIZE 32 // Number of relayers we keep link quality for, least recently heard is evicted
+
+// A relayer counts as "strong" (its coverage overlaps ours) once heard this often with at least this EWMA SNR
+#define NEIGHBOR_STRONG_MIN_HEARD 3
+#define NEIGHBOR_STRONG_MIN_SNR 0
+
+// A relayer not heard for this long is stale: it no longer counts as strong and its statistics restart when heard again
+#define NEIGHBOR_LINK_MAX_AGE_MSEC (30 * 60 * 1000)
+
+/**
+ * Link quality of the nodes we directly hear relaying packets, keyed by the last byte of their NodeNum (the relay_node
+ * field of the packet header). SNR and RSSI are exponentially weighted moving averages.
+ *
+ * Used by FloodingRouter to suppress a pending rebroadcast once enough strong neighbors have already relayed the packet.
+ */
+class NeighborLinkTable
+{
+  public:
+    struct Entry {
+        uint32_t lastHeardMsec; // 0 means empty
+        uint16_t heardCount;
+        int16_t snrQ2;   // EWMA SNR in 1/4 dB
+        int16_t rssi;    // EWMA RSSI in dBm
+        uint8_t relayer; // Last byte of the relayer's NodeNum
+    };
+
+    explicit NeighborLinkTable(uint32_t maxAge = NEIGHBOR_LINK_MAX_AGE_MSEC) : maxAgeMsec(maxAge) {}
+
+    /** Update the entry of the relayer of this packet, if it was received over LoRa */
+    void record(const meshtastic_MeshPacket *p);
+
+    /** Find the entry for a relayer, NULL if not known */
+    const Entry *find(uint8_t relayer) const;
+
+    /** Whether this entry was not heard for longer than the maximum age */
+    bool isStale(const Entry &e) const;
+
+    /** Whether this relayer is heard often and well enough, and recently, that its coverage overlaps ours */
+    bool isStrong(uint8_t relayer) const;
+
+    /** Number of entries in use */
+    uint8_t size() const;
+
+    /** Entry at index i (0 <= i < NEIGHBOR_LINK_TABLE_SIZE), lastHeardMsec is 0 for unused slots */
+    const Entry &at(uint8_t i) const { return entries[i]; }
+
+    /** Dump the table to the log, for diagnostics */
+    void log() const;
+
+  private:
+    uint32_t maxAgeMsec;
+    Entry entries[NEIGHBOR_LINK_TABLE_SIZE] = {};
+};
@@ -32,9 +32,13 @@ bool NextHopRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
 {
     bool wasFallback = false;
     bool weWereNextHop = false;
+    recordNeighborLink(p);
+
     if (wasSeenRecently(p, true, &wasFallback, &weWereNextHop)) { // Note: this will also add a recent packet record
         printPacket("Ignore dupe incoming msg", p);
         rxDupe++;
+        if (iface)
+            iface->getContentionWindow().onDuplicate();
         stopRetransmission(p->from, p->id);
 
         // If it was a fallback to flooding, try to relay again
@@ -45,6 +45,7 @@
 #ifdef ARCH_PORTDUINO
 #include "modules/StoreForwardModule.h"
 #include "platform/portduino/PortduinoGlue.h"
+#include <mutex>
 #endif
 
 #ifdef ARCH_NRF52
@@ -1121,6 +1122,8 @@ LoadFileResult NodeDB::loadProto(const char *filename, size_t protoSize, size_t
 
 void NodeDB::loadFromDisk()
 {
+    MemTagScope memTag(MemTag::NodeDB);
+
     // Mark the current device state as completely unusable, so that if we fail reading the entire file from
     // disk we will still factoryReset to restore things.
     devicestate.version = 0;
@@ -1332,6 +1335,9 @@ bool NodeDB::saveProto(const char *filename, size_t protoSize, const pb_msgdesc_
 
     if (!okay || !writeSucceeded) {
         LOG_ERROR("Can't write prefs!");
+    } else {
+        fileWrites++;
+        bytesWritten += stream.bytes_written;
     }
 #else
     LOG_ERROR("ERROR: Filesystem not implemented");
@@ -1445,10 +1451,63 @@ bool NodeDB::saveToDisk(int saveWhat)
         RECORD_CRITICALERROR(success ? meshtastic_CriticalErrorCode_FLASH_CORRUPTION_RECOVERABLE
                                      : meshtastic_CriticalErrorCode_FLASH_CORRUPTION_UNRECOVERABLE);
     }
+    if (success)
+        pendingSave &= ~saveWhat; // Nothing left to write for these until they change again
 
     return success;
 }
 
+/// Runs NodeDB::runPendingSaves() until nothing is pending anymore
+class SaveThread : public concurrency::OSThread
+{
+  public:
+    SaveThread() : OSThread("SaveToDisk") {}
+
+  protected:
+    virtual int32_t runOnce() override
+    {
+        int32_t delayMsec = nodeDB->runPendingSaves();
+        return delayMsec > 0 ? delayMsec : disable();
+    }
+};
+
+void NodeDB::saveToDiskSoon(int saveWhat)
+{
+    uint32_t now = millis();
+    if (!pendingSave)
+        pendingSaveSince = now;
+    writesAvoided += __builtin_popcount(pendingSave & saveWhat);
+    pendingSave |= saveWhat;
+    lastSaveRequest = now;
+    LOG_DEBUG("Save to disk %d within %u ms", pendingSave, SAVE_QUIET_WINDOW_MSEC);
+
+    if (!saveThread)
+        saveThread = new SaveThread();
+    saveThread->enabled = true;
+    saveThread->setIntervalFromNow(SAVE_QUIET_WINDOW_MSEC);
+}
+
+bool NodeDB::flushPendingSaves()
+{
+    if (!pendingSave)
+        return true;
+    return saveToDisk(pendingSave);
+}
+
+int32_t NodeDB::runPendingSaves()
+{
+    if (!pendingSave)
+        return 0;
+    uint32_t now = millis();
+    uint32_t quiet = now - lastSaveRequest, waited = now - pendingSaveSince;
+    if (quiet < SAVE_QUIET_WINDOW_MSEC && waited < SAVE_MAX_DELAY_MSEC)
+        return std::min<uint32_t>(SAVE_QUIET_WINDOW_MSEC - quiet, SAVE_MAX_DELAY_MSEC - waited);
+
+    if (!flushPendingSaves())
+        pendingSave = 0; // saveToDisk() already retried and recorded the error, don't hammer the flash
+    return 0;
+}
+
 const meshtastic_NodeInfoLite *NodeDB::readNextMeshNode(uint32_t &readIndex)
 {
     if (readIndex < numMeshNodes)
@@ -1457,6 +1516,95 @@ const meshtastic_NodeInfoLite *NodeDB::readNextMeshNode(uint32_t &readIndex)
         return NULL;
 }
 
+#define MAX_REMOVED_NODES 32 // tombstones kept for delta syncs, clients that are further behind get everything again
+
+#ifdef ARCH_PORTDUINO
+// The HTTP API runs its PhoneAPI on the web server threads, and concurrency::Lock does nothing without FreeRTOS
+static std::mutex changeSeqsLock;
+#define LOCK_CHANGE_SEQS() std::lock_guard<std::mutex> changeSeqsGuard(changeSeqsLock)
+#else
+// Every PhoneAPI runs on the main thread
+#define LOCK_CHANGE_SEQS()
+#endif
+
+/// CRC of the encoded node, the struct itself has padding and whatever follows the terminator of its strings
+static uint32_t nodeFingerprint(const meshtastic_NodeInfoLite &node)
+{
+    uint8_t buf[meshtastic_NodeInfoLite_size];
+    size_t len = pb_encode_to_bytes(buf, sizeof(buf), &meshtastic_NodeInfoLite_msg, &node);
+    return crc32Buffer(buf, len);
+}
+
+uint32_t NodeDB::updateChangeSeqs()
+{
+    std::vector<NodeChange> current;
+    current.reserve(numMeshNodes);
+    for (size_t i = 0; i < numMeshNodes; i++) {
+        const meshtastic_NodeInfoLite &node = meshNodes->at(i);
+        current.push_back({node.num, nodeFingerprint(node), 0});
+    }
+    std::sort(current.begin(), current.end(), [](const NodeChange &a, const NodeChange &b) { return a.num < b.num; });
+
+    LOCK_CHANGE_SEQS();
+    // Both lists are sorted by num, numbers that are only in the old one were removed
+    auto old = nodeChanges.begin();
+    for (auto &change : current) {
+        for (; old != nodeChanges.end() && old->num < change.num; old++)
+            removedNodes.push_back({old->num, 0, ++changeSeq});
+        if (old != nodeChanges.end() && old->num == change.num) {
+            change.seq = old->fingerprint == change.fingerprint ? old->seq : ++changeSeq;
+            old++;
+        } else {
+            change.seq = ++changeSeq;
+        }
+    }
+    for (; old != nodeChanges.end(); old++)
+        removedNodes.push_back({old->num, 0, ++changeSeq});
+    nodeChanges.swap(current);
+
+    // A node that came back is sent as a change, its tombstone must go
+    removedNodes.erase(std::remove_if(removedNodes.begin(), removedNodes.end(),
+                                      [this](const NodeChange &removed) { return findChangeSeq(removed.num) != UINT32_MAX; }),
+                       removedNodes.end());
+    if (removedNodes.size() > MAX_REMOVED_NODES) {
+        size_t drop = removedNodes.size() - MAX_REMOVED_NODES;
+        oldestSyncSeq = removedNodes[drop - 1].seq;
+        removedNodes.erase(removedNodes.begin(), removedNodes.begin() + drop);
+    }
+    return changeSeq;
+}
+
+uint32_t NodeDB::getChangeSeq(NodeNum n)
+{
+    LOCK_CHANGE_SEQS();
+    return findChangeSeq(n);
+}
+
+uint32_t NodeDB::findChangeSeq(NodeNum n)
+{
+    auto it = std::lower_bound(nodeChanges.begin(), nodeChanges.end(), n,
+                               [](const NodeChange &change, NodeNum num) { return change.num < num; });
+    return (it != nodeChanges.end() && it->num == n) ? it->seq : UINT32_MAX;
+}
+
+bool NodeDB::canSyncSince(uint32_t since)
+{
+    LOCK_CHANGE_SEQS();
+    return since == 0 || (since >= oldestSyncSeq && since <= changeSeq);
+}
+
+NodeNum NodeDB::readNextRemovedNode(uint32_t &since)
+{
+    LOCK_CHANGE_SEQS();
+    for (const auto &removed : removedNodes) {
+        if (removed.seq > since) {
+            since = removed.seq;
+            return removed.num;
+        }
+    }
+    return 0;
+}
+
 /// Given a node, return how many seconds in the past (vs now) that we last heard from it
 uint32_t sinceLastSeen(const meshtastic_NodeInfoLite *n)
 {
@@ -1782,6 +1930,8 @@ meshtastic_NodeInfoLite *NodeDB::getOrCreateMeshNode(NodeNum n)
         if (isFull()) {
             LOG_INFO("Node database full with %i nodes and %u bytes free. Erasing oldest entry", numMeshNodes,
                      memGet.getFreeHeap());
+            if (numMeshNodes < MAX_NUM_NODES)
+                memGet.logStats(); // Out of heap, show who has it
             // look for oldest node and erase it
             uint32_t oldest = UINT32_MAX;
             uint32_t oldestBoring = UINT32_MAX;
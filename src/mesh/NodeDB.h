@@ -9,6 +9,7 @@
 
 #include "MeshTypes.h"
 #include "NodeStatus.h"
+#include "concurrency/OSThread.h"
 #include "configuration.h"
 #include "mesh-pb-constants.h"
 #include "mesh/generated/meshtastic/mesh.pb.h" // For CriticalErrorCode
@@ -92,6 +93,13 @@ DeviceState versions used to be defined in the .proto file but really only this
 #define SEGMENT_CHANNELS 8
 #define SEGMENT_NODEDATABASE 16
 
+#ifndef SAVE_QUIET_WINDOW_MSEC
+#define SAVE_QUIET_WINDOW_MSEC 2000 // saveToDiskSoon() writes once no more changes came in for this long
+#endif
+#ifndef SAVE_MAX_DELAY_MSEC
+#define SAVE_MAX_DELAY_MSEC 10000 // but never later than this after the first change
+#endif
+
 #define DEVICESTATE_CUR_VER 24
 #define DEVICESTATE_MIN_VER 24
 
@@ -163,6 +171,22 @@ class NodeDB
     bool saveToDisk(int saveWhat = SEGMENT_CONFIG | SEGMENT_MODULECONFIG | SEGMENT_DEVICESTATE | SEGMENT_CHANNELS |
                                    SEGMENT_NODEDATABASE);
 
+    /**
+     * Write the segments to flash after SAVE_QUIET_WINDOW_MSEC without further changes, so that clients which send their
+     * settings one field at a time cause one write per segment rather than one per message.
+     */
+    void saveToDiskSoon(int saveWhat);
+
+    /// Write what saveToDiskSoon() has pending right away, call before rebooting or shutting down
+    bool flushPendingSaves();
+
+    /// Write pending segments if their quiet window is over, returns the msecs until they are due or 0 if nothing is pending
+    int32_t runPendingSaves();
+
+    uint32_t fileWrites = 0;    // Protobuf files written to flash
+    uint32_t writesAvoided = 0; // Segment writes of saveToDiskSoon() merged into one that was already pending
+    uint32_t bytesWritten = 0;  // Protobuf bytes written to flash
+
     /** Reinit radio config if needed, because either:
      * a) sometimes a buggy android app might send us bogus settings or
      * b) the client set factory_reset
@@ -239,6 +263,28 @@ class NodeDB
 
     const meshtastic_NodeInfoLite *readNextMeshNode(uint32_t &readIndex);
 
+    /**
+     * Change sequence numbers for the delta sync of reconnecting clients. Every node has the sequence number of its last
+     * change, and nodes that left the DB leave a tombstone with the sequence number of their removal.
+     *
+     * Nodes are modified in place from many places, so changes are found by comparing a fingerprint of each NodeInfoLite
+     * with the one seen by the previous call. Safe to call from the web server threads of the HTTP API.
+     * @return the current sequence number, every change up to it has been numbered
+     */
+    uint32_t updateChangeSeqs();
+
+    /// @return the sequence number of the last change of a node, UINT32_MAX if it was added after updateChangeSeqs()
+    uint32_t getChangeSeq(NodeNum n);
+
+    /// @return true if the tombstones of all removals after sequence number since are still known, 0 being a full sync
+    bool canSyncSince(uint32_t since);
+
+    /**
+     * Walk the nodes removed after sequence number since, in the order they were removed
+     * @return the next removed node, with since advanced past it, or 0 when there are no more
+     */
+    NodeNum readNextRemovedNode(uint32_t &since);
+
     meshtastic_NodeInfoLite *getMeshNodeByIndex(size_t x)
     {
         assert(x < numMeshNodes);
@@ -298,6 +344,25 @@ class NodeDB
     uint32_t lastNodeDbSave = 0;    // when we last saved our db to flash
     uint32_t lastBackupAttempt = 0; // when we last tried a backup automatically or manually
     uint32_t lastSort = 0;          // When last sorted the nodeDB
+
+    int pendingSave = 0;           // Segments of saveToDiskSoon() not yet written
+    uint32_t pendingSaveSince = 0; // millis() of the first saveToDiskSoon() since the last write
+    uint32_t lastSaveRequest = 0;  // millis() of the latest one
+    concurrency::OSThread *saveThread = NULL;
+
+    struct NodeChange {
+        NodeNum num;
+        uint32_t fingerprint; // of the NodeInfoLite when the change was numbered
+        uint32_t seq;
+    };
+    std::vector<NodeChange> nodeChanges;  // sorted by num
+    std::vector<NodeChange> removedNodes; // tombstones, sorted by seq
+    uint32_t changeSeq = 0;
+    uint32_t oldestSyncSeq = 0; // tombstones up to here have been dropped
+
+    /// getChangeSeq() for callers that hold the lock of the change sequences
+    uint32_t findChangeSeq(NodeNum n);
+
     /// Find a node in our DB, create an empty NodeInfoLite if missing
     meshtastic_NodeInfoLite *getOrCreateMeshNode(NodeNum n);
 
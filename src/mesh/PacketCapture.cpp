@@ -0,0 +1,271 @@
+#include "PacketCapture.h"
+
+#ifdef ARCH_PORTDUINO
+#include "PacketTrace.h"
+#include "Router.h"
+#include "mesh-pb-constants.h"
+#include <algorithm>
+#include <stddef.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define PCAP_MAGIC 0xa1b2c3d4 // Microsecond timestamps, in our byte order
+#define PCAP_MAX_RECORD 512   // Longer records are not ours, skipped
+
+PacketCapture packetCapture;
+PacketReplay *packetReplay;
+
+struct __attribute__((packed)) PcapFileHeader {
+    uint32_t magic;
+    uint16_t versionMajor;
+    uint16_t versionMinor;
+    int32_t thisZone;
+    uint32_t sigFigs;
+    uint32_t snapLen;
+    uint32_t linkType;
+};
+
+struct __attribute__((packed)) PcapRecordHeader {
+    uint32_t sec;
+    uint32_t usec;
+    uint32_t inclLen;
+    uint32_t origLen;
+};
+
+bool PacketCapture::open(const char *path)
+{
+    close();
+    file = fopen(path, "wb");
+    if (!file) {
+        LOG_ERROR("Packet capture: can't create %s", path);
+        return false;
+    }
+    PcapFileHeader h = {PCAP_MAGIC, 2, 4, 0, 0, PCAP_MAX_RECORD, PACKET_CAPTURE_LINKTYPE};
+    if (fwrite(&h, sizeof(h), 1, file) != 1) {
+        LOG_ERROR("Packet capture: can't write to %s", path);
+        close();
+        return false;
+    }
+    fflush(file);
+    LOG_INFO("Packet capture to %s", path);
+    return true;
+}
+
+void PacketCapture::close()
+{
+    if (file) {
+        fclose(file);
+        file = NULL;
+    }
+}
+
+void PacketCapture::writeFrame(Direction direction, const uint8_t *frame, size_t length, float snr, int32_t rssi,
+                               uint8_t flags)
+{
+    if (!file)
+        return;
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    FrameHeader h = {PACKET_CAPTURE_VERSION, direction, flags, sizeof(FrameHeader), rssi, snr};
+    uint32_t recordLength = sizeof(h) + length;
+    PcapRecordHeader r = {(uint32_t)tv.tv_sec, (uint32_t)tv.tv_usec, recordLength, recordLength};
+    if (fwrite(&r, sizeof(r), 1, file) != 1 || fwrite(&h, sizeof(h), 1, file) != 1 || fwrite(frame, 1, length, file) != length) {
+        LOG_ERROR("Packet capture: write failed, stop capturing");
+        close();
+        return;
+    }
+    // A few frames a second at most, so the capture is complete up to the last frame should we crash
+    fflush(file);
+    framesWritten++;
+}
+
+void PacketCapture::writePacket(Direction direction, const meshtastic_MeshPacket *p)
+{
+    if (!file)
+        return;
+
+    // Keep the header in sync with RadioInterface::beginSending
+    RadioBuffer buf;
+    buf.header.from = p->from;
+    buf.header.to = p->to;
+    buf.header.id = p->id;
+    buf.header.channel = p->channel;
+    buf.header.next_hop = p->next_hop;
+    buf.header.relay_node = p->relay_node;
+    buf.header.flags =
+        p->hop_limit | (p->want_ack ? PACKET_FLAGS_WANT_ACK_MASK : 0) | (p->via_mqtt ? PACKET_FLAGS_VIA_MQTT_MASK : 0);
+    buf.header.flags |= (p->hop_start << PACKET_FLAGS_HOP_START_SHIFT) & PACKET_FLAGS_HOP_START_MASK;
+
+    size_t payloadLen;
+    uint8_t flags = 0;
+    if (p->which_payload_variant == meshtastic_MeshPacket_decoded_tag) {
+        payloadLen = pb_encode_to_bytes(buf.payload, sizeof(buf.payload), &meshtastic_Data_msg, &p->decoded);
+        flags |= DECODED;
+    } else {
+        payloadLen = std::min((size_t)p->encrypted.size, sizeof(buf.payload));
+        memcpy(buf.payload, p->encrypted.bytes, payloadLen);
+    }
+    writeFrame(direction, (const uint8_t *)&buf, sizeof(PacketHeader) + payloadLen, p->rx_snr, p->rx_rssi, flags);
+}
+
+meshtastic_MeshPacket *PacketCapture::toPacket(const Frame &frame)
+{
+    PacketHeader h;
+    if (frame.length < sizeof(h))
+        return NULL;
+    memcpy(&h, frame.data, sizeof(h));
+    const uint8_t *payload = frame.data + sizeof(h);
+    size_t payloadLen = frame.length - sizeof(h);
+    if (h.from == 0)
+        return NULL; // The radio ignores those as well
+
+    meshtastic_MeshPacket *mp = packetPool.allocZeroed();
+    // Keep the assigned fields in sync with RadioLibInterface::handleReceiveInterrupt
+    mp->from = h.from;
+    mp->to = h.to;
+    mp->id = h.id;
+    mp->channel = h.channel;
+    mp->hop_limit = h.flags & PACKET_FLAGS_HOP_LIMIT_MASK;
+    mp->hop_start = (h.flags & PACKET_FLAGS_HOP_START_MASK) >> PACKET_FLAGS_HOP_START_SHIFT;
+    mp->want_ack = !!(h.flags & PACKET_FLAGS_WANT_ACK_MASK);
+    mp->via_mqtt = !!(h.flags & PACKET_FLAGS_VIA_MQTT_MASK);
+    mp->next_hop = mp->hop_start == 0 ? NO_NEXT_HOP_PREFERENCE : h.next_hop;
+    mp->relay_node = mp->hop_start == 0 ? NO_RELAY_NODE : h.relay_node;
+    mp->rx_snr = frame.header.snr;
+    mp->rx_rssi = frame.header.rssi;
+
+    if (frame.header.flags & DECODED) {
+        mp->which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+        if (!pb_decode_from_bytes(payload, payloadLen, &meshtastic_Data_msg, &mp->decoded)) {
+            packetPool.release(mp);
+            return NULL;
+        }
+    } else {
+        if (payloadLen > sizeof(mp->encrypted.bytes)) {
+            packetPool.release(mp);
+            return NULL;
+        }
+        mp->which_payload_variant = meshtastic_MeshPacket_encrypted_tag;
+        memcpy(mp->encrypted.bytes, payload, payloadLen);
+        mp->encrypted.size = payloadLen;
+    }
+    return mp;
+}
+
+bool PacketCapture::Reader::open(const char *path)
+{
+    close();
+    file = fopen(path, "rb");
+    if (!file) {
+        LOG_ERROR("Packet capture: can't open %s", path);
+        return false;
+    }
+    PcapFileHeader h;
+    if (fread(&h, sizeof(h), 1, file) != 1 || h.magic != PCAP_MAGIC || h.linkType != PACKET_CAPTURE_LINKTYPE) {
+        LOG_ERROR("Packet capture: %s is not a capture of ours", path);
+        close();
+        return false;
+    }
+    return true;
+}
+
+void PacketCapture::Reader::close()
+{
+    if (file) {
+        fclose(file);
+        file = NULL;
+    }
+}
+
+bool PacketCapture::Reader::next(Frame &frame)
+{
+    PcapRecordHeader r;
+    uint8_t record[PCAP_MAX_RECORD];
+    while (file && fread(&r, sizeof(r), 1, file) == 1) {
+        if (r.inclLen > sizeof(record)) {
+            skipped++;
+            if (fseek(file, r.inclLen, SEEK_CUR) != 0)
+                break;
+            continue;
+        }
+        if (fread(record, 1, r.inclLen, file) != r.inclLen)
+            break; // Truncated, the capture was still being written
+
+        // Newer versions may have a longer header, the fields we know stay where they are
+        uint8_t headerLength = r.inclLen >= sizeof(FrameHeader) ? record[offsetof(FrameHeader, headerLength)] : 0;
+        if (headerLength < sizeof(FrameHeader) || headerLength > r.inclLen ||
+            r.inclLen - headerLength > sizeof(frame.data)) {
+            skipped++;
+            continue;
+        }
+        memcpy(&frame.header, record, sizeof(FrameHeader));
+        frame.usec = (uint64_t)r.sec * 1000000 + r.usec;
+        frame.length = r.inclLen - headerLength;
+        memcpy(frame.data, record + headerLength, frame.length);
+        return true;
+    }
+    return false;
+}
+
+PacketReplay::PacketReplay(const char *path, float speed) : OSThread("PacketReplay"), speed(speed)
+{
+    if (!reader.open(path)) {
+        done = true;
+        disable();
+        return;
+    }
+    if (speed > 0)
+        LOG_INFO("Replay %s at %.2fx the captured pace", path, speed);
+    else
+        LOG_INFO("Replay %s as fast as the router takes it", path);
+}
+
+int32_t PacketReplay::runOnce()
+{
+    uint32_t now = millis();
+    while (true) {
+        if (!hasFrame) {
+            if (!reader.next(frame)) {
+                done = true;
+                LOG_INFO("Packet replay done: %u frames replayed, %u skipped in %u msec", framesReplayed,
+                         framesSkipped + reader.skipped, now - startMsec);
+                reader.close();
+                return disable();
+            }
+            hasFrame = true;
+            if (framesReplayed + framesSkipped == 0) {
+                firstUsec = frame.usec;
+                startMsec = now;
+            }
+        }
+
+        if (speed > 0) {
+            uint64_t sinceFirstUsec = frame.usec > firstUsec ? frame.usec - firstUsec : 0; // The clock may have been set back
+            uint32_t dueMsec = startMsec + (uint32_t)(sinceFirstUsec / 1000 / speed);
+            if ((int32_t)(dueMsec - now) > 0)
+                return dueMsec - now;
+        }
+
+        hasFrame = false;
+        meshtastic_MeshPacket *p = frame.header.direction == PacketCapture::RX ? PacketCapture::toPacket(frame) : NULL;
+        if (!p) {
+            framesSkipped++;
+            continue;
+        }
+        deliver(p);
+        framesReplayed++;
+        if (speed <= 0)
+            return 0; // One per run, so the router handles each before the next
+    }
+}
+
+void PacketReplay::deliver(meshtastic_MeshPacket *p)
+{
+    PACKET_TRACE(p, RX);
+    if (router)
+        router->enqueueReceivedMessage(p);
+    else
+        packetPool.release(p);
+}
+#endif
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "RadioInterface.h"
+#include "configuration.h"
+
+#ifdef ARCH_PORTDUINO
+#include "concurrency/OSThread.h"
+#include <stdio.h>
+
+#define PACKET_CAPTURE_LINKTYPE 147 // LINKTYPE_USER0, we define the layout of the frames ourselves
+#define PACKET_CAPTURE_VERSION 1
+
+/**
+ * Capture of the LoRa frames we receive and send, as a pcap file with microsecond timestamps.
+ *
+ * Every frame is a FrameHeader with its direction, SNR and RSSI, then the frame as it was on air: the PacketHeader and the
+ * encrypted payload. SimRadio gets decoded packets from the simulator, those are captured with the DECODED flag and the
+ * encoded meshtastic_Data as the payload. Set Logging: PacketCapture in config.yaml to capture, open the file in Wireshark
+ * with a dissector for LINKTYPE_USER0 or feed it back to the router with PacketReplay.
+ */
+class PacketCapture
+{
+  public:
+    enum Direction : uint8_t { RX, TX };
+
+    enum Flags : uint8_t {
+        DECODED = 1, // The payload is an encoded meshtastic_Data, not encrypted
+    };
+
+    /// Written before every frame, in host byte order like the rest of the file (the pcap magic tells which)
+    struct __attribute__((packed)) FrameHeader {
+        uint8_t version;      // PACKET_CAPTURE_VERSION
+        uint8_t direction;    // Direction
+        uint8_t flags;        // Flags
+        uint8_t headerLength; // sizeof(FrameHeader), readers skip what they don't know of newer versions
+        int32_t rssi;         // dBm, 0 for frames we sent
+        float snr;            // dB, 0 for frames we sent
+    };
+
+    struct Frame {
+        uint64_t usec; // Capture time, since 1970
+        FrameHeader header;
+        size_t length; // of the frame, the PacketHeader included
+        uint8_t data[sizeof(RadioBuffer)];
+    };
+
+    /// Reads the frames of a capture back, oldest first
+    class Reader
+    {
+      public:
+        ~Reader() { close(); }
+
+        /// false if the file can't be read or isn't a capture of ours
+        bool open(const char *path);
+        void close();
+
+        /// false at the end of the file
+        bool next(Frame &frame);
+
+        /// Records that were too long or of a newer version, skipped by next()
+        uint32_t skipped = 0;
+
+      private:
+        FILE *file = NULL;
+    };
+
+    ~PacketCapture() { close(); }
+
+    /// Start a new capture, an existing file is replaced
+    bool open(const char *path);
+    void close();
+    bool isOpen() const { return file != NULL; }
+
+    /// Capture a frame as it was on air, does nothing if no capture is open
+    void writeFrame(Direction direction, const uint8_t *frame, size_t length, float snr, int32_t rssi, uint8_t flags = 0);
+
+    /// Capture a packet for radios that don't have the frame as it was on air (SimRadio)
+    void writePacket(Direction direction, const meshtastic_MeshPacket *p);
+
+    /// Turn a frame back into a packet from the pool, as the radio would have delivered it. NULL if it is malformed.
+    static meshtastic_MeshPacket *toPacket(const Frame &frame);
+
+    uint32_t framesWritten = 0;
+
+  private:
+    FILE *file = NULL;
+};
+
+extern PacketCapture packetCapture;
+
+/**
+ * Feeds the received frames of a capture to the router as if the radio had just received them, at the pace they were
+ * captured sped up by speed, or one per run when speed is 0. Frames we sent are skipped, the router sends its own.
+ */
+class PacketReplay : public concurrency::OSThread
+{
+  public:
+    PacketReplay(const char *path, float speed);
+
+    bool isDone() const { return done; }
+
+    uint32_t framesReplayed = 0;
+    uint32_t framesSkipped = 0; // Sent by us, or malformed
+
+    virtual int32_t runOnce() override;
+
+  protected:
+    /// Hand a packet to the router
+    virtual void deliver(meshtastic_MeshPacket *p);
+
+  private:
+    PacketCapture::Reader reader;
+    PacketCapture::Frame frame;
+    float speed;
+    bool hasFrame = false;
+    bool done = false;
+    uint64_t firstUsec = 0; // Capture time of the first frame
+    uint32_t startMsec = 0; // When we replayed it
+};
+
+extern PacketReplay *packetReplay;
+
+#endif
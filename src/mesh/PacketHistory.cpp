@@ -382,3 +382,23 @@ void PacketHistory::removeRelayer(const uint8_t relayer, const uint32_t id, cons
               found->id, found->relayed_by[0], found->relayed_by[1], found->relayed_by[2], relayer, i != j);
 #endif
 }
+
+// Get the relayers of a packet in the history given an ID and sender
+uint8_t PacketHistory::getRelayers(uint8_t relayers[NUM_RELAYERS], const uint32_t id, const NodeNum sender)
+{
+    if (!initOk()) {
+        LOG_ERROR("Packet History - get Relayers: NOT INITIALIZED!");
+        return 0;
+    }
+
+    PacketRecord *found = find(sender, id);
+    if (found == NULL)
+        return 0;
+
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < NUM_RELAYERS; i++) {
+        if (found->relayed_by[i] != 0)
+            relayers[n++] = found->relayed_by[i];
+    }
+    return n;
+}
@@ -60,6 +60,11 @@ class PacketHistory
     // Remove a relayer from the list of relayers of a packet in the history given an ID and sender
     void removeRelayer(const uint8_t relayer, const uint32_t id, const NodeNum sender);
 
+    /* Get the relayers of a packet in the history given an ID and sender
+     * @param relayers array of NUM_RELAYERS that is filled with the relayers found
+     * @return number of relayers written to the array */
+    uint8_t getRelayers(uint8_t relayers[NUM_RELAYERS], const uint32_t id, const NodeNum sender);
+
     // To check if the PacketHistory was initialized correctly by constructor
     bool initOk(void) { return recentPackets != NULL && recentPacketsCapacity != 0; }
 };
@@ -0,0 +1,151 @@
+#include "PacketTrace.h"
+
+#if HAS_PACKET_TRACE
+
+#include "Metrics.h"
+#include "Throttle.h"
+#if ARCH_PORTDUINO
+#include "platform/portduino/PortduinoGlue.h"
+#endif
+
+#define PACKET_TRACE_STALE_USEC (60 * 1000 * 1000)       // A packet not marked for this long starts a new lifecycle
+#define PACKET_TRACE_LOG_INTERVAL_MSEC (15 * 60 * 1000) // How often the stats are dumped to the log
+
+PacketTrace packetTrace;
+
+static const char *stageNames[PacketTrace::NUM_STAGES] = {"rx",        "rx_queued",   "rx_handled", "modules_done",
+                                                          "tx_queued", "tx_cad_busy", "tx_start",   "tx_done"};
+
+PacketTrace::PacketTrace()
+{
+#if HAS_METRICS
+    static const char *stageLabels[NUM_STAGES] = {"stage=\"rx\"",        "stage=\"rx_queued\"",   "stage=\"rx_handled\"",
+                                                  "stage=\"modules_done\"", "stage=\"tx_queued\"",   "stage=\"tx_cad_busy\"",
+                                                  "stage=\"tx_start\"",     "stage=\"tx_done\""};
+    for (uint8_t i = 0; i < NUM_STAGES; i++) {
+        Metrics::Histogram h = {stats[i].buckets, PACKET_TRACE_BUCKETS, &bucketLimitMsec, 0.001f, &stats[i].samples,
+                                &stats[i].sumUsec, 0.000001f};
+        metrics.addHistogram("meshtastic_packet_stage_latency_seconds", "Time from the previous stage of a packet to this one",
+                             h, stageLabels[i]);
+    }
+#endif
+}
+
+const char *PacketTrace::stageName(Stage stage)
+{
+    return stage < NUM_STAGES ? stageNames[stage] : "unknown";
+}
+
+uint32_t PacketTrace::bucketLimitMsec(uint8_t bucket)
+{
+    return bucket < PACKET_TRACE_BUCKETS - 1 ? (1UL << bucket) : UINT32_MAX;
+}
+
+PacketTrace::InFlight *PacketTrace::findOrAdd(const meshtastic_MeshPacket *p, uint32_t now, bool *isNew)
+{
+    NodeNum from = getFrom(p);
+    InFlight *oldest = &inFlight[0];
+    for (InFlight *it = inFlight; it < inFlight + PACKET_TRACE_INFLIGHT; ++it) {
+        if (it->used && it->from == from && it->id == p->id) {
+            *isNew = (now - it->lastUsec) > PACKET_TRACE_STALE_USEC;
+            return it;
+        }
+        if (!it->used || (oldest->used && (now - it->lastUsec) > (now - oldest->lastUsec)))
+            oldest = it;
+    }
+
+    *isNew = true;
+    oldest->used = true;
+    oldest->from = from;
+    oldest->id = p->id;
+    return oldest;
+}
+
+void PacketTrace::mark(const meshtastic_MeshPacket *p, Stage stage)
+{
+    static uint32_t lastLog = 0;
+
+    if (p->id == 0) // Can't follow these
+        return;
+
+    uint32_t now = micros();
+    bool isNew;
+    InFlight *f = findOrAdd(p, now, &isNew);
+    StageStats &s = stats[stage];
+    s.count++;
+
+    int32_t delta = -1;
+    if (!isNew) {
+        delta = now - f->lastUsec;
+        uint32_t deltaMsec = delta / 1000;
+        uint8_t bucket = 0;
+        while (bucket < PACKET_TRACE_BUCKETS - 1 && deltaMsec >= bucketLimitMsec(bucket))
+            bucket++;
+        s.buckets[bucket]++;
+        s.samples++;
+        s.sumUsec += delta;
+        if ((uint32_t)delta > s.maxUsec)
+            s.maxUsec = delta;
+    }
+    // Backoff is part of the TX queue dwell time that TX_START reports, so CAD busy marks keep the reference point
+    if (stage != TX_CAD_BUSY || isNew)
+        f->lastUsec = now;
+    if (stage == TX_DONE)
+        f->used = false; // End of the lifecycle
+
+    writeTraceLine(p, stage, now, delta);
+
+    if (lastLog == 0 || !Throttle::isWithinTimespanMs(lastLog, PACKET_TRACE_LOG_INTERVAL_MSEC)) {
+        lastLog = millis();
+        log();
+    }
+}
+
+void PacketTrace::writeTraceLine(const meshtastic_MeshPacket *p, Stage stage, uint32_t now, int32_t deltaUsec)
+{
+#if ARCH_PORTDUINO
+    // Same JSON lines file as the packet trace of the router, so both can be correlated offline
+    if (settingsStrings[traceFilename] == "")
+        return;
+    char line[128];
+    snprintf(line, sizeof(line), "{\"stage\":\"%s\",\"from\":%u,\"id\":%u,\"us\":%u,\"delta_us\":%d}", stageName(stage),
+             getFrom(p), p->id, now, deltaUsec);
+    LOG_TRACE("%s", line);
+#endif
+}
+
+uint32_t PacketTrace::percentileMsec(Stage stage, uint8_t percentile) const
+{
+    const StageStats &s = stats[stage];
+    if (s.samples == 0)
+        return 0;
+    uint32_t target = ((uint64_t)s.samples * percentile + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < PACKET_TRACE_BUCKETS; i++) {
+        seen += s.buckets[i];
+        if (seen >= target)
+            return i < PACKET_TRACE_BUCKETS - 1 ? bucketLimitMsec(i) : s.maxUsec / 1000;
+    }
+    return s.maxUsec / 1000;
+}
+
+void PacketTrace::clear()
+{
+    memset(inFlight, 0, sizeof(inFlight));
+    memset(stats, 0, sizeof(stats));
+}
+
+void PacketTrace::log() const
+{
+    LOG_INFO("Packet trace latencies (since previous stage):");
+    for (uint8_t i = 0; i < NUM_STAGES; i++) {
+        const StageStats &s = stats[i];
+        if (s.count == 0)
+            continue;
+        LOG_INFO("  %s: count=%u avg=%ums p50<=%ums p90<=%ums max=%ums", stageName((Stage)i), s.count,
+                 s.samples ? (uint32_t)(s.sumUsec / s.samples / 1000) : 0, percentileMsec((Stage)i, 50),
+                 percentileMsec((Stage)i, 90), s.maxUsec / 1000);
+    }
+}
+
+#endif
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "configuration.h"
+
+#if HAS_PACKET_TRACE
+
+#define PACKET_TRACE_INFLIGHT 16 // Number of packets we follow at the same time, least recently marked is evicted
+#define PACKET_TRACE_BUCKETS 16  // Bucket 0 is < 1ms, bucket i is [2^(i-1), 2^i) ms, the last one is open ended
+
+/**
+ * Lightweight timestamped trace points along the life of a packet in the firmware:
+ *
+ *   RX -> RX_QUEUED -> RX_HANDLED -> MODULES_DONE -> TX_QUEUED -> (TX_CAD_BUSY)* -> TX_START -> TX_DONE
+ *
+ * Packets are followed by (from, id), so a relayed packet shows up as one lifecycle from reception to rebroadcast. Every mark
+ * adds the time since the previous mark of the same packet to the latency histogram of the stage, e.g. TX_DONE holds the
+ * time on air. TX_CAD_BUSY marks don't move that reference point: TX_CAD_BUSY holds the time since TX_QUEUED at which CAD
+ * found the channel busy, and TX_START the whole TX queue dwell time including CAD backoff. The first mark of a packet only
+ * counts it.
+ *
+ * Compiled in on portduino, set HAS_PACKET_TRACE to 1 to enable it on other platforms. On portduino every mark is also
+ * written as a JSON line to the Logging: TraceFile, if configured. The histograms are exported through the metrics registry.
+ */
+class PacketTrace
+{
+  public:
+    enum Stage : uint8_t {
+        RX,           // Decoded from the radio, in handleReceiveInterrupt()
+        RX_QUEUED,    // Handed to the router in enqueueReceivedMessage()
+        RX_HANDLED,   // Taken from fromRadioQueue by the router, start of handleReceived()
+        MODULES_DONE, // All modules were called
+        TX_QUEUED,    // Put in the TX queue of the radio
+        TX_CAD_BUSY,  // CAD found the channel busy, we back off again
+        TX_START,     // Taken from the TX queue and transmission started
+        TX_DONE,      // Transmission completed
+        NUM_STAGES
+    };
+
+    struct StageStats {
+        uint32_t count;   // Number of marks
+        uint32_t samples; // Number of marks that had a previous mark, and thus a latency
+        uint64_t sumUsec; // Sum of the latencies
+        uint32_t maxUsec; // Highest latency
+        uint32_t buckets[PACKET_TRACE_BUCKETS];
+    };
+
+    PacketTrace();
+
+    /** Record that a packet reached a stage */
+    void mark(const meshtastic_MeshPacket *p, Stage stage);
+
+    const StageStats &getStats(Stage stage) const { return stats[stage]; }
+
+    static const char *stageName(Stage stage);
+
+    /** Upper bound in msec of a histogram bucket, UINT32_MAX for the last one */
+    static uint32_t bucketLimitMsec(uint8_t bucket);
+
+    /** Approximate percentile (0-100) of the latency of a stage, as the upper bound of its bucket in msec */
+    uint32_t percentileMsec(Stage stage, uint8_t percentile) const;
+
+    /** Dump the per-stage latency stats to the log */
+    void log() const;
+
+    /** Forget all packets in flight and reset the stats */
+    void clear();
+
+  private:
+    struct InFlight {
+        NodeNum from;
+        PacketId id;
+        uint32_t lastUsec;
+        bool used;
+    };
+
+    InFlight inFlight[PACKET_TRACE_INFLIGHT] = {};
+    StageStats stats[NUM_STAGES] = {};
+
+    InFlight *findOrAdd(const meshtastic_MeshPacket *p, uint32_t now, bool *isNew);
+    void writeTraceLine(const meshtastic_MeshPacket *p, Stage stage, uint32_t now, int32_t deltaUsec);
+};
+
+extern PacketTrace packetTrace;
+
+#define PACKET_TRACE(p, stage) packetTrace.mark(p, PacketTrace::stage)
+
+#else
+
+#define PACKET_TRACE(p, stage)
+
+#endif
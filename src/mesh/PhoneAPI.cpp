@@ -10,6 +10,7 @@
 #include "NodeDB.h"
 #include "PacketHistory.h"
 #include "PhoneAPI.h"
+#include "PhoneAPICache.h"
 #include "PowerFSM.h"
 #include "RadioInterface.h"
 #include "Router.h"
@@ -30,6 +31,50 @@
 #endif
 #include "Throttle.h"
 #include <RTC.h>
+#ifdef ARCH_PORTDUINO
+#include <mutex>
+#endif
+
+// Sync tokens handed out by config_complete_id and the NodeDB change they stand for, see SPECIAL_NONCE_NODES_SYNC
+#define NUM_SYNC_TOKENS 8
+
+// Shared by all PhoneAPI instances, a client may reconnect over another transport
+static struct {
+    uint32_t token;
+    uint32_t seq;
+} syncTokens[NUM_SYNC_TOKENS];
+static uint8_t nextSyncToken;
+
+#ifdef ARCH_PORTDUINO
+// The HTTP API runs its PhoneAPI on the web server threads, and concurrency::Lock does nothing without FreeRTOS
+static std::mutex syncTokensLock;
+#define LOCK_SYNC_TOKENS() std::lock_guard<std::mutex> syncTokensGuard(syncTokensLock)
+#else
+// Every PhoneAPI runs on the main thread
+#define LOCK_SYNC_TOKENS()
+#endif
+
+static uint32_t issueSyncToken(uint32_t seq)
+{
+    LOCK_SYNC_TOKENS();
+    uint32_t token = random(0x10000000, INT32_MAX); // well clear of the SPECIAL_NONCE_* values
+    syncTokens[nextSyncToken].token = token;
+    syncTokens[nextSyncToken].seq = seq;
+    nextSyncToken = (nextSyncToken + 1) % NUM_SYNC_TOKENS;
+    return token;
+}
+
+static bool findSyncToken(uint32_t token, uint32_t &seq)
+{
+    LOCK_SYNC_TOKENS();
+    for (auto &t : syncTokens) {
+        if (t.token && t.token == token) {
+            seq = t.seq;
+            return true;
+        }
+    }
+    return false;
+}
 
 PhoneAPI::PhoneAPI()
 {
@@ -53,11 +98,23 @@ void PhoneAPI::handleStartConfig()
 #endif
     }
 
+    nodeSync = false;
+    nodesSince = 0;
+    if (config_nonce == SPECIAL_NONCE_NODES_SYNC || findSyncToken(config_nonce, nodesSince)) {
+        nodeSyncSeq = nodeDB->updateChangeSeqs();
+        nodeSync = nodeDB->canSyncSince(nodesSince);
+        if (!nodeSync) {
+            LOG_INFO("Sync token of change %u has expired", nodesSince);
+            nodesSince = 0;
+        }
+    }
+    removedSince = nodesSince;
+
     // even if we were already connected - restart our state machine
-    if (config_nonce == SPECIAL_NONCE_ONLY_NODES) {
+    if (config_nonce == SPECIAL_NONCE_ONLY_NODES || nodeSync) {
         // If client only wants node info, jump directly to sending nodes
         state = STATE_SEND_OWN_NODEINFO;
-        LOG_INFO("Client only wants node info, skipping other config");
+        LOG_INFO("Client only wants node info changed since %u, skipping other config", nodesSince);
     } else {
         state = STATE_SEND_MY_INFO;
     }
@@ -68,6 +125,13 @@ void PhoneAPI::handleStartConfig()
     LOG_DEBUG("Got %d files in manifest", filesManifest.size());
 
     LOG_INFO("Start API client config");
+    configStartMsec = millis();
+    configBytes = 0;
+    configFrames = 0;
+    configCacheHits = 0;
+#if HAS_PHONEAPI_CACHE
+    configFingerprint = PhoneAPICache::configFingerprint();
+#endif
     nodeInfoForPhone.num = 0; // Don't keep returning old nodeinfos
     resetReadIndex();
 }
@@ -96,6 +160,7 @@ void PhoneAPI::close()
         fromRadioNum = 0;
         config_nonce = 0;
         config_state = 0;
+        nodeSync = false;
         pauseBluetoothLogging = false;
     }
 }
@@ -117,51 +182,60 @@ bool PhoneAPI::checkConnectionTimeout()
  * Handle a ToRadio protobuf
  */
 bool PhoneAPI::handleToRadio(const uint8_t *buf, size_t bufLength)
+{
+    memset(&toRadioScratch, 0, sizeof(toRadioScratch));
+    if (pb_decode_from_bytes(buf, bufLength, &meshtastic_ToRadio_msg, &toRadioScratch)) {
+        return handleToRadioMessage(toRadioScratch);
+    } else {
+        powerFSM.trigger(EVENT_CONTACT_FROM_PHONE);
+        lastContactMsec = millis();
+        LOG_ERROR("Error: ignore malformed toradio");
+    }
+
+    return false;
+}
+
+bool PhoneAPI::handleToRadioMessage(meshtastic_ToRadio &toRadio)
 {
     powerFSM.trigger(EVENT_CONTACT_FROM_PHONE); // As long as the phone keeps talking to us, don't let the radio go to sleep
     lastContactMsec = millis();
 
-    memset(&toRadioScratch, 0, sizeof(toRadioScratch));
-    if (pb_decode_from_bytes(buf, bufLength, &meshtastic_ToRadio_msg, &toRadioScratch)) {
-        switch (toRadioScratch.which_payload_variant) {
-        case meshtastic_ToRadio_packet_tag:
-            return handleToRadioPacket(toRadioScratch.packet);
-        case meshtastic_ToRadio_want_config_id_tag:
-            config_nonce = toRadioScratch.want_config_id;
-            LOG_INFO("Client wants config, nonce=%u", config_nonce);
-            handleStartConfig();
-            break;
-        case meshtastic_ToRadio_disconnect_tag:
-            LOG_INFO("Disconnect from phone");
-            close();
-            break;
-        case meshtastic_ToRadio_xmodemPacket_tag:
-            LOG_INFO("Got xmodem packet");
+    switch (toRadio.which_payload_variant) {
+    case meshtastic_ToRadio_packet_tag:
+        return handleToRadioPacket(toRadio.packet);
+    case meshtastic_ToRadio_want_config_id_tag:
+        config_nonce = toRadio.want_config_id;
+        LOG_INFO("Client wants config, nonce=%u", config_nonce);
+        handleStartConfig();
+        break;
+    case meshtastic_ToRadio_disconnect_tag:
+        LOG_INFO("Disconnect from phone");
+        close();
+        break;
+    case meshtastic_ToRadio_xmodemPacket_tag:
+        LOG_INFO("Got xmodem packet");
 #ifdef FSCom
-            xModem.handlePacket(toRadioScratch.xmodemPacket);
+        xModem.handlePacket(toRadio.xmodemPacket);
 #endif
-            break;
+        break;
 #if !MESHTASTIC_EXCLUDE_MQTT
-        case meshtastic_ToRadio_mqttClientProxyMessage_tag:
-            LOG_DEBUG("Got MqttClientProxy message");
-            if (mqtt && moduleConfig.mqtt.proxy_to_client_enabled && moduleConfig.mqtt.enabled &&
-                (channels.anyMqttEnabled() || moduleConfig.mqtt.map_reporting_enabled)) {
-                mqtt->onClientProxyReceive(toRadioScratch.mqttClientProxyMessage);
-            } else {
-                LOG_WARN("MqttClientProxy received but proxy is not enabled, no channels have up/downlink, or map reporting "
-                         "not enabled");
-            }
-            break;
-#endif
-        case meshtastic_ToRadio_heartbeat_tag:
-            LOG_DEBUG("Got client heartbeat");
-            break;
-        default:
-            // Ignore nop messages
-            break;
+    case meshtastic_ToRadio_mqttClientProxyMessage_tag:
+        LOG_DEBUG("Got MqttClientProxy message");
+        if (mqtt && moduleConfig.mqtt.proxy_to_client_enabled && moduleConfig.mqtt.enabled &&
+            (channels.anyMqttEnabled() || moduleConfig.mqtt.map_reporting_enabled)) {
+            mqtt->onClientProxyReceive(toRadio.mqttClientProxyMessage);
+        } else {
+            LOG_WARN("MqttClientProxy received but proxy is not enabled, no channels have up/downlink, or map reporting "
+                     "not enabled");
         }
-    } else {
-        LOG_ERROR("Error: ignore malformed toradio");
+        break;
+#endif
+    case meshtastic_ToRadio_heartbeat_tag:
+        LOG_DEBUG("Got client heartbeat");
+        break;
+    default:
+        // Ignore nop messages
+        break;
     }
 
     return false;
@@ -194,6 +268,14 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
     // In case we send a FromRadio packet
     memset(&fromRadioScratch, 0, sizeof(fromRadioScratch));
 
+#if HAS_PHONEAPI_CACHE
+    // The frames of the config download that don't change between clients can come from phoneAPICache
+    PhoneAPICache::Kind cacheKind = PhoneAPICache::CONFIG;
+    uint32_t cacheId = ((uint32_t)state << 8) | config_state;
+    uint32_t cacheFingerprint =
+        (state == STATE_SEND_CHANNELS || state == STATE_SEND_CONFIG || state == STATE_SEND_MODULECONFIG) ? configFingerprint : 0;
+#endif
+
     // Advance states as needed
     switch (state) {
     case STATE_SEND_NOTHING:
@@ -230,7 +312,7 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
             // Should allow us to resume sending NodeInfo in STATE_SEND_OTHER_NODEINFOS
             nodeInfoForPhone.num = 0;
         }
-        if (config_nonce == SPECIAL_NONCE_ONLY_NODES) {
+        if (config_nonce == SPECIAL_NONCE_ONLY_NODES || nodeSync) {
             // If client only wants node info, jump directly to sending nodes
             state = STATE_SEND_OTHER_NODEINFOS;
         } else {
@@ -418,6 +500,11 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
                      nodeInfoForPhone.user.id, nodeInfoForPhone.user.long_name);
             fromRadioScratch.which_payload_variant = meshtastic_FromRadio_node_info_tag;
             fromRadioScratch.node_info = nodeInfoForPhone;
+#if HAS_PHONEAPI_CACHE
+            cacheKind = PhoneAPICache::NODEINFO;
+            cacheId = nodeInfoForPhone.num;
+            cacheFingerprint = nodeInfoFingerprint;
+#endif
             // Stay in current state until done sending nodeinfos
             nodeInfoForPhone.num = 0; // We just consumed a nodeinfo, will need a new one next time
         } else {
@@ -433,7 +520,7 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
         LOG_DEBUG("FromRadio=STATE_SEND_FILEMANIFEST");
         // last element
         if (config_state == filesManifest.size() ||
-            config_nonce == SPECIAL_NONCE_ONLY_NODES) { // also handles an empty filesManifest
+            config_nonce == SPECIAL_NONCE_ONLY_NODES || nodeSync) { // also handles an empty filesManifest
             config_state = 0;
             filesManifest.clear();
             // Skip to complete packet
@@ -487,8 +574,29 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
 
     // Do we have a message from the mesh?
     if (fromRadioScratch.which_payload_variant != 0) {
-        // Encapsulate as a FromRadio packet
-        size_t numbytes = pb_encode_to_bytes(buf, meshtastic_FromRadio_size, &meshtastic_FromRadio_msg, &fromRadioScratch);
+        if (!buf) // In-process transport, the caller takes fromRadioScratch as is
+            return 1;
+
+        size_t numbytes = 0;
+#if HAS_PHONEAPI_CACHE
+        if (cacheFingerprint) {
+            numbytes = phoneAPICache.get(cacheKind, cacheId, cacheFingerprint, buf);
+            if (numbytes)
+                configCacheHits++;
+        }
+#endif
+        if (!numbytes) {
+            // Encapsulate as a FromRadio packet
+            numbytes = pb_encode_to_bytes(buf, meshtastic_FromRadio_size, &meshtastic_FromRadio_msg, &fromRadioScratch);
+#if HAS_PHONEAPI_CACHE
+            if (cacheFingerprint)
+                phoneAPICache.put(cacheKind, cacheId, cacheFingerprint, buf, numbytes);
+#endif
+        }
+        if (state != STATE_SEND_PACKETS) {
+            configBytes += numbytes;
+            configFrames++;
+        }
 
         // VERY IMPORTANT to not print debug messages while writing to fromRadioScratch - because we use that same buffer
         // for logging (when we are encapsulating with protobufs)
@@ -502,8 +610,16 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
 void PhoneAPI::sendConfigComplete()
 {
     LOG_INFO("Config Send Complete");
+    LOG_INFO("Config download took %u ms: %u frames (%u cached), %u bytes", millis() - configStartMsec, configFrames,
+             configCacheHits, configBytes);
     fromRadioScratch.which_payload_variant = meshtastic_FromRadio_config_complete_id_tag;
-    fromRadioScratch.config_complete_id = config_nonce;
+    if (nodeSync) {
+        LOG_INFO("Client is in sync up to NodeDB change %u", nodeSyncSeq);
+        fromRadioScratch.config_complete_id = issueSyncToken(nodeSyncSeq);
+        nodeSync = false;
+    } else {
+        fromRadioScratch.config_complete_id = config_nonce;
+    }
     config_nonce = 0;
     state = STATE_SEND_PACKETS;
     pauseBluetoothLogging = false;
@@ -563,6 +679,9 @@ bool PhoneAPI::available()
     case STATE_SEND_OTHER_NODEINFOS:
         if (nodeInfoForPhone.num == 0) {
             auto nextNode = nodeDB->readNextMeshNode(readIndex);
+            // A delta sync skips the nodes the client already has
+            while (nextNode && nodesSince && nodeDB->getChangeSeq(nextNode->num) <= nodesSince)
+                nextNode = nodeDB->readNextMeshNode(readIndex);
             if (nextNode) {
                 nodeInfoForPhone = TypeConversions::ConvertToNodeInfo(nextNode);
                 bool isUs = nodeInfoForPhone.num == nodeDB->getNodeNum();
@@ -571,6 +690,17 @@ bool PhoneAPI::available()
                 nodeInfoForPhone.snr = isUs ? 0 : nodeInfoForPhone.snr;
                 nodeInfoForPhone.via_mqtt = isUs ? false : nodeInfoForPhone.via_mqtt;
                 nodeInfoForPhone.is_favorite = nodeInfoForPhone.is_favorite || isUs; // Our node is always a favorite
+#if HAS_PHONEAPI_CACHE
+                // Our own entry gets the current time, so it is never taken from the cache
+                nodeInfoFingerprint = isUs ? 0 : PhoneAPICache::fingerprint(nextNode, sizeof(*nextNode));
+#endif
+            } else if (nodesSince) {
+                // followed by the nodes removed since, as a NodeInfo with only the num
+                nodeInfoForPhone = {};
+                nodeInfoForPhone.num = nodeDB->readNextRemovedNode(removedSince);
+#if HAS_PHONEAPI_CACHE
+                nodeInfoFingerprint = 0;
+#endif
             }
         }
         return true; // Always say we have something, because we might need to advance our state machine
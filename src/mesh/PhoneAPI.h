@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Observer.h"
+#include "configuration.h"
 #include "mesh-pb-constants.h"
 #include "meshtastic/portnums.pb.h"
 #include <iterator>
@@ -21,6 +22,15 @@
 #define SPECIAL_NONCE_ONLY_CONFIG 69420
 #define SPECIAL_NONCE_ONLY_NODES 69421 // ( ͡° ͜ʖ ͡°)
 
+/**
+ * Delta NodeDB sync: like SPECIAL_NONCE_ONLY_NODES, but config_complete_id brings a sync token instead of the nonce.
+ * A client that reconnects sends that token as want_config_id, and only gets our own node, the nodes that changed since
+ * and a NodeInfo with nothing but the num for every node removed since, then a config_complete_id with the next token.
+ * If the token is no longer known (reboot, or too many removals since) it is treated as a plain nonce: the client gets
+ * the full config and its own nonce back, and has to start over with SPECIAL_NONCE_NODES_SYNC.
+ */
+#define SPECIAL_NONCE_NODES_SYNC 69422
+
 /**
  * Provides our protobuf based API which phone/PC clients can use to talk to our device
  * over UDP, bluetooth or serial.
@@ -52,6 +62,25 @@ class PhoneAPI
 
     uint8_t config_state = 0;
 
+    // Start, size and cache hits of the current config download, logged once complete
+    uint32_t configStartMsec = 0;
+    uint32_t configBytes = 0;
+    uint16_t configFrames = 0;
+    uint16_t configCacheHits = 0;
+
+    // Node sync of SPECIAL_NONCE_NODES_SYNC or a sync token: nodes up to nodesSince are known to the client
+    bool nodeSync = false;
+    uint32_t nodesSince = 0;
+    uint32_t removedSince = 0; // tombstones sent so far
+    uint32_t nodeSyncSeq = 0;  // what the client will be up to date with once done
+
+#if HAS_PHONEAPI_CACHE
+    /// Fingerprint of the channels and config when the download started, see PhoneAPICache
+    uint32_t configFingerprint = 0;
+    /// Fingerprint of the NodeInfoLite that nodeInfoForPhone was made from, 0 if it must not be cached
+    uint32_t nodeInfoFingerprint = 0;
+#endif
+
     // Hashmap of timestamps for last time we received a packet on the API per portnum
     std::unordered_map<meshtastic_PortNum, uint32_t> lastPortNumToRadio;
     uint32_t recentToRadioPacketIds[20]; // Last 20 ToRadio MeshPacket IDs we have seen
@@ -107,6 +136,12 @@ class PhoneAPI
      */
     virtual bool handleToRadio(const uint8_t *buf, size_t len);
 
+    /**
+     * Handle an already decoded ToRadio, for transports that don't use the protobuf encoding. The message may be modified.
+     * @return true true if a packet was queued for sending (so that caller can yield)
+     */
+    bool handleToRadioMessage(meshtastic_ToRadio &toRadio);
+
     /**
      * Send a (client)notification to the phone
      */
@@ -117,6 +152,8 @@ class PhoneAPI
      *
      * We assume buf is at least FromRadio_size bytes long.
      * Returns number of bytes in the FromRadio packet (or 0 if no packet available)
+     *
+     * If buf is NULL the packet is not encoded, it is left in fromRadioScratch and a non zero value is returned
      */
     size_t getFromRadio(uint8_t *buf);
 
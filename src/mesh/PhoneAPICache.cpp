@@ -0,0 +1,67 @@
+#include "PhoneAPICache.h"
+
+#if HAS_PHONEAPI_CACHE
+
+#include "Channels.h"
+#include "NodeDB.h"
+#include <string.h>
+
+// Nodes that left the NodeDB leave their frames behind, start over when there are clearly too many
+#define PHONEAPI_CACHE_MAX_FRAMES (MAX_NUM_NODES + 64)
+
+PhoneAPICache phoneAPICache;
+
+uint32_t PhoneAPICache::fingerprint(const void *data, size_t len, uint32_t hash)
+{
+    // FNV-1a
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash ? hash : 1;
+}
+
+uint32_t PhoneAPICache::configFingerprint()
+{
+    uint32_t hash = fingerprint(&channelFile, sizeof(channelFile));
+    hash = fingerprint(&config, sizeof(config), hash);
+    return fingerprint(&moduleConfig, sizeof(moduleConfig), hash);
+}
+
+size_t PhoneAPICache::get(Kind kind, uint32_t id, uint32_t fingerprint, uint8_t *buf)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = frames.find(((uint64_t)kind << 32) | id);
+    if (it == frames.end() || it->second.fingerprint != fingerprint) {
+        misses++;
+        return 0;
+    }
+    hits++;
+    memcpy(buf, it->second.bytes.data(), it->second.bytes.size());
+    return it->second.bytes.size();
+}
+
+void PhoneAPICache::put(Kind kind, uint32_t id, uint32_t fingerprint, const uint8_t *buf, size_t len)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (frames.size() >= PHONEAPI_CACHE_MAX_FRAMES)
+        frames.clear();
+    Frame &frame = frames[((uint64_t)kind << 32) | id];
+    frame.fingerprint = fingerprint;
+    frame.bytes.assign((const char *)buf, len);
+}
+
+uint32_t PhoneAPICache::getHits()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return hits;
+}
+
+uint32_t PhoneAPICache::getMisses()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return misses;
+}
+
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "configuration.h"
+
+#if HAS_PHONEAPI_CACHE
+
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Encoded FromRadio frames of the config download, shared by all PhoneAPI clients, so that a client reconnecting streams
+ * frames that were already encoded instead of running pb_encode for every channel, config and NodeInfo again.
+ *
+ * Every frame is stored with a fingerprint of what it was built from (the NodeInfoLite of a node, the channels and config
+ * for the config frames), and is only used while the fingerprint still matches. NodeDB and the config are modified in
+ * place from many places, so this catches every change without having to track them.
+ *
+ * Compiled in on portduino, where the node database can be large and clients (web, TCP, BLE) reconnect often. The HTTP API
+ * runs its PhoneAPI on the web server threads, so every access is serialized.
+ */
+class PhoneAPICache
+{
+  public:
+    enum Kind : uint8_t { CONFIG, NODEINFO };
+
+    /// Fingerprint of the data a frame is built from, never 0
+    static uint32_t fingerprint(const void *data, size_t len, uint32_t hash = 2166136261u);
+
+    /// Fingerprint of the channels, config and module config, for the CONFIG frames
+    static uint32_t configFingerprint();
+
+    /** Copy the frame kept for (kind, id) into buf if it was built from the same data, returns its length or 0 */
+    size_t get(Kind kind, uint32_t id, uint32_t fingerprint, uint8_t *buf);
+
+    /** Keep the frame that was just encoded into buf */
+    void put(Kind kind, uint32_t id, uint32_t fingerprint, const uint8_t *buf, size_t len);
+
+    uint32_t getHits();
+    uint32_t getMisses();
+
+  private:
+    struct Frame {
+        uint32_t fingerprint;
+        std::string bytes;
+    };
+
+    std::unordered_map<uint64_t, Frame> frames;
+    uint32_t hits = 0, misses = 0;
+    std::mutex lock; // concurrency::Lock does nothing without FreeRTOS
+};
+
+extern PhoneAPICache phoneAPICache;
+
+#endif
@@ -3,12 +3,16 @@
 #include "DisplayFormatters.h"
 #include "MeshRadio.h"
 #include "MeshService.h"
+#include "Metrics.h"
 #include "NodeDB.h"
 #include "Router.h"
 #include "configuration.h"
 #include "main.h"
 #include "sleep.h"
 #include <assert.h>
+#if ARCH_PORTDUINO
+#include "platform/portduino/PortduinoGlue.h"
+#endif
 #include <pb_decode.h>
 #include <pb_encode.h>
 
@@ -257,8 +261,13 @@ uint32_t RadioInterface::getRetransmissionMsec(const meshtastic_MeshPacket *p)
     uint32_t packetAirtime = getPacketTime(numbytes + sizeof(PacketHeader));
     // Make sure enough time has elapsed for this packet to be sent and an ACK is received.
     // LOG_DEBUG("Waiting for flooding message with airtime %d and slotTime is %d", packetAirtime, slotTimeMsec);
-    float channelUtil = airTime->channelUtilizationPercent();
-    uint8_t CWsize = map(channelUtil, 0, 100, CWmin, CWmax);
+    uint8_t CWsize;
+    if (isAdaptiveContention()) {
+        CWsize = contentionWindow.getCWsize();
+    } else {
+        float channelUtil = airTime->channelUtilizationPercent();
+        CWsize = map(channelUtil, 0, 100, CWmin, CWmax);
+    }
     // Assuming we pick max. of CWsize and there will be a client with SNR at half the range
     return 2 * packetAirtime + (pow_of_2(CWsize) + 2 * CWmax + pow_of_2(int((CWmax + CWmin) / 2))) * slotTimeMsec +
            PROCESSING_TIME_MSEC;
@@ -269,13 +278,38 @@ uint32_t RadioInterface::getTxDelayMsec()
 {
     /** We wait a random multiple of 'slotTimes' (see definition in header file) in order to avoid collisions.
     The pool to take a random multiple from is the contention window (CW), which size depends on the
-    current channel utilization. */
+    current channel utilization, or is tuned online in adaptive mode. */
+    if (isAdaptiveContention())
+        return random(0, contentionWindow.getWindowSlots()) * slotTimeMsec;
+
     float channelUtil = airTime->channelUtilizationPercent();
     uint8_t CWsize = map(channelUtil, 0, 100, CWmin, CWmax);
     // LOG_DEBUG("Current channel utilization is %f so setting CWsize to %d", channelUtil, CWsize);
     return random(0, pow_of_2(CWsize)) * slotTimeMsec;
 }
 
+#if HAS_METRICS
+void RadioInterface::registerMetrics()
+{
+    const ContentionWindow::Stats &cw = contentionWindow.getStats();
+    metrics.addCounter("meshtastic_cad_total", "Channel activity detections before transmitting", &cw.cadBusy,
+                       "result=\"busy\"");
+    metrics.addCounter("meshtastic_cad_total", "Channel activity detections before transmitting", &cw.cadIdle,
+                       "result=\"idle\"");
+}
+#endif
+
+bool RadioInterface::isAdaptiveContention()
+{
+#ifdef USERPREFS_LORA_ADAPTIVE_CONTENTION
+    return USERPREFS_LORA_ADAPTIVE_CONTENTION;
+#elif ARCH_PORTDUINO
+    return settingsMap[lora_adaptive_contention];
+#else
+    return false;
+#endif
+}
+
 /** The CW size to use when calculating SNR_based delays */
 uint8_t RadioInterface::getCWsize(float snr)
 {
@@ -588,6 +622,7 @@ void RadioInterface::applyModemConfig()
     saveFreq(freq + loraConfig.frequency_offset);
 
     slotTimeMsec = computeSlotTimeMsec();
+    contentionWindow.reset(); // Learned window is in slots of the previous modem config
     preambleTimeMsec = getPacketTime((uint32_t)0);
     maxPacketTimeMsec = getPacketTime(meshtastic_Constants_DATA_PAYLOAD_LEN + sizeof(PacketHeader));
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "ContentionWindow.h"
 #include "MemoryPool.h"
 #include "MeshTypes.h"
 #include "Observer.h"
@@ -95,6 +96,9 @@ class RadioInterface
     const uint8_t CWmin = 3; // minimum CWsize
     const uint8_t CWmax = 8; // maximum CWsize
 
+    /** Online-tuned contention window, only used if isAdaptiveContention() */
+    ContentionWindow contentionWindow = ContentionWindow(CWmin, CWmax);
+
     meshtastic_MeshPacket *sendingPacket = NULL; // The packet we are currently sending
     uint32_t lastTxStart = 0L;
 
@@ -123,6 +127,11 @@ class RadioInterface
      */
     virtual bool canSleep() { return true; }
 
+#if HAS_METRICS
+    /** Register our counters in the metrics registry, called once this is known to be the interface in use */
+    virtual void registerMetrics();
+#endif
+
     virtual bool wideLora() { return false; }
 
     /// Prepare hardware for sleep.  Call this _only_ for deep sleep, not needed for light sleep.
@@ -174,6 +183,11 @@ class RadioInterface
     /** The delay to use when we want to send something */
     uint32_t getTxDelayMsec();
 
+    /** Whether the contention window is tuned from CAD/collision/duplicate outcomes instead of the channel utilization */
+    static bool isAdaptiveContention();
+
+    ContentionWindow &getContentionWindow() { return contentionWindow; }
+
     /** The CW to use when calculating SNR_based delays */
     uint8_t getCWsize(float snr);
 
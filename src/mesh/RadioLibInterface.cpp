@@ -1,6 +1,8 @@
 #include "RadioLibInterface.h"
 #include "MeshTypes.h"
+#include "Metrics.h"
 #include "NodeDB.h"
+#include "PacketTrace.h"
 #include "PowerMon.h"
 #include "SPILock.h"
 #include "Throttle.h"
@@ -12,6 +14,7 @@
 #include <pb_encode.h>
 
 #if ARCH_PORTDUINO
+#include "PacketCapture.h"
 #include "PortduinoGlue.h"
 #include "meshUtils.h"
 #endif
@@ -172,12 +175,18 @@ ErrorCode RadioLibInterface::send(meshtastic_MeshPacket *p)
     printPacket("enqueue for send", p);
 
     LOG_DEBUG("txGood=%d,txRelay=%d,rxGood=%d,rxBad=%d", txGood, txRelay, rxGood, rxBad);
+    if (isAdaptiveContention()) {
+        const ContentionWindow::Stats &cw = contentionWindow.getStats();
+        LOG_DEBUG("CW=%u slots,cadBusy=%u,cadIdle=%u,rxCorrupt=%u,dupe=%u.%u%%", cw.windowSlots, cw.cadBusy, cw.cadIdle,
+                  cw.rxCorrupt, cw.dupePermille / 10, cw.dupePermille % 10);
+    }
     ErrorCode res = txQueue.enqueue(p) ? ERRNO_OK : ERRNO_UNKNOWN;
 
     if (res != ERRNO_OK) { // we weren't able to queue it, so we must drop it to prevent leaks
         packetPool.release(p);
         return res;
     }
+    PACKET_TRACE(p, TX_QUEUED);
 
     // set (random) transmit delay to let others reconfigure their radio,
     // to avoid collisions and implement timing-based flooding
@@ -201,6 +210,19 @@ meshtastic_QueueStatus RadioLibInterface::getQueueStatus()
     return qs;
 }
 
+#if HAS_METRICS
+void RadioLibInterface::registerMetrics()
+{
+    RadioInterface::registerMetrics();
+    metrics.addCounter("meshtastic_rx_good_total", "Packets received from the radio", &rxGood);
+    metrics.addCounter("meshtastic_rx_bad_total", "Corrupted or malformed packets received from the radio", &rxBad);
+    metrics.addCounter("meshtastic_tx_good_total", "Packets transmitted", &txGood);
+    metrics.addCounter("meshtastic_tx_relay_total", "Packets of other nodes transmitted", &txRelay);
+    metrics.addGauge("meshtastic_tx_queue_free", "Free slots in the TX queue",
+                     []() -> float { return RadioLibInterface::instance->getQueueStatus().free; });
+}
+#endif
+
 bool RadioLibInterface::canSleep()
 {
     bool res = txQueue.empty();
@@ -241,7 +263,7 @@ We never immediately transmit after any operation (either Rx or Tx). Instead we
 'slotTimes' (see definition in RadioInterface.h) taken from a contention window (CW) to lower the chance of collision.
 The CW size is determined by setTransmitDelay() and depends either on the current channel utilization or SNR in case
 of a flooding message. After this, we perform channel activity detection (CAD) and reset the transmit delay if it is
-currently active.
+currently active. In adaptive contention mode the CAD outcome is also fed back into the contention window.
 */
 void RadioLibInterface::onNotify(uint32_t notification)
 {
@@ -272,15 +294,19 @@ void RadioLibInterface::onNotify(uint32_t notification)
                     notifyLater(delay_remaining, TRANSMIT_DELAY_COMPLETED, false);
                 } else {
                     if (isChannelActive()) { // check if there is currently a LoRa packet on the channel
-                        startReceive();      // try receiving this packet, afterwards we'll be trying to transmit again
+                        contentionWindow.onChannelBusy();
+                        PACKET_TRACE(txp, TX_CAD_BUSY);
+                        startReceive(); // try receiving this packet, afterwards we'll be trying to transmit again
                         setTransmitDelay();
                     } else {
+                        contentionWindow.onChannelIdle();
                         // Send any outgoing packets we have ready as fast as possible to keep the time between channel scan and
                         // actual transmission as short as possible
                         txp = txQueue.dequeue();
                         assert(txp);
                         bool sent = startSend(txp);
                         if (sent) {
+                            PACKET_TRACE(txp, TX_START);
                             // Packet has been sent, count it toward our TX airtime utilization.
                             uint32_t xmitMsec = getPacketTime(txp);
                             airTime->logAirtime(TX_LOG, xmitMsec);
@@ -382,6 +408,7 @@ void RadioLibInterface::completeSending()
         txGood++;
         if (!isFromUs(p))
             txRelay++;
+        PACKET_TRACE(p, TX_DONE);
         printPacket("Completed sending", p);
 
         // We are done sending that packet, release it
@@ -424,6 +451,7 @@ void RadioLibInterface::handleReceiveInterrupt()
     if (state != RADIOLIB_ERR_NONE) {
         LOG_ERROR("Ignore received packet due to error=%d", state);
         rxBad++;
+        contentionWindow.onReceived(true);
 
         airTime->logAirtime(RX_ALL_LOG, xmitMsec);
 
@@ -435,9 +463,11 @@ void RadioLibInterface::handleReceiveInterrupt()
         if (payloadLen < 0) {
             LOG_WARN("Ignore received packet too short");
             rxBad++;
+            contentionWindow.onReceived(true);
             airTime->logAirtime(RX_ALL_LOG, xmitMsec);
         } else {
             rxGood++;
+            contentionWindow.onReceived(false);
             // altered packet with "from == 0" can do Remote Node Administration without permission
             if (radioBuffer.header.from == 0) {
                 LOG_WARN("Ignore received packet without sender");
@@ -464,6 +494,9 @@ void RadioLibInterface::handleReceiveInterrupt()
             mp->relay_node = mp->hop_start == 0 ? NO_RELAY_NODE : radioBuffer.header.relay_node;
 
             addReceiveMetadata(mp);
+#if ARCH_PORTDUINO
+            packetCapture.writeFrame(PacketCapture::RX, (uint8_t *)&radioBuffer, length, mp->rx_snr, mp->rx_rssi);
+#endif
 
             mp->which_payload_variant =
                 meshtastic_MeshPacket_encrypted_tag; // Mark that the payload is still encrypted at this point
@@ -472,6 +505,7 @@ void RadioLibInterface::handleReceiveInterrupt()
             mp->encrypted.size = payloadLen;
 
             printPacket("Lora RX", mp);
+            PACKET_TRACE(mp, RX);
 
             airTime->logAirtime(RX_LOG, xmitMsec);
 
@@ -526,6 +560,9 @@ bool RadioLibInterface::startSend(meshtastic_MeshPacket *txp)
             // bits
             enableInterrupt(isrTxLevel0);
             lastTxStart = millis();
+#if ARCH_PORTDUINO
+            packetCapture.writeFrame(PacketCapture::TX, (uint8_t *)&radioBuffer, numbytes, 0, 0);
+#endif
             printPacket("Started Tx", txp);
         }
 
@@ -178,6 +178,10 @@ class RadioLibInterface : public RadioInterface, protected concurrency::Notified
 
     meshtastic_QueueStatus getQueueStatus();
 
+#if HAS_METRICS
+    virtual void registerMetrics() override;
+#endif
+
   protected:
     uint32_t activeReceiveStart = 0;
 
@@ -3,8 +3,11 @@
 #include "CryptoEngine.h"
 #include "MeshRadio.h"
 #include "MeshService.h"
+#include "Metrics.h"
 #include "NodeDB.h"
+#include "PacketTrace.h"
 #include "RTC.h"
+#include "TextCompression.h"
 #include "configuration.h"
 #include "detect/LoRaRadioType.h"
 #include "main.h"
@@ -32,7 +35,7 @@
      2) // max number of packets which can be in flight (either queued from reception or queued for sending)
 
 // static MemoryPool<MeshPacket> staticPool(MAX_PACKETS);
-static MemoryDynamic<meshtastic_MeshPacket> staticPool;
+static MemoryDynamic<meshtastic_MeshPacket> staticPool(MemTag::Router);
 
 Allocator<meshtastic_MeshPacket> &packetPool = staticPool;
 
@@ -56,6 +59,16 @@ Router::Router() : concurrency::OSThread("Router"), fromRadioQueue(MAX_RX_FROMRA
     // init Lockguard for crypt operations
     assert(!cryptLock);
     cryptLock = new concurrency::Lock();
+
+#if HAS_METRICS
+    metrics.addCounter("meshtastic_rx_dupe_total", "Duplicate packets received", &rxDupe);
+    metrics.addCounter("meshtastic_tx_relay_canceled_total", "Relays canceled because another node relayed first",
+                       &txRelayCanceled);
+    metrics.addCounter("meshtastic_rx_flood_dropped_total", "Received packets dropped because their sender was over budget",
+                       &floodGuard.dropped[FloodGuard::LOCAL], "budget=\"local\"");
+    metrics.addCounter("meshtastic_rx_flood_dropped_total", "Received packets dropped because their sender was over budget",
+                       &floodGuard.dropped[FloodGuard::RELAY], "budget=\"relay\"");
+#endif
 }
 
 /**
@@ -80,6 +93,8 @@ int32_t Router::runOnce()
  */
 void Router::enqueueReceivedMessage(meshtastic_MeshPacket *p)
 {
+    PACKET_TRACE(p, RX_QUEUED);
+
     // Try enqueue until successful
     while (!fromRadioQueue.enqueue(p, 0)) {
         meshtastic_MeshPacket *old_p;
@@ -421,25 +436,18 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
         if (p->decoded.has_bitfield)
             p->decoded.want_response |= p->decoded.bitfield & BITFIELD_WANT_RESPONSE_MASK;
 
-        /* Not actually ever used.
-        // Decompress if needed. jm
-        if (p->decoded.portnum == meshtastic_PortNum_TEXT_MESSAGE_COMPRESSED_APP) {
-            // Decompress the payload
-            char compressed_in[meshtastic_Constants_DATA_PAYLOAD_LEN] = {};
-            char decompressed_out[meshtastic_Constants_DATA_PAYLOAD_LEN] = {};
-            int decompressed_len;
-
-            memcpy(compressed_in, p->decoded.payload.bytes, p->decoded.payload.size);
-
-            decompressed_len = unishox2_decompress_simple(compressed_in, p->decoded.payload.size, decompressed_out);
-
-            // LOG_DEBUG("**Decompressed length - %d ", decompressed_len);
-
-            memcpy(p->decoded.payload.bytes, decompressed_out, decompressed_len);
-
-            // Switch the port from PortNum_TEXT_MESSAGE_COMPRESSED_APP to PortNum_TEXT_MESSAGE_APP
-            p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
-        } */
+        // Compressed text is only sent as a DM, relays leave it compressed so that it still fits when they send it on
+        if (p->decoded.portnum == meshtastic_PortNum_TEXT_MESSAGE_COMPRESSED_APP && isToUs(p)) {
+            uint8_t text[meshtastic_Constants_DATA_PAYLOAD_LEN];
+            size_t textLen = TextCompression::decompress(p->decoded.payload.bytes, p->decoded.payload.size, text, sizeof(text));
+            if (textLen > 0) {
+                memcpy(p->decoded.payload.bytes, text, textLen);
+                p->decoded.payload.size = textLen;
+                p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+            } else {
+                LOG_WARN("Invalid compressed text from 0x%x", p->from);
+            }
+        }
 
         printPacket("decoded message", p);
 #if ENABLE_JSON_LOGGING
@@ -474,40 +482,6 @@ meshtastic_Routing_Error perhapsEncode(meshtastic_MeshPacket *p)
 
         size_t numbytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_Data_msg, &p->decoded);
 
-        /* Not actually used, so save the cycles
-        //  TODO: Allow modules to opt into compression.
-        if (p->decoded.portnum == meshtastic_PortNum_TEXT_MESSAGE_APP) {
-
-            char original_payload[meshtastic_Constants_DATA_PAYLOAD_LEN];
-            memcpy(original_payload, p->decoded.payload.bytes, p->decoded.payload.size);
-
-            char compressed_out[meshtastic_Constants_DATA_PAYLOAD_LEN] = {0};
-
-            int compressed_len;
-            compressed_len = unishox2_compress_simple(original_payload, p->decoded.payload.size, compressed_out);
-
-            LOG_DEBUG("Original length - %d ", p->decoded.payload.size);
-            LOG_DEBUG("Compressed length - %d ", compressed_len);
-            LOG_DEBUG("Original message - %s ", p->decoded.payload.bytes);
-
-            // If the compressed length is greater than or equal to the original size, don't use the compressed form
-            if (compressed_len >= p->decoded.payload.size) {
-
-                LOG_DEBUG("Not using compressing message");
-                // Set the uncompressed payload variant anyway. Shouldn't hurt?
-                // p->decoded.which_payloadVariant = Data_payload_tag;
-
-                // Otherwise we use the compressor
-            } else {
-                LOG_DEBUG("Use compressed message");
-                // Copy the compressed data into the meshpacket
-
-                p->decoded.payload.size = compressed_len;
-                memcpy(p->decoded.payload.bytes, compressed_out, compressed_len);
-
-                p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_COMPRESSED_APP;
-            }
-        } */
 
         if (numbytes + MESHTASTIC_HEADER_LENGTH > MAX_LORA_PAYLOAD_LEN)
             return meshtastic_Routing_Error_TOO_LARGE;
@@ -614,6 +588,7 @@ NodeNum Router::getNodeNum()
  */
 void Router::handleReceived(meshtastic_MeshPacket *p, RxSource src)
 {
+    PACKET_TRACE(p, RX_HANDLED);
     bool skipHandle = false;
     // Also, we should set the time from the ISR and it should have msec level resolution
     p->rx_time = getValidTime(RTCQualityFromNet); // store the arrival timestamp for the phone
@@ -666,6 +641,7 @@ void Router::handleReceived(meshtastic_MeshPacket *p, RxSource src)
     // call modules here
     if (!skipHandle) {
         MeshModule::callModules(*p, src);
+        PACKET_TRACE(p, MODULES_DONE);
 
 #if !MESHTASTIC_EXCLUDE_MQTT
         // Mark as pki_encrypted if it is not yet decoded and MQTT encryption is also enabled, hash matches and it's a DM not to
@@ -722,6 +698,14 @@ void Router::perhapsHandleReceived(meshtastic_MeshPacket *p)
         return;
     }
 
+    // Only new packets spend the budget of their sender. Checked before shouldFilterReceived() records the packet, so a
+    // dropped packet isn't taken for a duplicate (and acked or relayed) when it is sent again. Dropped silently: answering
+    // would make us transmit once per packet of the flooder, a want_ack sender retries and gets through once it is in budget
+    if (floodGuard.isEnabled() && !wasSeenRecentlyNoUpdate(p) && !floodGuard.allow(p)) {
+        packetPool.release(p);
+        return;
+    }
+
     if (shouldFilterReceived(p)) {
         LOG_DEBUG("Incoming msg was filtered from 0x%x", p->from);
         packetPool.release(p);
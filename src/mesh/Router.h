@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Channels.h"
+#include "FloodGuard.h"
 #include "MemoryPool.h"
 #include "MeshTypes.h"
 #include "Observer.h"
@@ -91,6 +92,13 @@ class Router : protected concurrency::OSThread, protected PacketHistory
         before us */
     uint32_t rxDupe = 0, txRelayCanceled = 0;
 
+    /// Per sender budgets of received packets, checked before we decrypt them
+    FloodGuard floodGuard;
+
+    /** Whether we already received or sent this packet, without recording it.  For interfaces that bring in copies of
+     * packets the radio may have received too */
+    bool wasSeenRecentlyNoUpdate(const meshtastic_MeshPacket *p) { return wasSeenRecently(p, false); }
+
   protected:
     friend class RoutingModule;
 
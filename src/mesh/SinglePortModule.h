@@ -23,6 +23,9 @@ class SinglePortModule : public MeshModule
      */
     virtual bool wantPacket(const meshtastic_MeshPacket *p) override { return p->decoded.portnum == ourPortNum; }
 
+    /// Read when the dispatch tables are built, because some modules only pick ourPortNum in their own constructor
+    virtual meshtastic_PortNum getPortNum() override { return ourPortNum; }
+
     /**
      * Return a mesh packet which has been preinited as a data packet with a particular port number.
      * You can then send this packet (after customizing any of the payload fields you might need) with
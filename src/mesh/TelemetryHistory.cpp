@@ -0,0 +1,375 @@
+#include "TelemetryHistory.h"
+
+#if HAS_TELEMETRY_HISTORY
+#include <math.h>
+#include <string.h>
+
+TelemetryHistory *telemetryHistory;
+
+#define EMPTY_SLOT 0xffff
+#define MAX_VARINT 5 // Bytes of the longest uint32_t varint
+
+static const struct {
+    const char *name;
+    float scale; // Stored as round(value * scale)
+} metricInfo[TelemetryHistory::NUM_METRICS] = {
+    {"battery_level", 1},         // %
+    {"voltage", 1000},            // mV
+    {"channel_utilization", 100}, // 1/100 %
+    {"air_util_tx", 100},         // 1/100 %
+    {"temperature", 100},         // 1/100 °C
+    {"relative_humidity", 100},   // 1/100 %
+    {"barometric_pressure", 10},  // 1/10 hPa
+    {"ch1_voltage", 1000},        // mV
+    {"ch1_current", 10},          // 1/10 mA
+};
+
+static const char *tierNames[TelemetryHistory::NUM_TIERS] = {"raw", "1m", "15m"};
+
+// Length in seconds of the periods averaged into the minute and 15 minute tiers
+static const uint32_t periodSecs[TelemetryHistory::NUM_TIERS - 1] = {60, 15 * 60};
+
+static size_t putVarint(uint8_t *buf, uint32_t v)
+{
+    size_t len = 0;
+    while (v >= 0x80) {
+        buf[len++] = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    buf[len++] = v;
+    return len;
+}
+
+static size_t getVarint(const uint8_t *buf, size_t length, uint32_t &v)
+{
+    v = 0;
+    for (size_t i = 0; i < length && i < MAX_VARINT; i++) {
+        v |= (uint32_t)(buf[i] & 0x7f) << (7 * i);
+        if (!(buf[i] & 0x80))
+            return i + 1;
+    }
+    return 0; // Truncated, can't happen unless the block is corrupt
+}
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+TelemetryHistory::TelemetryHistory(size_t maxBytes)
+{
+    // Each series costs its own size and two index slots
+    maxSeries = maxBytes / (sizeof(Series) + 2 * sizeof(uint16_t));
+    if (maxSeries > EMPTY_SLOT - 1)
+        maxSeries = EMPTY_SLOT - 1;
+    if (maxSeries > 0) {
+        series = new Series[maxSeries]();
+        indexSize = 2 * maxSeries;
+        index = new uint16_t[indexSize];
+    }
+    clear();
+    LOG_INFO("Telemetry history has room for %u series of %u bytes", maxSeries, sizeof(Series));
+}
+
+TelemetryHistory::~TelemetryHistory()
+{
+    delete[] series;
+    delete[] index;
+}
+
+void TelemetryHistory::clear()
+{
+#ifdef ARCH_PORTDUINO
+    std::lock_guard<std::mutex> guard(lock);
+#endif
+    numSeries = 0;
+    for (size_t i = 0; i < indexSize; i++)
+        index[i] = EMPTY_SLOT;
+}
+
+size_t TelemetryHistory::getMemoryUsage() const
+{
+    return maxSeries * sizeof(Series) + indexSize * sizeof(uint16_t);
+}
+
+void TelemetryHistory::record(NodeNum node, const meshtastic_Telemetry &t, uint32_t time)
+{
+    switch (t.which_variant) {
+    case meshtastic_Telemetry_device_metrics_tag: {
+        const meshtastic_DeviceMetrics &m = t.variant.device_metrics;
+        if (m.has_battery_level)
+            record(node, BATTERY_LEVEL, time, m.battery_level);
+        if (m.has_voltage)
+            record(node, VOLTAGE, time, m.voltage);
+        if (m.has_channel_utilization)
+            record(node, CHANNEL_UTILIZATION, time, m.channel_utilization);
+        if (m.has_air_util_tx)
+            record(node, AIR_UTIL_TX, time, m.air_util_tx);
+        break;
+    }
+    case meshtastic_Telemetry_environment_metrics_tag: {
+        const meshtastic_EnvironmentMetrics &m = t.variant.environment_metrics;
+        if (m.has_temperature)
+            record(node, TEMPERATURE, time, m.temperature);
+        if (m.has_relative_humidity)
+            record(node, RELATIVE_HUMIDITY, time, m.relative_humidity);
+        if (m.has_barometric_pressure)
+            record(node, BAROMETRIC_PRESSURE, time, m.barometric_pressure);
+        break;
+    }
+    case meshtastic_Telemetry_power_metrics_tag: {
+        const meshtastic_PowerMetrics &m = t.variant.power_metrics;
+        if (m.has_ch1_voltage)
+            record(node, CH1_VOLTAGE, time, m.ch1_voltage);
+        if (m.has_ch1_current)
+            record(node, CH1_CURRENT, time, m.ch1_current);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void TelemetryHistory::record(NodeNum node, Metric metric, uint32_t time, float value)
+{
+    if (metric >= NUM_METRICS || isnan(value))
+        return;
+#ifdef ARCH_PORTDUINO
+    std::lock_guard<std::mutex> guard(lock);
+#endif
+    Series *s = findOrAdd(node, metric);
+    if (!s)
+        return;
+    s->lastUpdateMsec = millis();
+    add(*s, RAW, time, (int32_t)lroundf(value * metricInfo[metric].scale));
+}
+
+/// Store a sample in a tier, and fold it into the average of the next one
+void TelemetryHistory::add(Series &s, Tier tier, uint32_t time, int32_t value)
+{
+    append(s.tiers[tier], time, value);
+    if (tier + 1 >= NUM_TIERS)
+        return;
+
+    Accumulator &a = s.pending[tier];
+    uint32_t periodStart = time - time % periodSecs[tier];
+    if (a.count > 0 && periodStart != a.periodStart) {
+        // The period is over, its average goes into the next tier
+        int32_t average = (int32_t)(a.sum / (int64_t)a.count);
+        a.count = 0;
+        add(s, (Tier)(tier + 1), a.periodStart, average);
+    }
+    if (a.count == 0) {
+        a.periodStart = periodStart;
+        a.sum = 0;
+    }
+    a.sum += value;
+    a.count++;
+}
+
+void TelemetryHistory::append(TierData &t, uint32_t time, int32_t value)
+{
+    uint8_t buf[2 * MAX_VARINT];
+    size_t len;
+
+    if (t.count > 0 && time >= t.lastTime) {
+        Block &b = t.blocks[(t.first + t.count - 1) % TELEMETRY_HISTORY_BLOCKS];
+        len = putVarint(buf, time - t.lastTime);
+        len += putVarint(buf + len, zigzag(value - t.lastValue));
+        if (b.length + len <= TELEMETRY_HISTORY_BLOCK_SIZE) {
+            memcpy(b.bytes + b.length, buf, len);
+            b.length += len;
+            t.lastTime = time;
+            t.lastValue = value;
+            return;
+        }
+    }
+
+    // Start a new block with the absolute time and value, dropping the oldest if all are in use
+    if (t.count == TELEMETRY_HISTORY_BLOCKS) {
+        t.first = (t.first + 1) % TELEMETRY_HISTORY_BLOCKS;
+        t.count--;
+    }
+    Block &b = t.blocks[(t.first + t.count) % TELEMETRY_HISTORY_BLOCKS];
+    t.count++;
+    len = putVarint(buf, time);
+    len += putVarint(buf + len, zigzag(value));
+    memcpy(b.bytes, buf, len);
+    b.length = len;
+    t.lastTime = time;
+    t.lastValue = value;
+}
+
+/// Decode the samples of a tier, skipping the first skip ones. With out NULL it only counts them.
+size_t TelemetryHistory::decode(const TierData &t, Sample *out, size_t skip, size_t maxSamples, float scale)
+{
+    size_t n = 0, seen = 0;
+    for (uint8_t i = 0; i < t.count; i++) {
+        const Block &b = t.blocks[(t.first + i) % TELEMETRY_HISTORY_BLOCKS];
+        uint32_t time = 0;
+        int32_t value = 0;
+        size_t pos = 0;
+        while (pos < b.length) {
+            uint32_t dt, dv;
+            size_t len = getVarint(b.bytes + pos, b.length - pos, dt);
+            if (len == 0)
+                break;
+            pos += len;
+            len = getVarint(b.bytes + pos, b.length - pos, dv);
+            if (len == 0)
+                break;
+            pos += len;
+            time += dt; // The first sample of a block is relative to 0
+            value += unzigzag(dv);
+
+            if (seen++ < skip)
+                continue;
+            if (out) {
+                if (n == maxSamples)
+                    return n;
+                out[n] = {time, value / scale};
+            }
+            n++;
+        }
+    }
+    return n;
+}
+
+size_t TelemetryHistory::query(NodeNum node, Metric metric, Tier tier, Sample *out, size_t maxSamples) const
+{
+#ifdef ARCH_PORTDUINO
+    std::lock_guard<std::mutex> guard(lock);
+#endif
+    const Series *s = metric < NUM_METRICS && tier < NUM_TIERS ? find(node, metric) : NULL;
+    if (!s || maxSamples == 0)
+        return 0;
+
+    float scale = metricInfo[metric].scale;
+    const TierData &t = s->tiers[tier];
+    const Accumulator *pending = tier > RAW && s->pending[tier - 1].count > 0 ? &s->pending[tier - 1] : NULL;
+
+    // Only the newest maxSamples, leaving room for the period in progress
+    size_t total = decode(t, NULL, 0, SIZE_MAX, scale) + (pending ? 1 : 0);
+    size_t skip = total > maxSamples ? total - maxSamples : 0;
+    size_t n = decode(t, out, skip, maxSamples, scale);
+    if (pending && n < maxSamples)
+        out[n++] = {pending->periodStart, (float)(pending->sum / (int64_t)pending->count) / scale};
+    return n;
+}
+
+uint32_t TelemetryHistory::metricsOf(NodeNum node) const
+{
+#ifdef ARCH_PORTDUINO
+    std::lock_guard<std::mutex> guard(lock);
+#endif
+    uint32_t metrics = 0;
+    for (uint8_t m = 0; m < NUM_METRICS; m++) {
+        if (find(node, (Metric)m))
+            metrics |= 1 << m;
+    }
+    return metrics;
+}
+
+size_t TelemetryHistory::slotOf(NodeNum node, Metric metric) const
+{
+    uint32_t h = (node ^ (node >> 16)) * 0x45d9f3b + metric;
+    return (h ^ (h >> 16)) % indexSize;
+}
+
+TelemetryHistory::Series *TelemetryHistory::find(NodeNum node, Metric metric) const
+{
+    if (indexSize == 0)
+        return NULL;
+    for (size_t slot = slotOf(node, metric);; slot = (slot + 1) % indexSize) {
+        uint16_t i = index[slot];
+        if (i == EMPTY_SLOT)
+            return NULL;
+        if (series[i].node == node && series[i].metric == metric)
+            return &series[i];
+    }
+}
+
+TelemetryHistory::Series *TelemetryHistory::findOrAdd(NodeNum node, Metric metric)
+{
+    Series *s = find(node, metric);
+    if (s || maxSeries == 0)
+        return s;
+
+    bool rebuild = false;
+    if (numSeries < maxSeries) {
+        s = &series[numSeries++];
+    } else {
+        // Drop the series we heard of least recently
+        uint32_t now = millis();
+        s = &series[0];
+        for (size_t i = 1; i < numSeries; i++) {
+            if (now - series[i].lastUpdateMsec > now - s->lastUpdateMsec)
+                s = &series[i];
+        }
+        evicted++;
+        rebuild = true;
+    }
+    memset(s, 0, sizeof(*s));
+    s->node = node;
+    s->metric = metric;
+
+    if (rebuild) {
+        rebuildIndex();
+    } else {
+        size_t slot = slotOf(node, metric);
+        while (index[slot] != EMPTY_SLOT)
+            slot = (slot + 1) % indexSize;
+        index[slot] = s - series;
+    }
+    return s;
+}
+
+void TelemetryHistory::rebuildIndex()
+{
+    for (size_t i = 0; i < indexSize; i++)
+        index[i] = EMPTY_SLOT;
+    for (size_t i = 0; i < numSeries; i++) {
+        size_t slot = slotOf(series[i].node, series[i].metric);
+        while (index[slot] != EMPTY_SLOT)
+            slot = (slot + 1) % indexSize;
+        index[slot] = i;
+    }
+}
+
+const char *TelemetryHistory::metricName(Metric metric)
+{
+    return metric < NUM_METRICS ? metricInfo[metric].name : "unknown";
+}
+
+bool TelemetryHistory::metricByName(const char *name, Metric &metric)
+{
+    for (uint8_t m = 0; m < NUM_METRICS; m++) {
+        if (strcmp(name, metricInfo[m].name) == 0) {
+            metric = (Metric)m;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *TelemetryHistory::tierName(Tier tier)
+{
+    return tier < NUM_TIERS ? tierNames[tier] : "unknown";
+}
+
+bool TelemetryHistory::tierByName(const char *name, Tier &tier)
+{
+    for (uint8_t t = 0; t < NUM_TIERS; t++) {
+        if (strcmp(name, tierNames[t]) == 0) {
+            tier = (Tier)t;
+            return true;
+        }
+    }
+    return false;
+}
+#endif
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "configuration.h"
+
+#if HAS_TELEMETRY_HISTORY
+#include "mesh/generated/meshtastic/telemetry.pb.h"
+#ifdef ARCH_PORTDUINO
+#include <mutex>
+#endif
+
+#define TELEMETRY_HISTORY_BLOCK_SIZE 64 // Bytes of one block of compressed samples
+#define TELEMETRY_HISTORY_BLOCKS 4      // Blocks per tier of a series, the oldest is dropped when a new one is needed
+
+// Most samples a tier can hold: every sample takes at least two bytes, plus the period in progress
+#define TELEMETRY_HISTORY_MAX_SAMPLES (TELEMETRY_HISTORY_BLOCKS * TELEMETRY_HISTORY_BLOCK_SIZE / 2 + 1)
+
+/**
+ * Bounded history of the telemetry of every node, so clients can ask for it instead of having to record everything
+ * themselves.
+ *
+ * There is one series per node and metric, each with three tiers: every sample as received, averages per minute and
+ * averages per 15 minutes. A tier is a ring of a few fixed-size blocks. A block starts with the absolute time and value of
+ * its first sample, the following ones are stored as varint deltas to the previous one. Values are kept as integers in the
+ * unit of the metric times its scale (e.g. mV for voltages).
+ *
+ * All memory is allocated up front from the ceiling given to the constructor, set by TELEMETRY_HISTORY_BYTES per platform.
+ * When all series are in use, the one updated least recently is dropped for a new one.
+ */
+class TelemetryHistory
+{
+  public:
+    enum Metric : uint8_t {
+        BATTERY_LEVEL,
+        VOLTAGE,
+        CHANNEL_UTILIZATION,
+        AIR_UTIL_TX,
+        TEMPERATURE,
+        RELATIVE_HUMIDITY,
+        BAROMETRIC_PRESSURE,
+        CH1_VOLTAGE,
+        CH1_CURRENT,
+        NUM_METRICS
+    };
+
+    enum Tier : uint8_t { RAW, ONE_MINUTE, FIFTEEN_MINUTES, NUM_TIERS };
+
+    struct Sample {
+        uint32_t time; // Seconds since 1970, or since boot if we had no time
+        float value;
+    };
+
+    explicit TelemetryHistory(size_t maxBytes);
+    ~TelemetryHistory();
+
+    TelemetryHistory(const TelemetryHistory &) = delete;
+    TelemetryHistory &operator=(const TelemetryHistory &) = delete;
+
+    /** Record every metric the telemetry has */
+    void record(NodeNum node, const meshtastic_Telemetry &t, uint32_t time);
+
+    void record(NodeNum node, Metric metric, uint32_t time, float value);
+
+    /**
+     * Copy the newest samples of a tier, oldest first, at most maxSamples. The minute and 15 minute tiers end with the
+     * average so far of the period that is not over yet. Returns the number of samples copied.
+     */
+    size_t query(NodeNum node, Metric metric, Tier tier, Sample *out, size_t maxSamples) const;
+
+    /** The metrics we have a history of for a node, bit 1 << Metric each */
+    uint32_t metricsOf(NodeNum node) const;
+
+    size_t getNumSeries() const { return numSeries; }
+    size_t getMaxSeries() const { return maxSeries; }
+
+    /** Bytes allocated, never more than the ceiling */
+    size_t getMemoryUsage() const;
+
+    void clear();
+
+    static const char *metricName(Metric metric);
+    static bool metricByName(const char *name, Metric &metric);
+    static const char *tierName(Tier tier);
+    static bool tierByName(const char *name, Tier &tier);
+
+    /// Series dropped to make room for new ones
+    uint32_t evicted = 0;
+
+  private:
+    struct Block {
+        uint8_t length;
+        uint8_t bytes[TELEMETRY_HISTORY_BLOCK_SIZE];
+    };
+
+    struct TierData {
+        Block blocks[TELEMETRY_HISTORY_BLOCKS];
+        uint8_t first; // Oldest block
+        uint8_t count; // Blocks in use
+        uint32_t lastTime;
+        int32_t lastValue; // What the next delta is from
+    };
+
+    /// Averages the samples of one period for the next tier
+    struct Accumulator {
+        uint32_t periodStart;
+        uint32_t count;
+        int64_t sum;
+    };
+
+    struct Series {
+        NodeNum node;
+        Metric metric;
+        uint32_t lastUpdateMsec;
+        TierData tiers[NUM_TIERS];
+        Accumulator pending[NUM_TIERS - 1];
+    };
+
+#ifdef ARCH_PORTDUINO
+    // The native web server queries from its own threads
+    mutable std::mutex lock;
+#endif
+
+    Series *series = NULL;
+    size_t numSeries = 0;
+    size_t maxSeries = 0;
+
+    // Open addressing hash of (node, metric) to series index, twice the size of series
+    uint16_t *index = NULL;
+    size_t indexSize = 0;
+
+    Series *find(NodeNum node, Metric metric) const;
+    Series *findOrAdd(NodeNum node, Metric metric);
+    size_t slotOf(NodeNum node, Metric metric) const;
+    void rebuildIndex();
+
+    void add(Series &s, Tier tier, uint32_t time, int32_t value);
+    void append(TierData &t, uint32_t time, int32_t value);
+    static size_t decode(const TierData &t, Sample *out, size_t skip, size_t maxSamples, float scale);
+};
+
+extern TelemetryHistory *telemetryHistory;
+
+#endif
@@ -0,0 +1,12 @@
+#include "TextCompression.h"
+#include "mesh/compression/unishox2.h"
+
+size_t TextCompression::decompress(const uint8_t *in, size_t len, uint8_t *out, size_t outSize)
+{
+    if (len == 0)
+        return 0;
+    int textLen = unishox2_decompress((const char *)in, len, (char *)out, outSize, USX_PSET_DFLT);
+    if (textLen <= 0 || (size_t)textLen > outSize)
+        return 0;
+    return textLen;
+}
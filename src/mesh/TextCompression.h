@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Unishox2 decompression of the payload of TEXT_MESSAGE_COMPRESSED_APP packets, which some clients send.
+ *
+ * We never compress ourselves: older firmware can't read it and there is no capability bit to tell which nodes can.
+ */
+class TextCompression
+{
+  public:
+    /// Decompress len bytes into out, returns the size of the text or 0 if it is corrupt or larger than outSize
+    static size_t decompress(const uint8_t *in, size_t len, uint8_t *out, size_t outSize);
+};
@@ -64,61 +64,139 @@ template <class T> class TypedQueue
 
 #else
 
-#include <queue>
+#include <atomic>
 
 /**
- * A wrapper for freertos queues.  Note: each element object should be small
- * and POD (Plain Old Data type) as elements are memcpied by value.
+ * Fixed-capacity lock-free ring with the same API as the freertos queues, for platforms without freertos. Safe with several
+ * producer and consumer threads (on meshtasticd the web server and UDP threads enqueue next to the main loop), and nothing is
+ * allocated after construction.
+ *
+ * Every slot carries a sequence number telling whether it is free for the producer at a given position or holds the element
+ * for the consumer at that position, so producers and consumers only contend on their own index.
+ *
+ * The capacity is maxElements rounded up to a power of 2. Like the freertos version it never blocks, maxWait is ignored.
  */
 template <class T> class TypedQueue
 {
-    std::queue<T> q;
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        T data;
+    };
+
+    Slot *slots;
+    uint32_t mask;
     concurrency::OSThread *reader = NULL;
-    int maxElements;
 
-  public:
-    explicit TypedQueue(int _maxElements) : maxElements(_maxElements) {}
+    // Producers and consumers each get their own cache line
+    alignas(64) std::atomic<uint32_t> enqueuePos{0};
+    alignas(64) std::atomic<uint32_t> dequeuePos{0};
 
-    int numFree()
+    bool push(const T &x)
     {
-        if (maxElements <= 0)
-            return 1; // Always claim 1 free, because we can grow to any size
-        return maxElements - numUsed();
+        uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &slot = slots[pos & mask];
+            int32_t diff = (int32_t)(slot.sequence.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.data = x;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
     }
 
-    bool isEmpty() { return q.empty(); }
+    bool pop(T *p)
+    {
+        uint32_t pos = dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &slot = slots[pos & mask];
+            int32_t diff = (int32_t)(slot.sequence.load(std::memory_order_acquire) - (pos + 1));
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    *p = slot.data;
+                    slot.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Empty
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+  public:
+    explicit TypedQueue(int maxElements)
+    {
+        assert(maxElements > 0);
+        uint32_t capacity = 2; // One slot would not tell full from empty
+        while (capacity < (uint32_t)maxElements)
+            capacity <<= 1;
+        mask = capacity - 1;
+        slots = new Slot[capacity];
+        for (uint32_t i = 0; i < capacity; i++)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    ~TypedQueue() { delete[] slots; }
+
+    TypedQueue(const TypedQueue &) = delete;
+    TypedQueue &operator=(const TypedQueue &) = delete;
+
+    int numFree() { return (int)(mask + 1) - numUsed(); }
+
+    bool isEmpty() { return numUsed() == 0; }
 
-    int numUsed() { return q.size(); }
+    /// Exact when no other thread is using the queue, otherwise a snapshot
+    int numUsed()
+    {
+        uint32_t tail = dequeuePos.load(std::memory_order_acquire);
+        uint32_t used = enqueuePos.load(std::memory_order_acquire) - tail;
+        return used > mask + 1 ? mask + 1 : used;
+    }
 
     bool enqueue(T x, TickType_t maxWait = portMAX_DELAY)
     {
-        if (numFree() <= 0)
+        if (!push(x))
             return false;
 
         if (reader) {
             reader->setInterval(0);
             concurrency::mainDelay.interrupt();
         }
-
-        q.push(x);
         return true;
     }
 
-    // bool enqueueFromISR(T x, BaseType_t *higherPriWoken) { return xQueueSendToBackFromISR(h, &x, higherPriWoken) == pdTRUE; }
-
-    bool dequeue(T *p, TickType_t maxWait = portMAX_DELAY)
+    bool enqueueFromISR(T x, BaseType_t *higherPriWoken)
     {
-        if (isEmpty())
+        if (!push(x))
             return false;
-        else {
-            *p = q.front();
-            q.pop();
-            return true;
+
+        if (reader) {
+            reader->setInterval(0);
+            concurrency::mainDelay.interruptFromISR(higherPriWoken);
         }
+        return true;
     }
 
-    // bool dequeueFromISR(T *p, BaseType_t *higherPriWoken) { return xQueueReceiveFromISR(h, p, higherPriWoken); }
+    bool dequeue(T *p, TickType_t maxWait = portMAX_DELAY) { return pop(p); }
+
+    bool dequeueFromISR(T *p, BaseType_t *higherPriWoken) { return pop(p); }
 
+    /**
+     * Set a thread that is reading from this queue
+     * If a message is pushed to this queue that thread will be scheduled to run ASAP.
+     *
+     * Note: thread will not be automatically enabled, just have its interval set to 0
+     */
     void setReader(concurrency::OSThread *t) { reader = t; }
 };
 #endif
\ No newline at end of file
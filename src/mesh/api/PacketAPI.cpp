@@ -90,9 +90,8 @@ bool PacketAPI::receivePacket(void)
 bool PacketAPI::sendPacket(void)
 {
     if (server->available()) {
-        // fill dummy buffer; we don't use it, we directly send the fromRadio structure
-        uint32_t len = getFromRadio(txBuf);
-        if (len != 0) {
+        // we don't need the protobuf encoding, we directly send the fromRadio structure
+        if (getFromRadio(NULL) != 0) {
             static uint32_t id = 0;
             fromRadioScratch.id = ++id;
             bool result = server->sendPacket(DataPacket<meshtastic_FromRadio>(id, fromRadioScratch));
@@ -0,0 +1,293 @@
+#ifdef PORTDUINO_LINUX_HARDWARE
+
+#include "api/ShmPacketAPI.h"
+#include "configuration.h"
+#include "main.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+ShmPacketAPI *shmPacketAPI = nullptr;
+
+ShmPacketAPI *ShmPacketAPI::create(const char *name)
+{
+    if (!shmPacketAPI) {
+        shmPacketAPI = new ShmPacketAPI(name);
+        if (!shmPacketAPI->init()) {
+            delete shmPacketAPI;
+            shmPacketAPI = nullptr;
+        }
+    }
+    return shmPacketAPI;
+}
+
+ShmPacketAPI::ShmPacketAPI(const char *name) : concurrency::OSThread("ShmPacketAPI"), shmName(name)
+{
+    if (shmName[0] != '/')
+        shmName = "/" + shmName;
+    socketPath = "/tmp" + shmName + ".sock";
+}
+
+ShmPacketAPI::~ShmPacketAPI()
+{
+    if (waitThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(waitLock);
+            stopping = true;
+            waitChanged.notify_all();
+        }
+        uint64_t one = 1;
+        (void)!write(wakeEvent, &one, sizeof(one));
+        waitThread.join();
+    }
+    if (wakeEvent >= 0)
+        ::close(wakeEvent);
+    closeClient();
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        unlink(socketPath.c_str());
+    }
+    if (region)
+        munmap(region, sizeof(ShmPacketRegion));
+    if (shmFd >= 0) {
+        ::close(shmFd);
+        shm_unlink(shmName.c_str());
+    }
+}
+
+bool ShmPacketAPI::init()
+{
+    // Never reuse a segment somebody else may have created with other permissions
+    shm_unlink(shmName.c_str());
+    shmFd = shm_open(shmName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+    if (shmFd < 0 || ftruncate(shmFd, sizeof(ShmPacketRegion)) != 0) {
+        LOG_ERROR("ShmPacketAPI can't create %s: %s", shmName.c_str(), strerror(errno));
+        return false;
+    }
+    void *p = mmap(NULL, sizeof(ShmPacketRegion), PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    if (p == MAP_FAILED) {
+        LOG_ERROR("ShmPacketAPI can't map %s: %s", shmName.c_str(), strerror(errno));
+        return false;
+    }
+    region = (ShmPacketRegion *)p;
+    region->magic = SHM_PACKET_API_MAGIC;
+    region->version = SHM_PACKET_API_VERSION;
+    region->slotSize = sizeof(ShmPacketSlot::data);
+    region->fromRadio.reset();
+    region->toRadio.reset();
+
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socketPath.c_str());
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    // Restrict the socket before listening, so no other user can ever connect
+    if (listenFd < 0 || bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || chmod(socketPath.c_str(), 0660) != 0 ||
+        listen(listenFd, 1) != 0) {
+        LOG_ERROR("ShmPacketAPI can't listen on %s: %s", socketPath.c_str(), strerror(errno));
+        return false;
+    }
+
+    wakeEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeEvent < 0) {
+        LOG_ERROR("ShmPacketAPI can't create wake event: %s", strerror(errno));
+        return false;
+    }
+    waitThread = std::thread([this] { waitLoop(); });
+
+    LOG_INFO("ShmPacketAPI on %s (%u bytes), connect through %s", shmName.c_str(), (uint32_t)sizeof(ShmPacketRegion),
+             socketPath.c_str());
+    return true;
+}
+
+void ShmPacketAPI::acceptClient()
+{
+    int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    // Fresh rings and events for every session, so nothing of a previous client leaks into this one
+    region->fromRadio.reset();
+    region->toRadio.reset();
+    fromRadioEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    toRadioEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    int fds[2] = {fromRadioEvent, toRadioEvent};
+    char control[CMSG_SPACE(sizeof(fds))] = {};
+    char version = SHM_PACKET_API_VERSION;
+    struct iovec iov = {&version, sizeof(version)};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    clientFd = fd;
+    if (fromRadioEvent < 0 || toRadioEvent < 0 || sendmsg(fd, &msg, MSG_NOSIGNAL) != sizeof(version)) {
+        LOG_ERROR("ShmPacketAPI handshake failed: %s", strerror(errno));
+        closeClient();
+        return;
+    }
+    LOG_INFO("ShmPacketAPI client connected");
+}
+
+void ShmPacketAPI::closeClient()
+{
+    if (clientFd < 0)
+        return;
+    ::close(clientFd);
+    ::close(fromRadioEvent);
+    ::close(toRadioEvent);
+    clientFd = fromRadioEvent = toRadioEvent = -1;
+    PhoneAPI::close();
+}
+
+/// Let waitThread poll the fds of the current state, only called by the main thread when it has nothing left to do
+void ShmPacketAPI::armWait()
+{
+    std::lock_guard<std::mutex> guard(waitLock);
+    waitArmed = true;
+    waitChanged.notify_all();
+}
+
+/// Take the fds back from waitThread, after this the main thread may close them
+void ShmPacketAPI::disarmWait()
+{
+    std::unique_lock<std::mutex> guard(waitLock);
+    waitArmed = false;
+    if (waitPolling) {
+        uint64_t one = 1;
+        (void)!write(wakeEvent, &one, sizeof(one));
+        waitChanged.wait(guard, [this] { return !waitPolling; });
+    }
+}
+
+void ShmPacketAPI::waitLoop()
+{
+    std::unique_lock<std::mutex> guard(waitLock);
+    while (!stopping) {
+        waitChanged.wait(guard, [this] { return waitArmed || stopping; });
+        if (stopping)
+            break;
+
+        struct pollfd fds[3] = {};
+        nfds_t count = 0;
+        fds[count++] = {wakeEvent, POLLIN, 0};
+        if (clientFd < 0) {
+            fds[count++] = {listenFd, POLLIN, 0};
+        } else {
+            fds[count++] = {clientFd, POLLIN, 0}; // Also readable when the client disconnects
+            fds[count++] = {toRadioEvent, POLLIN, 0};
+        }
+        waitPolling = true;
+        guard.unlock();
+        while (poll(fds, count, -1) < 0 && errno == EINTR)
+            ;
+        guard.lock();
+        waitPolling = false;
+        uint64_t events;
+        (void)!read(wakeEvent, &events, sizeof(events)); // disarmWait() only signals it while we poll
+        waitChanged.notify_all();
+
+        // Wake the main loop the same way as NotifiedWorkerThread::notify(). Repeat until runOnce() took the fds back, a
+        // wakeup that races with the end of runOnce() is overwritten by the interval it returns.
+        while (waitArmed && !stopping) {
+            setInterval(0);
+            runASAP = true;
+            concurrency::mainDelay.interrupt();
+            waitChanged.wait_for(guard, std::chrono::milliseconds(10));
+        }
+    }
+}
+
+bool ShmPacketAPI::receivePackets()
+{
+    uint64_t events;
+    (void)!read(toRadioEvent, &events, sizeof(events)); // Just clear the counter, the ring tells what is there
+
+    // The client owns the head of the ring, so don't let it keep us here
+    bool received = false;
+    ShmPacketSlot *slot;
+    for (uint32_t i = 0; i < SHM_TORADIO_SLOTS && clientFd >= 0 && (slot = region->toRadio.beginRead()) != NULL; i++) {
+        // Read the length once and copy into our own buffer, the client may change the slot while we use it
+        uint32_t length = *(volatile uint32_t *)&slot->length;
+        if (length > sizeof(rxBuf)) {
+            region->toRadio.commitRead();
+            toRadioInvalid++;
+            LOG_WARN("ShmPacketAPI drop ToRadio of invalid length %u", length);
+            continue;
+        }
+        memcpy(rxBuf, slot->data, length);
+        region->toRadio.commitRead();
+
+        handleToRadio(rxBuf, length);
+        received = true;
+    }
+    return received;
+}
+
+/// Returns true if the ring is full and the client hasn't taken everything yet
+bool ShmPacketAPI::sendPackets()
+{
+    bool sent = false;
+    ShmPacketSlot *slot;
+    size_t length;
+    while ((slot = region->fromRadio.beginWrite()) != NULL && (length = getFromRadio(txBuf)) != 0) {
+        memcpy(slot->data, txBuf, length);
+        slot->length = length;
+        region->fromRadio.commitWrite();
+        sent = true;
+    }
+    if (sent) {
+        uint64_t one = 1;
+        (void)!write(fromRadioEvent, &one, sizeof(one));
+    }
+    return slot == NULL;
+}
+
+int32_t ShmPacketAPI::runOnce()
+{
+    disarmWait();
+
+    if (clientFd < 0) {
+        acceptClient();
+        if (clientFd < 0) {
+            armWait();
+            return INT32_MAX; // Until somebody connects
+        }
+    }
+
+    // The client closing the socket is our disconnect notification
+    char c;
+    ssize_t n = recv(clientFd, &c, sizeof(c), MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        LOG_INFO("ShmPacketAPI client disconnected");
+        closeClient();
+        armWait();
+        return INT32_MAX;
+    }
+
+    receivePackets();
+    bool full = sendPackets();
+    if (region->toRadio.size() != 0)
+        return 0; // receivePackets() left slots for the next run, their event is already consumed
+    if (full)
+        return 5; // The client doesn't tell us when it has taken slots, so check back while we have more for it
+    armWait();
+    return INT32_MAX; // Until the client sends, disconnects or onNowHasData()
+}
+
+#endif
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "PhoneAPI.h"
+#include "ShmRing.h"
+#include "concurrency/OSThread.h"
+#include "mesh/generated/meshtastic/mesh.pb.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#define SHM_PACKET_API_MAGIC 0x4d53484d // "MSHM"
+#define SHM_PACKET_API_VERSION 2
+#define SHM_FROMRADIO_SLOTS 32
+#define SHM_TORADIO_SLOTS 16
+
+/** One encoded FromRadio or ToRadio protobuf */
+struct ShmPacketSlot {
+    uint32_t length; // Bytes used in data
+    uint8_t data[MAX_TO_FROM_RADIO_SIZE];
+};
+
+/**
+ * Layout of the shared memory segment. Slots hold encoded protobufs, the same bytes as the other phone API transports
+ * without the framing, so a client only needs the protobuf definitions. It checks magic, version and the slot size before
+ * using the rings.
+ */
+struct ShmPacketRegion {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotSize;                                   // sizeof(ShmPacketSlot::data)
+    ShmRing<ShmPacketSlot, SHM_FROMRADIO_SLOTS> fromRadio; // We produce, the client consumes
+    ShmRing<ShmPacketSlot, SHM_TORADIO_SLOTS> toRadio;     // The client produces, we consume
+};
+
+#ifdef PORTDUINO_LINUX_HARDWARE
+
+/**
+ * A version of the phone API for clients on the same Linux host (local UIs, bridge daemons), exchanging FromRadio/ToRadio
+ * protobufs through shared memory rings instead of a TCP stream.
+ *
+ * The segment is created with shm_open(name). A client connects to the unix socket /tmp<name>.sock, which resets the rings and
+ * passes two eventfds with SCM_RIGHTS: the first is signaled by us when FromRadio slots were published, the second is
+ * signaled by the client after publishing ToRadio slots. The socket stays open for the whole session, closing it
+ * disconnects the client. Only one client is served at a time. Segment and socket are only accessible to the owner and
+ * group of meshtasticd.
+ *
+ * The client can change the shared memory at any time, so a ToRadio slot is copied into our own buffer and checked before
+ * it is decoded, nothing is ever used in place.
+ *
+ * Everything is handled on the main thread. While idle a helper thread blocks in poll() on the listening socket, or on the
+ * client socket and the ToRadio event, and wakes the main loop when one of them is ready.
+ */
+class ShmPacketAPI : public PhoneAPI, public concurrency::OSThread
+{
+  public:
+    static ShmPacketAPI *create(const char *name);
+    virtual ~ShmPacketAPI();
+    virtual int32_t runOnce() override;
+
+    /** ToRadio slots that were dropped because of an invalid length */
+    uint32_t toRadioInvalid = 0;
+
+  protected:
+    explicit ShmPacketAPI(const char *name);
+
+    bool init();
+
+    /// Check the current underlying physical link to see if the client is currently connected
+    virtual bool checkIsConnected() override { return clientFd >= 0; }
+
+    /// New packets for the client, send them right away instead of waiting for the next wakeup
+    virtual void onNowHasData(uint32_t fromRadioNum) override { setIntervalFromNow(0); }
+
+  private:
+    void acceptClient();
+    void closeClient();
+    bool receivePackets();
+    bool sendPackets();
+    void armWait();
+    void disarmWait();
+    void waitLoop();
+
+    std::string shmName;
+    std::string socketPath;
+    ShmPacketRegion *region = NULL;
+    int shmFd = -1;
+    int listenFd = -1;
+    int clientFd = -1;
+    int fromRadioEvent = -1;
+    int toRadioEvent = -1;
+
+    // Only the main thread opens and closes the fds above. It hands them to waitThread with armWait() and takes them back
+    // with disarmWait(), so they are never closed while waitThread polls them.
+    std::thread waitThread;
+    std::mutex waitLock;
+    std::condition_variable waitChanged;
+    bool waitArmed = false;   // Guarded by waitLock
+    bool waitPolling = false; // Guarded by waitLock
+    std::atomic<bool> stopping{false};
+    int wakeEvent = -1; // Signaled to get waitThread out of poll()
+
+    uint8_t txBuf[MAX_TO_FROM_RADIO_SIZE];
+    uint8_t rxBuf[MAX_TO_FROM_RADIO_SIZE];
+};
+
+extern ShmPacketAPI *shmPacketAPI;
+
+#endif
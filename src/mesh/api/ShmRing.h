@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Single producer, single consumer ring of fixed-size slots, meant to live in memory shared between two processes.
+ *
+ * The producer fills the slot returned by beginWrite() in place and publishes it with commitWrite(), the consumer uses the
+ * slot returned by beginRead() in place and hands it back with commitRead(). Nothing is copied by the ring itself. head is
+ * only written by the producer and tail only by the consumer, each on its own cache line.
+ *
+ * This header only depends on the standard library, so that out of tree clients can include it.
+ */
+template <typename T, uint32_t N> struct ShmRing {
+    static_assert((N & (N - 1)) == 0, "ShmRing size must be a power of 2");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "ShmRing needs address-free atomics");
+
+    alignas(64) std::atomic<uint32_t> head; // Next slot to write
+    alignas(64) std::atomic<uint32_t> tail; // Next slot to read
+    alignas(64) T slots[N];
+
+    /** Only safe when neither side is using the ring */
+    void reset()
+    {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+    /** Producer: slot to fill, or NULL if the ring is full */
+    T *beginWrite()
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N)
+            return NULL;
+        return &slots[h & (N - 1)];
+    }
+
+    /** Producer: publish the slot returned by beginWrite() */
+    void commitWrite() { head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    /** Consumer: oldest published slot, or NULL if the ring is empty */
+    T *beginRead()
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t)
+            return NULL;
+        return &slots[t & (N - 1)];
+    }
+
+    /** Consumer: release the slot returned by beginRead() */
+    void commitRead() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    /** Number of published slots, exact only when called by one of the two sides */
+    uint32_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+};
@@ -5,8 +5,12 @@ Webserver libs including generation of SSL certifcicates,  because the use ESP s
 the lib that can't be emulated.
 
 The WebServices adapt to the two major phoneapi functions "handleAPIv1FromRadio,handleAPIv1ToRadio"
+/api/v1/fromradio?all=true streams all pending FromRadio messages in one response, length-prefixed like the StreamAPI.
 The WebServer just adds basaic support to deliver WebContent, so it can be used to
-deliver the WebGui definded by the WebClient Project.
+deliver the WebGui definded by the WebClient Project. Files are kept in memory (see WebFileCache) and served with
+ETags, a file.gz next to a file is sent instead to browsers that accept gzip.
+/metrics exports the metrics registry in Prometheus text format, for scraping.
+/api/v1/telemetry returns the telemetry history of a node as JSON.
 
 Steps to get it running:
 1.) Add these Linux Libs to the compile and target machine:
@@ -37,10 +41,12 @@ mail:   marchammermann@googlemail.com
 #ifdef PORTDUINO_LINUX_HARDWARE
 #if __has_include(<ulfius.h>)
 #include "PiWebServer.h"
+#include "Metrics.h"
 #include "NodeDB.h"
 #include "PhoneAPI.h"
 #include "PowerFSM.h"
 #include "RadioLibInterface.h"
+#include "TelemetryHistory.h"
 #include "airtime.h"
 #include "graphics/Screen.h"
 #include "main.h"
@@ -56,6 +62,7 @@ mail:   marchammermann@googlemail.com
 #include <ulfius.h>
 #include <yder.h>
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 
@@ -126,6 +133,65 @@ static void callback_static_file_stream_free(void *cls)
     }
 }
 
+/**
+ * A cached file being sent, holding on to the cache entry until the response is done
+ */
+struct CachedFileStream {
+    WebFileCache::EntryPtr entry;
+    const std::string *body;
+};
+
+/**
+ * Streaming callback function that sends a cached file straight from memory
+ */
+static ssize_t callback_cached_file_stream(void *cls, uint64_t pos, char *buf, size_t max)
+{
+    const std::string *body = ((CachedFileStream *)cls)->body;
+    if (pos >= body->size())
+        return U_STREAM_END;
+    size_t len = std::min<size_t>(max, body->size() - pos);
+    memcpy(buf, body->data() + pos, len);
+    return len;
+}
+
+/**
+ * Release the cache entry when streaming is complete
+ */
+static void callback_cached_file_stream_free(void *cls)
+{
+    delete (CachedFileStream *)cls;
+}
+
+/**
+ * Answer from the cache: 304 if the client has the file already, else the gzip variant if it takes that, else the file
+ */
+static void serve_cached_file(const struct _u_request *request, struct _u_response *response, WebFileCache::EntryPtr entry,
+                              bool isPage)
+{
+    const char *acceptEncoding = u_map_get_case(request->map_header, "Accept-Encoding");
+    bool gzip = entry->hasGzip() && acceptEncoding != NULL && strstr(acceptEncoding, "gzip") != NULL;
+    const std::string &etag = gzip ? entry->gzipEtag : entry->etag;
+
+    u_map_put(response->map_header, "ETag", etag.c_str());
+    u_map_put(response->map_header, "Cache-Control", isPage ? STATIC_FILE_CACHE_CONTROL_PAGE : STATIC_FILE_CACHE_CONTROL);
+    if (entry->hasGzip())
+        u_map_put(response->map_header, "Vary", "Accept-Encoding");
+
+    if (WebFileCache::matches(u_map_get_case(request->map_header, "If-None-Match"), etag)) {
+        response->status = 304;
+        return;
+    }
+    if (gzip)
+        u_map_put(response->map_header, "Content-Encoding", "gzip");
+
+    CachedFileStream *stream = new CachedFileStream{entry, gzip ? &entry->gzipBody : &entry->body};
+    if (ulfius_set_stream_response(response, 200, callback_cached_file_stream, callback_cached_file_stream_free,
+                                   stream->body->size(), CACHED_FILE_CHUNK, stream) != U_OK) {
+        LOG_DEBUG("callback_static_file - Error ulfius_set_stream_response");
+        delete stream;
+    }
+}
+
 /**
  * static file callback endpoint that delivers the content for WebServer calls
  */
@@ -169,7 +235,17 @@ int callback_static_file(const struct _u_request *request, struct _u_response *r
         file_path = msprintf("%s/%s", configWeb.files_path, file_requested);
         real_path = realpath(file_path, NULL);
         if (0 == o_strncmp(configWeb.files_path, real_path, o_strlen(configWeb.files_path))) {
-            if (access(file_path, F_OK) != -1) {
+            WebFileCache::EntryPtr cached;
+            if (configWeb.cache != NULL)
+                cached = configWeb.cache->get(file_path);
+            if (cached) {
+                content_type = u_map_get_case(&configWeb.mime_types, get_filename_ext(file_requested));
+                if (content_type == NULL)
+                    content_type = u_map_get(&configWeb.mime_types, "*");
+                u_map_put(response->map_header, "Content-Type", content_type);
+                u_map_copy_into(response->map_header, &configWeb.map_header);
+                serve_cached_file(request, response, cached, strcmp(get_filename_ext(file_requested), ".html") == 0);
+            } else if (access(file_path, F_OK) != -1) {
                 f = fopen(file_path, "rb");
                 if (f) {
                     fseek(f, 0, SEEK_END);
@@ -238,21 +314,79 @@ int handleAPIv1ToRadio(const struct _u_request *req, struct _u_response *res, vo
         return U_CALLBACK_COMPLETE;
     }
 
-    byte buffer[MAX_TO_FROM_RADIO_SIZE];
     size_t s = req->binary_body_length;
-
-    memcpy(buffer, req->binary_body, MAX_TO_FROM_RADIO_SIZE);
+    if (s > MAX_TO_FROM_RADIO_SIZE) {
+        LOG_WARN("Drop ToRadio of %u bytes, more than %u", s, MAX_TO_FROM_RADIO_SIZE);
+        ulfius_set_string_body_response(res, 413, "ToRadio too large");
+        return U_CALLBACK_COMPLETE;
+    }
 
     // FIXME* Problem with portdunio loosing mountpoint maybe because of running in a real sep. thread
 
     portduinoVFS->mountpoint(configWeb.rootPath);
 
     LOG_DEBUG("Received %d bytes from PUT request", s);
-    static_cast<HttpAPI *>(user_data)->handleToRadio(buffer, s);
+    static_cast<HttpAPI *>(user_data)->handleToRadio((const uint8_t *)req->binary_body, s);
     LOG_DEBUG("end web->radio  ");
     return U_CALLBACK_COMPLETE;
 }
 
+/**
+ * State of one streaming FromRadio response, the frame we are in the middle of sending
+ */
+struct FromRadioStream {
+    HttpAPI *api;
+    uint32_t idleMsec;
+    uint32_t lastFrameMsec;
+    size_t frameLength;
+    size_t framePos;
+    uint8_t frame[FROMRADIO_STREAM_HEADER + MAX_TO_FROM_RADIO_SIZE];
+};
+
+/**
+ * Streaming callback function that drains the PhoneAPI, waits for more while it is empty until the idle time is up
+ */
+static ssize_t callback_fromradio_stream(void *cls, uint64_t pos, char *buf, size_t max)
+{
+    (void)(pos);
+    FromRadioStream *stream = (FromRadioStream *)cls;
+    size_t written = 0;
+
+    while (written < max) {
+        if (stream->framePos == stream->frameLength) {
+            size_t len = stream->api->getFromRadio(stream->frame + FROMRADIO_STREAM_HEADER);
+            if (len == 0) {
+                if (written > 0)
+                    return written; // Hand out what we have, the client may be waiting for it
+                if (millis() - stream->lastFrameMsec >= stream->idleMsec)
+                    return U_STREAM_END;
+                usleep(FROMRADIO_STREAM_POLL_MSEC * 1000);
+                continue;
+            }
+            stream->frame[0] = FROMRADIO_STREAM_START1;
+            stream->frame[1] = FROMRADIO_STREAM_START2;
+            stream->frame[2] = (len >> 8) & 0xff;
+            stream->frame[3] = len & 0xff;
+            stream->frameLength = FROMRADIO_STREAM_HEADER + len;
+            stream->framePos = 0;
+            stream->lastFrameMsec = millis();
+        }
+        size_t n = std::min(max - written, stream->frameLength - stream->framePos);
+        memcpy(buf + written, stream->frame + stream->framePos, n);
+        stream->framePos += n;
+        written += n;
+    }
+    return written;
+}
+
+/**
+ * Cleanup FromRadioStream structure when streaming is complete
+ */
+static void callback_fromradio_stream_free(void *cls)
+{
+    delete (FromRadioStream *)cls;
+}
+
 /*
  * Adapt the radioapi to the Webservice handleAPIv1FromRadio
  * Trigger : WebGui(POLL)->handleAPIv1FromRadio->phoneapi->Meshtastic(Radio) events
@@ -261,7 +395,7 @@ int handleAPIv1FromRadio(const struct _u_request *req, struct _u_response *res,
 {
 
     // LOG_DEBUG("handleAPIv1FromRadio radio -> web");
-    std::string valueAll;
+    HttpAPI *webAPI = static_cast<HttpAPI *>(user_data);
 
     // Status code is 200 OK by default.
     ulfius_add_header_to_response(res, "Content-Type", "application/x-protobuf");
@@ -275,22 +409,27 @@ int handleAPIv1FromRadio(const struct _u_request *req, struct _u_response *res,
         return U_CALLBACK_COMPLETE;
     }
 
-    uint8_t txBuf[MAX_STREAM_BUF_SIZE];
-    uint32_t len = 1;
-
-    if (valueAll == "true") {
-        while (len) {
-            len = static_cast<HttpAPI *>(user_data)->getFromRadio(txBuf);
-            ulfius_set_response_properties(res, U_OPT_STATUS, 200, U_OPT_BINARY_BODY, txBuf, len);
-            const char *tmpa = (const char *)txBuf;
-            ulfius_set_string_body_response(res, 200, tmpa);
-            // LOG_DEBUG("\n----webAPI response all:----");
-            // LOG_DEBUG(tmpa);
-            // LOG_DEBUG("");
+    const char *valueAll = u_map_get(req->map_url, "all");
+    if (valueAll != NULL && strcmp(valueAll, "true") == 0) {
+        // Stream all of them, framed, in one response
+        FromRadioStream *stream = new FromRadioStream();
+        stream->api = webAPI;
+        stream->idleMsec = FROMRADIO_STREAM_IDLE_MSEC;
+        const char *timeout = u_map_get(req->map_url, "timeout");
+        if (timeout != NULL)
+            stream->idleMsec = std::min<uint32_t>(strtoul(timeout, NULL, 10), FROMRADIO_STREAM_MAX_IDLE_MSEC);
+        stream->lastFrameMsec = millis();
+
+        if (ulfius_set_stream_response(res, 200, callback_fromradio_stream, callback_fromradio_stream_free,
+                                       U_STREAM_SIZE_UNKNOWN, FROMRADIO_STREAM_CHUNK, stream) != U_OK) {
+            LOG_DEBUG("handleAPIv1FromRadio - Error ulfius_set_stream_response");
+            delete stream;
+            return U_CALLBACK_ERROR;
         }
         // Otherwise, just return one protobuf
     } else {
-        len = static_cast<HttpAPI *>(user_data)->getFromRadio(txBuf);
+        uint8_t txBuf[MAX_STREAM_BUF_SIZE];
+        uint32_t len = webAPI->getFromRadio(txBuf);
         const char *tmpa = (const char *)txBuf;
         ulfius_set_binary_body_response(res, 200, tmpa, len);
         // LOG_DEBUG("\n----webAPI response:");
@@ -302,6 +441,83 @@ int handleAPIv1FromRadio(const struct _u_request *req, struct _u_response *res,
     return U_CALLBACK_COMPLETE;
 }
 
+#if HAS_TELEMETRY_HISTORY
+/*
+ * Query the telemetry history of a node as JSON
+ * Trigger : Client(GET /api/v1/telemetry?node=N[&metric=voltage&tier=raw|1m|15m&max=M])->handleAPIv1Telemetry
+ * Without a metric, the metrics there is a history of are listed.
+ */
+int handleAPIv1Telemetry(const struct _u_request *req, struct _u_response *res, void *user_data)
+{
+    const char *nodeParam = u_map_get(req->map_url, "node");
+    if (telemetryHistory == NULL || nodeParam == NULL) {
+        ulfius_set_string_body_response(res, 400, "node required");
+        return U_CALLBACK_COMPLETE;
+    }
+    // Decimal, 0x... or the !hex form clients show
+    NodeNum node = nodeParam[0] == '!' ? strtoul(nodeParam + 1, NULL, 16) : strtoul(nodeParam, NULL, 0);
+
+    std::string body = "{\"node\":" + std::to_string(node);
+    const char *metricParam = u_map_get(req->map_url, "metric");
+    if (metricParam == NULL) {
+        uint32_t metrics = telemetryHistory->metricsOf(node);
+        body += ",\"metrics\":[";
+        for (uint8_t m = 0; m < TelemetryHistory::NUM_METRICS; m++) {
+            if (metrics & (1 << m)) {
+                if (body.back() != '[')
+                    body += ",";
+                body += std::string("\"") + TelemetryHistory::metricName((TelemetryHistory::Metric)m) + "\"";
+            }
+        }
+        body += "]}";
+    } else {
+        TelemetryHistory::Metric metric;
+        TelemetryHistory::Tier tier = TelemetryHistory::RAW;
+        const char *tierParam = u_map_get(req->map_url, "tier");
+        if (!TelemetryHistory::metricByName(metricParam, metric) ||
+            (tierParam != NULL && !TelemetryHistory::tierByName(tierParam, tier))) {
+            ulfius_set_string_body_response(res, 400, "unknown metric or tier");
+            return U_CALLBACK_COMPLETE;
+        }
+        size_t maxSamples = TELEMETRY_HISTORY_MAX_SAMPLES;
+        const char *maxParam = u_map_get(req->map_url, "max");
+        if (maxParam != NULL)
+            maxSamples = std::min<size_t>(strtoul(maxParam, NULL, 10), TELEMETRY_HISTORY_MAX_SAMPLES);
+
+        TelemetryHistory::Sample samples[TELEMETRY_HISTORY_MAX_SAMPLES];
+        size_t n = telemetryHistory->query(node, metric, tier, samples, maxSamples);
+        body += std::string(",\"metric\":\"") + TelemetryHistory::metricName(metric) + "\",\"tier\":\"" +
+                TelemetryHistory::tierName(tier) + "\",\"samples\":[";
+        char sample[40];
+        for (size_t i = 0; i < n; i++) {
+            snprintf(sample, sizeof(sample), "%s[%u,%g]", i ? "," : "", samples[i].time, samples[i].value);
+            body += sample;
+        }
+        body += "]}";
+    }
+
+    ulfius_add_header_to_response(res, "Content-Type", "application/json");
+    ulfius_set_string_body_response(res, 200, body.c_str());
+    return U_CALLBACK_COMPLETE;
+}
+#endif
+
+/*
+ * Export the metrics registry in Prometheus text format
+ * Trigger : Prometheus(SCRAPE)->handleMetrics
+ */
+int handleMetrics(const struct _u_request *req, struct _u_response *res, void *user_data)
+{
+    // The registered values belong to the main thread, serve what it last rendered
+    std::string body;
+    if (metricsSnapshot)
+        metricsSnapshot->get(body);
+
+    ulfius_add_header_to_response(res, "Content-Type", "text/plain; version=0.0.4");
+    ulfius_set_string_body_response(res, 200, body.c_str());
+    return U_CALLBACK_COMPLETE;
+}
+
 /*
 OpenSSL RSA Key Gen
 */
@@ -495,6 +711,7 @@ PiWebServerThread::PiWebServerThread()
         configWeb.files_path = (char *)webrootpath.c_str();
         configWeb.url_prefix = "";
         configWeb.rootPath = strdup(portduinoVFS->mountpoint());
+        configWeb.cache = &fileCache;
 
         u_map_put(instanceWeb.default_headers, "Access-Control-Allow-Origin", "*");
         // Maximum body size sent by the client is 1 Kb
@@ -503,6 +720,10 @@ PiWebServerThread::PiWebServerThread()
         ulfius_add_endpoint_by_val(&instanceWeb, "OPTIONS", PREFIX, "/api/v1/fromradio/*", 1, &handleAPIv1FromRadio, &webAPI);
         ulfius_add_endpoint_by_val(&instanceWeb, "PUT", PREFIX, "/api/v1/toradio/*", 1, &handleAPIv1ToRadio, &webAPI);
         ulfius_add_endpoint_by_val(&instanceWeb, "OPTIONS", PREFIX, "/api/v1/toradio/*", 1, &handleAPIv1ToRadio, &webAPI);
+        ulfius_add_endpoint_by_val(&instanceWeb, "GET", PREFIX, "/metrics", 1, &handleMetrics, NULL);
+#if HAS_TELEMETRY_HISTORY
+        ulfius_add_endpoint_by_val(&instanceWeb, "GET", PREFIX, "/api/v1/telemetry", 1, &handleAPIv1Telemetry, NULL);
+#endif
 
         // Add callback function to all endpoints for the Web Server
         ulfius_add_endpoint_by_val(&instanceWeb, "GET", NULL, "/*", 2, &callback_static_file, &configWeb);
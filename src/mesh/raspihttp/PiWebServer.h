@@ -2,12 +2,29 @@
 #ifdef PORTDUINO_LINUX_HARDWARE
 #if __has_include(<ulfius.h>)
 #include "PhoneAPI.h"
+#include "WebFileCache.h"
 #include "ulfius-cfg.h"
 #include "ulfius.h"
 #include <Arduino.h>
 #include <functional>
 
 #define STATIC_FILE_CHUNK 256
+#define CACHED_FILE_CHUNK 16384
+
+// Cache-Control of static files. Pages are revalidated with their ETag every time, everything else may be reused a while.
+#define STATIC_FILE_CACHE_CONTROL_PAGE "no-cache"
+#define STATIC_FILE_CACHE_CONTROL "public, max-age=86400"
+
+// GET /api/v1/fromradio?all=true streams every FromRadio the PhoneAPI has, each framed like the StreamAPI does: START1
+// START2 LEN_MSB LEN_LSB and the encoded FromRadio. Once there is nothing to send it keeps polling for up to the idle time
+// (or ?timeout=msec, capped) before ending the response, so a client can hold it open as a long poll.
+#define FROMRADIO_STREAM_START1 0x94
+#define FROMRADIO_STREAM_START2 0xc3
+#define FROMRADIO_STREAM_HEADER 4
+#define FROMRADIO_STREAM_CHUNK 4096
+#define FROMRADIO_STREAM_POLL_MSEC 10
+#define FROMRADIO_STREAM_IDLE_MSEC 1000
+#define FROMRADIO_STREAM_MAX_IDLE_MSEC 60000
 
 void initWebServer();
 void createSSLCert();
@@ -21,6 +38,7 @@ struct _file_config {
     struct _u_map map_header;
     char *redirect_on_404;
     char *rootPath;
+    WebFileCache *cache;
 };
 
 class HttpAPI : public PhoneAPI
@@ -53,6 +71,7 @@ class PiWebServerThread
     int CheckSSLandLoad();
     uint32_t requestRestart = 0;
     struct _u_instance instanceWeb;
+    WebFileCache fileCache;
 };
 
 extern PiWebServerThread *piwebServerThread;
@@ -0,0 +1,155 @@
+#ifdef PORTDUINO_LINUX_HARDWARE
+#include "WebFileCache.h"
+#include "configuration.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/// Read a whole file, false if it can't be read or changed size while we did
+static bool readFile(const std::string &path, off_t size, std::string &out)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f == NULL)
+        return false;
+    out.resize(size);
+    size_t readSize = size ? fread(&out[0], 1, size, f) : 0;
+    fclose(f);
+    return readSize == (size_t)size;
+}
+
+/// Strong ETag from a 64 bit FNV-1a hash of the content
+static std::string makeEtag(const std::string &body)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : body) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%016llx\"", (unsigned long long)hash);
+    return etag;
+}
+
+static bool isRegularFile(const std::string &path, struct stat &st)
+{
+    return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+WebFileCache::EntryPtr WebFileCache::get(const std::string &path)
+{
+    if (!enabled)
+        return NULL;
+
+    uint32_t now = millis();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = slots.find(path);
+        if (it != slots.end() && now - it->second.checkedMsec < WEB_FILE_CACHE_CHECK_MSEC) {
+            hits++;
+            return it->second.entry;
+        }
+    }
+
+    struct stat st, gzipSt;
+    if (!isRegularFile(path, st)) {
+        remove(path);
+        return NULL;
+    }
+    std::string gzipPath = path + ".gz";
+    bool hasGzip = isRegularFile(gzipPath, gzipSt);
+    if (!hasGzip) {
+        gzipSt.st_mtime = 0;
+        gzipSt.st_size = 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = slots.find(path);
+        if (it != slots.end()) {
+            const Entry &e = *it->second.entry;
+            if (e.mtime == st.st_mtime && e.size == st.st_size && e.gzipMtime == gzipSt.st_mtime &&
+                e.gzipSize == gzipSt.st_size) {
+                it->second.checkedMsec = now;
+                hits++;
+                return it->second.entry;
+            }
+        }
+    }
+
+    if (st.st_size > WEB_FILE_CACHE_MAX_FILE || gzipSt.st_size > WEB_FILE_CACHE_MAX_FILE) {
+        remove(path);
+        uncacheable++;
+        return NULL;
+    }
+
+    // Load outside of the lock, other connections keep being served from memory meanwhile
+    std::shared_ptr<Entry> e = std::make_shared<Entry>();
+    e->mtime = st.st_mtime;
+    e->size = st.st_size;
+    e->gzipMtime = gzipSt.st_mtime;
+    e->gzipSize = gzipSt.st_size;
+    if (!readFile(path, st.st_size, e->body) || (hasGzip && !readFile(gzipPath, gzipSt.st_size, e->gzipBody))) {
+        remove(path);
+        return NULL;
+    }
+    e->etag = makeEtag(e->body);
+    if (hasGzip)
+        e->gzipEtag = makeEtag(e->gzipBody);
+    size_t bytes = e->body.size() + e->gzipBody.size();
+
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = slots.find(path);
+    if (it != slots.end()) {
+        totalBytes -= it->second.entry->body.size() + it->second.entry->gzipBody.size();
+        slots.erase(it);
+    }
+    // Make room by dropping the files we looked at longest ago, they get loaded again when asked for
+    while (totalBytes + bytes > WEB_FILE_CACHE_MAX_BYTES && !slots.empty()) {
+        auto oldest = slots.begin();
+        for (auto s = slots.begin(); s != slots.end(); ++s) {
+            if (now - s->second.checkedMsec > now - oldest->second.checkedMsec)
+                oldest = s;
+        }
+        totalBytes -= oldest->second.entry->body.size() + oldest->second.entry->gzipBody.size();
+        slots.erase(oldest);
+    }
+    if (totalBytes + bytes > WEB_FILE_CACHE_MAX_BYTES) {
+        uncacheable++;
+        return NULL;
+    }
+    slots[path] = {e, now};
+    totalBytes += bytes;
+    loads++;
+    LOG_DEBUG("Web file cache: loaded %s (%u bytes%s), %u bytes cached", path.c_str(), (uint32_t)e->body.size(),
+              hasGzip ? ", gzip" : "", (uint32_t)totalBytes);
+    return e;
+}
+
+void WebFileCache::remove(const std::string &path)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = slots.find(path);
+    if (it != slots.end()) {
+        totalBytes -= it->second.entry->body.size() + it->second.entry->gzipBody.size();
+        slots.erase(it);
+    }
+}
+
+void WebFileCache::clear()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    slots.clear();
+    totalBytes = 0;
+}
+
+bool WebFileCache::matches(const char *ifNoneMatch, const std::string &etag)
+{
+    if (ifNoneMatch == NULL)
+        return false;
+    if (strcmp(ifNoneMatch, "*") == 0)
+        return true;
+    // A list of (possibly weak, W/"...") tags, for If-None-Match the weak comparison is the right one
+    return strstr(ifNoneMatch, etag.c_str()) != NULL;
+}
+#endif
@@ -0,0 +1,75 @@
+#pragma once
+#ifdef PORTDUINO_LINUX_HARDWARE
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+
+#ifndef WEB_FILE_CACHE_MAX_FILE
+#define WEB_FILE_CACHE_MAX_FILE (4 * 1024 * 1024) // Larger files are streamed from disk every time
+#endif
+#ifndef WEB_FILE_CACHE_MAX_BYTES
+#define WEB_FILE_CACHE_MAX_BYTES (32 * 1024 * 1024) // All cached files (and their .gz variants) together
+#endif
+#ifndef WEB_FILE_CACHE_CHECK_MSEC
+#define WEB_FILE_CACHE_CHECK_MSEC 2000 // How long we trust a cached file before looking at its mtime again
+#endif
+
+/**
+ * Keeps the static files of the web server in memory, so serving the web UI doesn't read them from disk for every
+ * request.
+ *
+ * Files are loaded on first use and reloaded when their size or mtime changes. A file.gz next to a file is loaded with it
+ * and can be served instead to clients that accept gzip. Each variant gets a strong ETag from a hash of its content.
+ *
+ * The web server calls us from one thread per connection, entries are handed out as shared pointers so a reload doesn't
+ * pull the bytes out from under a response that is still being sent.
+ */
+class WebFileCache
+{
+  public:
+    struct Entry {
+        std::string body;
+        std::string etag;
+        std::string gzipBody; // Empty if there is no .gz variant
+        std::string gzipEtag;
+        time_t mtime;
+        off_t size;
+        time_t gzipMtime;
+        off_t gzipSize;
+
+        bool hasGzip() const { return !gzipEtag.empty(); }
+    };
+
+    typedef std::shared_ptr<const Entry> EntryPtr;
+
+    /// The file at path, from memory if we have it and it hasn't changed. NULL if it can't be cached.
+    EntryPtr get(const std::string &path);
+
+    void clear();
+
+    /// Whether an If-None-Match header names etag
+    static bool matches(const char *ifNoneMatch, const std::string &etag);
+
+    /// When false get() always returns NULL, so files are read from disk as before
+    bool enabled = true;
+
+    /* Statistics */
+    uint32_t hits = 0, loads = 0, uncacheable = 0;
+
+  private:
+    struct Slot {
+        EntryPtr entry;
+        uint32_t checkedMsec;
+    };
+
+    std::mutex lock;
+    std::map<std::string, Slot> slots;
+    size_t totalBytes = 0;
+
+    void remove(const std::string &path);
+};
+
+#endif
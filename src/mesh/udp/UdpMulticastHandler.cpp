@@ -0,0 +1,206 @@
+#include "UdpMulticastHandler.h"
+
+#if HAS_UDP_MULTICAST
+#include "mesh/Metrics.h"
+#include "mesh/mesh-pb-constants.h"
+
+UdpMulticastHandler::UdpMulticastHandler()
+    : concurrency::OSThread("UdpMulticast"), freeDatagrams(UDP_MULTICAST_RX_QUEUE), rxDatagramQueue(UDP_MULTICAST_RX_QUEUE)
+{
+    udpIpAddress = IPAddress(224, 0, 0, 69);
+    rxDatagramQueue.setReader(this);
+
+#if HAS_METRICS
+    metrics.addCounter("meshtastic_udp_rx_datagrams_total", "Datagrams received over UDP multicast", &rxDatagrams);
+    metrics.addCounter("meshtastic_udp_rx_queue_full_total", "Datagrams dropped because the main thread fell behind",
+                       &rxQueueFull);
+    metrics.addCounter("meshtastic_udp_rx_packets_total", "Packets received over UDP multicast", &rxPackets,
+                       "result=\"queued\"");
+    metrics.addCounter("meshtastic_udp_rx_packets_total", "Packets received over UDP multicast", &rxDupe,
+                       "result=\"duplicate\"");
+    metrics.addCounter("meshtastic_udp_rx_packets_total", "Packets received over UDP multicast", &rxBad, "result=\"bad\"");
+    metrics.addCounter("meshtastic_udp_tx_packets_total", "Packets sent over UDP multicast", &txPackets);
+    metrics.addCounter("meshtastic_udp_tx_datagrams_total", "Datagrams sent over UDP multicast", &txDatagrams);
+#endif
+}
+
+bool UdpMulticastHandler::start()
+{
+    if (!datagrams) {
+        datagrams = new Datagram[UDP_MULTICAST_RX_QUEUE];
+        for (int i = 0; i < UDP_MULTICAST_RX_QUEUE; i++)
+            freeDatagrams.enqueue(&datagrams[i], 0);
+    }
+
+    if (udp.listenMulticast(udpIpAddress, UDP_MULTICAST_DEFAUL_PORT, 64)) {
+#ifndef ARCH_PORTDUINO
+        // FIXME(PORTDUINO): arduino lacks IPAddress::toString()
+        LOG_DEBUG("UDP Listening on IP: %s", WiFi.localIP().toString().c_str());
+#else
+        LOG_DEBUG("UDP Listening");
+#endif
+        udp.onPacket([this](AsyncUDPPacket packet) { onReceive(packet); });
+        return true;
+    } else {
+        LOG_DEBUG("Failed to listen on UDP");
+        return false;
+    }
+}
+
+void UdpMulticastHandler::onReceive(AsyncUDPPacket &packet)
+{
+    size_t packetLength = packet.length();
+#ifndef ARCH_PORTDUINO
+    // FIXME(PORTDUINO): arduino lacks IPAddress::toString()
+    LOG_DEBUG("UDP broadcast from: %s, len=%u", packet.remoteIP().toString().c_str(), packetLength);
+#endif
+    rxDatagrams++;
+    Datagram *d = packetLength <= UDP_MULTICAST_MAX_DATAGRAM ? freeDatagrams.dequeuePtr(0) : NULL;
+    if (!d) {
+        rxQueueFull++;
+        return;
+    }
+    memcpy(d->bytes, packet.data(), packetLength);
+    d->length = packetLength;
+    rxDatagramQueue.enqueue(d, 0); // Can't fail, it has room for all datagrams
+}
+
+int32_t UdpMulticastHandler::runOnce()
+{
+    Datagram *d;
+    while ((d = rxDatagramQueue.dequeuePtr(0)) != NULL) {
+        handleDatagram(d->bytes, d->length);
+        freeDatagrams.enqueue(d, 0);
+    }
+
+    if (batchLength == 0)
+        return INT32_MAX; // Until the network thread or onSend() wakes us
+    uint32_t age = millis() - batchStartMsec;
+    if (age < batchDelayMsec)
+        return batchDelayMsec - age;
+    flushBatch();
+    return INT32_MAX;
+}
+
+void UdpMulticastHandler::handleDatagram(const uint8_t *bytes, size_t length)
+{
+    if (length < 2 || bytes[0] != UDP_MULTICAST_BATCH_START1 || bytes[1] != UDP_MULTICAST_BATCH_START2) {
+        handlePacket(bytes, length);
+        return;
+    }
+
+    size_t pos = 0;
+    while (pos + UDP_MULTICAST_BATCH_HEADER <= length && bytes[pos] == UDP_MULTICAST_BATCH_START1 &&
+           bytes[pos + 1] == UDP_MULTICAST_BATCH_START2) {
+        size_t len = (bytes[pos + 2] << 8) | bytes[pos + 3];
+        pos += UDP_MULTICAST_BATCH_HEADER;
+        if (pos + len > length)
+            break;
+        handlePacket(bytes + pos, len);
+        pos += len;
+    }
+    if (pos != length)
+        rxBad++;
+}
+
+void UdpMulticastHandler::handlePacket(const uint8_t *bytes, size_t length)
+{
+    meshtastic_MeshPacket mp;
+    LOG_DEBUG("Decoding MeshPacket from UDP len=%u", length);
+    bool isPacketDecoded = pb_decode_from_bytes(bytes, length, &meshtastic_MeshPacket_msg, &mp);
+    if (!isPacketDecoded || mp.which_payload_variant != meshtastic_MeshPacket_encrypted_tag) {
+        rxBad++;
+        return;
+    }
+    if (isDuplicate(mp)) {
+        rxDupe++;
+        return;
+    }
+    if (!router)
+        return;
+
+    mp.pki_encrypted = false;
+    mp.public_key.size = 0;
+    memset(mp.public_key.bytes, 0, sizeof(mp.public_key.bytes));
+    UniquePacketPoolPacket p = packetPool.allocUniqueCopy(mp);
+    // Unset received SNR/RSSI
+    p->rx_snr = 0;
+    p->rx_rssi = 0;
+    rxPackets++;
+    router->enqueueReceivedMessage(p.release());
+}
+
+bool UdpMulticastHandler::isDuplicate(const meshtastic_MeshPacket &mp)
+{
+    // Copies other LAN nodes sent us, and our own packets coming back
+    for (const RecentPacket &r : recent) {
+        if (r.id == mp.id && r.from == mp.from)
+            return true;
+    }
+    // Packets LoRa brought in first
+    if (router && router->wasSeenRecentlyNoUpdate(&mp))
+        return true;
+
+    recent[recentNext] = {mp.from, mp.id};
+    recentNext = (recentNext + 1) % UDP_MULTICAST_RECENT_PACKETS;
+    return false;
+}
+
+bool UdpMulticastHandler::onSend(const meshtastic_MeshPacket *mp)
+{
+    if (!mp || !udp) {
+        return false;
+    }
+#ifndef ARCH_PORTDUINO
+    if (WiFi.status() != WL_CONNECTED) {
+        return false;
+    }
+#endif
+    LOG_DEBUG("Broadcasting packet over UDP (id=%u)", mp->id);
+    uint8_t buffer[meshtastic_MeshPacket_size];
+    size_t encodedLength = pb_encode_to_bytes(buffer, sizeof(buffer), &meshtastic_MeshPacket_msg, mp);
+    txPackets++;
+    isDuplicate(*mp); // So the multicast loopback of it gets dropped
+
+    if (batchDelayMsec == 0) {
+        write(buffer, encodedLength);
+        return true;
+    }
+
+    if (batchLength + UDP_MULTICAST_BATCH_HEADER + encodedLength > UDP_MULTICAST_MAX_DATAGRAM)
+        flushBatch();
+    if (batchLength == 0) {
+        batchStartMsec = millis();
+        setIntervalFromNow(batchDelayMsec);
+    }
+    batch[batchLength++] = UDP_MULTICAST_BATCH_START1;
+    batch[batchLength++] = UDP_MULTICAST_BATCH_START2;
+    batch[batchLength++] = (encodedLength >> 8) & 0xff;
+    batch[batchLength++] = encodedLength & 0xff;
+    memcpy(batch + batchLength, buffer, encodedLength);
+    batchLength += encodedLength;
+    return true;
+}
+
+void UdpMulticastHandler::setBatchDelay(uint32_t msec)
+{
+    flushBatch();
+    batchDelayMsec = msec;
+    if (msec && !batch)
+        batch = new uint8_t[UDP_MULTICAST_MAX_DATAGRAM];
+}
+
+void UdpMulticastHandler::write(const uint8_t *bytes, size_t length)
+{
+    udp.writeTo(bytes, length, udpIpAddress, UDP_MULTICAST_DEFAUL_PORT);
+    txDatagrams++;
+}
+
+void UdpMulticastHandler::flushBatch()
+{
+    if (batchLength == 0)
+        return;
+    write(batch, batchLength);
+    batchLength = 0;
+}
+#endif // HAS_UDP_MULTICAST
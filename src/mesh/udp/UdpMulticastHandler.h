@@ -1,7 +1,9 @@
 #pragma once
 #if HAS_UDP_MULTICAST
 #include "configuration.h"
+#include "concurrency/OSThread.h"
 #include "main.h"
+#include "mesh/PointerQueue.h"
 #include "mesh/Router.h"
 
 #include <AsyncUDP.h>
@@ -14,67 +16,86 @@
 
 #define UDP_MULTICAST_DEFAUL_PORT 4403 // Default port for UDP multicast is same as TCP api server
 
-class UdpMulticastHandler final
-{
-  public:
-    UdpMulticastHandler() { udpIpAddress = IPAddress(224, 0, 0, 69); }
-
-    void start()
-    {
-        if (udp.listenMulticast(udpIpAddress, UDP_MULTICAST_DEFAUL_PORT, 64)) {
-#ifndef ARCH_PORTDUINO
-            // FIXME(PORTDUINO): arduino lacks IPAddress::toString()
-            LOG_DEBUG("UDP Listening on IP: %s", WiFi.localIP().toString().c_str());
-#else
-            LOG_DEBUG("UDP Listening");
-#endif
-            udp.onPacket([this](AsyncUDPPacket packet) { onReceive(packet); });
-        } else {
-            LOG_DEBUG("Failed to listen on UDP");
-        }
-    }
-
-    void onReceive(AsyncUDPPacket packet)
-    {
-        size_t packetLength = packet.length();
-#ifndef ARCH_PORTDUINO
-        // FIXME(PORTDUINO): arduino lacks IPAddress::toString()
-        LOG_DEBUG("UDP broadcast from: %s, len=%u", packet.remoteIP().toString().c_str(), packetLength);
+#ifndef UDP_MULTICAST_MAX_DATAGRAM
+#define UDP_MULTICAST_MAX_DATAGRAM 1024 // Largest datagram we receive, and the size of a batch we send
 #endif
-        meshtastic_MeshPacket mp;
-        LOG_DEBUG("Decoding MeshPacket from UDP len=%u", packetLength);
-        bool isPacketDecoded = pb_decode_from_bytes(packet.data(), packetLength, &meshtastic_MeshPacket_msg, &mp);
-        if (isPacketDecoded && router && mp.which_payload_variant == meshtastic_MeshPacket_encrypted_tag) {
-            mp.pki_encrypted = false;
-            mp.public_key.size = 0;
-            memset(mp.public_key.bytes, 0, sizeof(mp.public_key.bytes));
-            UniquePacketPoolPacket p = packetPool.allocUniqueCopy(mp);
-            // Unset received SNR/RSSI
-            p->rx_snr = 0;
-            p->rx_rssi = 0;
-            router->enqueueReceivedMessage(p.release());
-        }
-    }
-
-    bool onSend(const meshtastic_MeshPacket *mp)
-    {
-        if (!mp || !udp) {
-            return false;
-        }
-#ifndef ARCH_PORTDUINO
-        if (WiFi.status() != WL_CONNECTED) {
-            return false;
-        }
+#ifndef UDP_MULTICAST_RX_QUEUE
+#define UDP_MULTICAST_RX_QUEUE 4 // Datagrams the network thread can hand to us before it has to drop them
 #endif
-        LOG_DEBUG("Broadcasting packet over UDP (id=%u)", mp->id);
-        uint8_t buffer[meshtastic_MeshPacket_size];
-        size_t encodedLength = pb_encode_to_bytes(buffer, sizeof(buffer), &meshtastic_MeshPacket_msg, mp);
-        udp.writeTo(buffer, encodedLength, udpIpAddress, UDP_MULTICAST_DEFAUL_PORT);
-        return true;
-    }
+#define UDP_MULTICAST_RECENT_PACKETS 32 // Packets remembered to drop the copies other LAN nodes send us
+
+// Datagrams that start with these bytes hold several packets, each framed like the StreamAPI does: START1 START2 LEN_MSB
+// LEN_LSB and the encoded MeshPacket. No plain MeshPacket starts with 0x94.
+#define UDP_MULTICAST_BATCH_START1 0x94
+#define UDP_MULTICAST_BATCH_START2 0xc3
+#define UDP_MULTICAST_BATCH_HEADER 4
+
+/**
+ * Bridges the mesh to other nodes on the LAN over UDP multicast.
+ *
+ * AsyncUDP calls us on its own thread, which only copies the datagram into one of a few preallocated buffers and hands it
+ * over through a lock-free queue. Decoding, dropping duplicates and queueing for the Router happen on the main thread.
+ *
+ * Packets that we already got over LoRa (or sent ourselves) are dropped before the Router decrypts them, so are copies of
+ * the same packet sent by several LAN nodes.
+ *
+ * With a batch delay set, sent packets are collected for that long into one datagram. Nodes that don't know the batch
+ * framing can't read those, so it is off by default.
+ */
+class UdpMulticastHandler final : private concurrency::OSThread
+{
+  public:
+    UdpMulticastHandler();
+
+    bool start();
+
+    bool onSend(const meshtastic_MeshPacket *mp);
+
+    /// Collect sent packets for up to msec into one datagram, 0 sends every packet at once
+    void setBatchDelay(uint32_t msec);
+
+    /* Statistics. rxDatagrams and rxQueueFull are only written by the network thread */
+    uint32_t rxDatagrams = 0, rxQueueFull = 0, rxPackets = 0, rxDupe = 0, rxBad = 0;
+    uint32_t txPackets = 0, txDatagrams = 0;
+
+  protected:
+    virtual int32_t runOnce() override;
 
   private:
+    struct Datagram {
+        uint16_t length;
+        uint8_t bytes[UDP_MULTICAST_MAX_DATAGRAM];
+    };
+
+    struct RecentPacket {
+        NodeNum from;
+        PacketId id;
+    };
+
     IPAddress udpIpAddress;
     AsyncUDP udp;
+
+    Datagram *datagrams = NULL;
+    PointerQueue<Datagram> freeDatagrams, rxDatagramQueue;
+
+    RecentPacket recent[UDP_MULTICAST_RECENT_PACKETS] = {};
+    uint8_t recentNext = 0;
+
+    uint32_t batchDelayMsec = 0;
+    uint32_t batchStartMsec = 0;
+    uint8_t *batch = NULL;
+    size_t batchLength = 0;
+
+    /// Called on the network thread
+    void onReceive(AsyncUDPPacket &packet);
+
+    void handleDatagram(const uint8_t *bytes, size_t length);
+    void handlePacket(const uint8_t *bytes, size_t length);
+
+    /// Whether we have seen this packet before, remembers it if not
+    bool isDuplicate(const meshtastic_MeshPacket &mp);
+
+    void write(const uint8_t *bytes, size_t length);
+    void flushBatch();
 };
-#endif // HAS_UDP_MULTICAST
\ No newline at end of file
+#endif // HAS_UDP_MULTICAST
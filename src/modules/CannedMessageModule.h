@@ -102,6 +102,8 @@ class CannedMessageModule : public SinglePortModule, public Observable<const UIF
             lastRxSnr = p->rx_snr;
         return (p->decoded.portnum == meshtastic_PortNum_ROUTING_APP) ? waitingForAck : false;
     }
+    // wantPacket() samples the signal of every packet, so it has to see them all
+    virtual meshtastic_PortNum getPortNum() override { return meshtastic_PortNum_UNKNOWN_APP; }
 
   protected:
     // === Thread Entry Point ===
@@ -64,6 +64,7 @@ class ExternalNotificationModule : public SinglePortModule, private concurrency:
     virtual int32_t runOnce() override;
 
     virtual bool wantPacket(const meshtastic_MeshPacket *p) override;
+    virtual meshtastic_PortNum getPortNum() override { return meshtastic_PortNum_UNKNOWN_APP; }
 
     bool isNagging = false;
 
@@ -70,6 +70,7 @@ void StoreForwardModule::populatePSRAM()
         https://learn.upesy.com/en/programmation/psram.html#psram-tab
     */
 
+    freePSRAM();
     LOG_DEBUG("Before PSRAM init: heap %d/%d PSRAM %d/%d", memGet.getFreeHeap(), memGet.getHeapSize(), memGet.getFreePsram(),
               memGet.getPsramSize());
 
@@ -85,12 +86,30 @@ void StoreForwardModule::populatePSRAM()
     this->packetHistory = static_cast<PacketHistoryStruct *>(calloc(numberOfPackets, sizeof(PacketHistoryStruct)));
 
 #endif
+    if (this->packetHistory) {
+        this->packetHistoryBytes = numberOfPackets * sizeof(PacketHistoryStruct);
+        memGet.countAlloc(MemTag::StoreForward, this->packetHistoryBytes);
+    }
 
     LOG_DEBUG("After PSRAM init: heap %d/%d PSRAM %d/%d", memGet.getFreeHeap(), memGet.getHeapSize(), memGet.getFreePsram(),
               memGet.getPsramSize());
     LOG_DEBUG("numberOfPackets for packetHistory - %u", numberOfPackets);
 }
 
+/**
+ * Releases the message history, and its share of the memory stats.
+ */
+void StoreForwardModule::freePSRAM()
+{
+    if (!this->packetHistory)
+        return;
+    free(this->packetHistory);
+    memGet.countFree(MemTag::StoreForward, this->packetHistoryBytes);
+    this->packetHistory = NULL;
+    this->packetHistoryBytes = 0;
+    this->packetHistoryTotalCount = 0;
+}
+
 /**
  * Sends messages from the message history to the specified recipient.
  *
@@ -623,4 +642,8 @@ StoreForwardModule::StoreForwardModule()
         disable();
     }
 #endif
-}
\ No newline at end of file
+}
+StoreForwardModule::~StoreForwardModule()
+{
+    freePSRAM();
+}
@@ -28,6 +28,7 @@ class StoreForwardModule : private concurrency::OSThread, public ProtobufModule<
     char routerMessage[meshtastic_Constants_DATA_PAYLOAD_LEN] = {0};
 
     PacketHistoryStruct *packetHistory = 0;
+    size_t packetHistoryBytes = 0; // as counted by memGet
     uint32_t packetHistoryTotalCount = 0;
     uint32_t last_time = 0;
     uint32_t requestCount = 0;
@@ -42,6 +43,7 @@ class StoreForwardModule : private concurrency::OSThread, public ProtobufModule<
 
   public:
     StoreForwardModule();
+    ~StoreForwardModule();
 
     unsigned long lastHeartbeat = 0;
     uint32_t heartbeatInterval = 900;
@@ -80,9 +82,11 @@ class StoreForwardModule : private concurrency::OSThread, public ProtobufModule<
             return false;
         }
     }
+    virtual meshtastic_PortNum getPortNum() override { return meshtastic_PortNum_UNKNOWN_APP; }
 
   private:
     void populatePSRAM();
+    void freePSRAM();
 
     // S&F Defaults
     uint32_t historyReturnMax = 25;     // Return maximum of 25 records by default.
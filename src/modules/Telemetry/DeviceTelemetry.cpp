@@ -7,6 +7,8 @@
 #include "RTC.h"
 #include "RadioLibInterface.h"
 #include "Router.h"
+#include "TelemetryHistory.h"
+#include "Throttle.h"
 #include "configuration.h"
 #include "main.h"
 #include "memGet.h"
@@ -15,6 +17,7 @@
 #include <meshUtils.h>
 
 #define MAGIC_USB_BATTERY_LEVEL 101
+#define LOCAL_STATS_DUMP_INTERVAL_MSEC (15 * 60 * 1000) // Local stats can be requested at any rate, the dumps are limited to this
 
 int32_t DeviceTelemetryModule::runOnce()
 {
@@ -57,6 +60,10 @@ bool DeviceTelemetryModule::handleReceivedProtobuf(const meshtastic_MeshPacket &
                  t->variant.device_metrics.battery_level, t->variant.device_metrics.voltage);
 #endif
         nodeDB->updateTelemetry(getFrom(&mp), *t, RX_SRC_RADIO);
+#if HAS_TELEMETRY_HISTORY
+        if (telemetryHistory)
+            telemetryHistory->record(getFrom(&mp), *t, getTime());
+#endif
     }
     return false; // Let others look at this message also if they want
 }
@@ -150,6 +157,13 @@ meshtastic_Telemetry DeviceTelemetryModule::getLocalStatsTelemetry()
 
     LOG_INFO("num_packets_tx=%i, num_packets_rx=%i, num_packets_rx_bad=%i", telemetry.variant.local_stats.num_packets_tx,
              telemetry.variant.local_stats.num_packets_rx, telemetry.variant.local_stats.num_packets_rx_bad);
+    static uint32_t lastDump = 0;
+    if (lastDump == 0 || !Throttle::isWithinTimespanMs(lastDump, LOCAL_STATS_DUMP_INTERVAL_MSEC)) {
+        lastDump = millis();
+        memGet.logStats();
+        if (router && router->floodGuard.isEnabled())
+            router->floodGuard.log();
+    }
 
     return telemetry;
 }
@@ -178,6 +192,10 @@ bool DeviceTelemetryModule::sendTelemetry(NodeNum dest, bool phoneOnly)
     p->priority = meshtastic_MeshPacket_Priority_BACKGROUND;
 
     nodeDB->updateTelemetry(nodeDB->getNodeNum(), telemetry, RX_SRC_LOCAL);
+#if HAS_TELEMETRY_HISTORY
+    if (telemetryHistory)
+        telemetryHistory->record(nodeDB->getNodeNum(), telemetry, getTime());
+#endif
     if (phoneOnly) {
         LOG_INFO("Send packet to phone");
         service->sendToPhone(p);
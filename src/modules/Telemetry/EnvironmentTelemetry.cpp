@@ -10,6 +10,7 @@
 #include "PowerFSM.h"
 #include "RTC.h"
 #include "Router.h"
+#include "TelemetryHistory.h"
 #include "UnitConversions.h"
 #include "buzz.h"
 #include "graphics/SharedUIDisplay.h"
@@ -521,6 +522,10 @@ bool EnvironmentTelemetryModule::handleReceivedProtobuf(const meshtastic_MeshPac
 
         LOG_INFO("(Received from %s): radiation=%fµR/h", sender, t->variant.environment_metrics.radiation);
 
+#endif
+#if HAS_TELEMETRY_HISTORY
+        if (telemetryHistory)
+            telemetryHistory->record(getFrom(&mp), *t, getTime());
 #endif
         // release previous packet before occupying a new spot
         if (lastMeasurementPacket != nullptr)
@@ -742,6 +747,10 @@ bool EnvironmentTelemetryModule::sendTelemetry(NodeNum dest, bool phoneOnly)
 
         LOG_INFO("Send: soil_temperature=%f, soil_moisture=%u", m.variant.environment_metrics.soil_temperature,
                  m.variant.environment_metrics.soil_moisture);
+#if HAS_TELEMETRY_HISTORY
+        if (telemetryHistory)
+            telemetryHistory->record(nodeDB->getNodeNum(), m, getTime());
+#endif
 
         sensor_read_error_count = 0;
 
@@ -10,6 +10,7 @@
 #include "PowerTelemetry.h"
 #include "RTC.h"
 #include "Router.h"
+#include "TelemetryHistory.h"
 #include "graphics/SharedUIDisplay.h"
 #include "main.h"
 #include "power.h"
@@ -176,6 +177,10 @@ bool PowerTelemetryModule::handleReceivedProtobuf(const meshtastic_MeshPacket &m
                  sender, t->variant.power_metrics.ch1_voltage, t->variant.power_metrics.ch1_current,
                  t->variant.power_metrics.ch2_voltage, t->variant.power_metrics.ch2_current, t->variant.power_metrics.ch3_voltage,
                  t->variant.power_metrics.ch3_current);
+#endif
+#if HAS_TELEMETRY_HISTORY
+        if (telemetryHistory)
+            telemetryHistory->record(getFrom(&mp), *t, getTime());
 #endif
         // release previous packet before occupying a new spot
         if (lastMeasurementPacket != nullptr)
@@ -251,6 +256,10 @@ bool PowerTelemetryModule::sendTelemetry(NodeNum dest, bool phoneOnly)
                  m.variant.power_metrics.ch2_current, m.variant.power_metrics.ch3_voltage, m.variant.power_metrics.ch3_current);
 
         sensor_read_error_count = 0;
+#if HAS_TELEMETRY_HISTORY
+        if (telemetryHistory)
+            telemetryHistory->record(nodeDB->getNodeNum(), m, getTime());
+#endif
 
         meshtastic_MeshPacket *p = allocDataProtobuf(m);
         p->to = dest;
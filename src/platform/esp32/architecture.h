@@ -39,6 +39,16 @@
 #ifndef HAS_CPU_SHUTDOWN
 #define HAS_CPU_SHUTDOWN 1
 #endif
+// Its memory is allocated for good, so only where there is PSRAM for it
+#if !defined(HAS_TELEMETRY_HISTORY) && defined(BOARD_HAS_PSRAM)
+#define HAS_TELEMETRY_HISTORY 1
+#endif
+#if !defined(TELEMETRY_HISTORY_BYTES) && defined(BOARD_HAS_PSRAM)
+#define TELEMETRY_HISTORY_BYTES (256 * 1024)
+#endif
+#ifndef PKI_SHARED_KEY_CACHE
+#define PKI_SHARED_KEY_CACHE 4
+#endif
 #ifndef DEFAULT_VREF
 #define DEFAULT_VREF 1100
 #endif
@@ -0,0 +1,133 @@
+#include "CryptoEngine.h"
+#include "configuration.h"
+
+#if HAS_CUSTOM_CRYPTO_ENGINE
+
+#include <openssl/evp.h>
+
+/**
+ * CryptoEngine on top of OpenSSL, which picks AES-NI/VAES or the ARMv8 crypto extensions when the CPU has them.
+ *
+ * The cipher contexts live as long as the engine and the key schedule is only expanded again when the key changes, so
+ * encrypting a packet with the channel key is just an IV reset and one EVP_EncryptUpdate(). PKI keeps the CCM mode of
+ * aes-ccm.cpp, built on our aesEncrypt().
+ */
+class PortduinoCryptoEngine : public CryptoEngine
+{
+    EVP_CIPHER_CTX *ctrCtx;
+    CryptoKey ctrKey = {};
+
+#if !(MESHTASTIC_EXCLUDE_PKI)
+    EVP_CIPHER_CTX *blockCtx;
+    uint8_t blockKey[32] = {0};
+    size_t blockKeyLen = 0;
+
+    EVP_MD_CTX *mdCtx;
+
+    EVP_PKEY *dhKey = NULL;
+    uint8_t dhKeyBytes[32] = {0}; // private_key that dhKey was made from
+#endif
+
+  public:
+    PortduinoCryptoEngine()
+    {
+        ctrCtx = EVP_CIPHER_CTX_new();
+#if !(MESHTASTIC_EXCLUDE_PKI)
+        blockCtx = EVP_CIPHER_CTX_new();
+        mdCtx = EVP_MD_CTX_new();
+#endif
+    }
+
+    ~PortduinoCryptoEngine()
+    {
+        EVP_CIPHER_CTX_free(ctrCtx);
+#if !(MESHTASTIC_EXCLUDE_PKI)
+        EVP_CIPHER_CTX_free(blockCtx);
+        EVP_MD_CTX_free(mdCtx);
+        EVP_PKEY_free(dhKey);
+#endif
+    }
+
+    virtual void encryptAESCtr(CryptoKey _key, uint8_t *_nonce, size_t numBytes, uint8_t *bytes) override
+    {
+        if (_key.length <= 0)
+            return;
+        if (numBytes > MAX_BLOCKSIZE) {
+            LOG_ERROR("Packet too large for crypto engine: %d. noop encryption!", numBytes);
+            return;
+        }
+
+        bool ok;
+        if (_key.length == ctrKey.length && memcmp(_key.bytes, ctrKey.bytes, _key.length) == 0) {
+            ok = EVP_EncryptInit_ex(ctrCtx, NULL, NULL, NULL, _nonce); // Same key, only restart the counter
+        } else {
+            ok = EVP_EncryptInit_ex(ctrCtx, _key.length == 16 ? EVP_aes_128_ctr() : EVP_aes_256_ctr(), NULL, _key.bytes,
+                                    _nonce);
+            ctrKey = ok ? _key : CryptoKey{};
+        }
+
+        int outLen;
+        if (!ok || !EVP_EncryptUpdate(ctrCtx, bytes, &outLen, bytes, numBytes)) {
+            LOG_ERROR("OpenSSL AES-CTR failed");
+            ctrKey = {};
+        }
+    }
+
+#if !(MESHTASTIC_EXCLUDE_PKI)
+    virtual void hash(uint8_t *bytes, size_t numBytes) override
+    {
+        unsigned int len;
+        if (!EVP_DigestInit_ex(mdCtx, EVP_sha256(), NULL) || !EVP_DigestUpdate(mdCtx, bytes, numBytes) ||
+            !EVP_DigestFinal_ex(mdCtx, bytes, &len))
+            LOG_ERROR("OpenSSL SHA256 failed");
+    }
+
+    virtual void aesSetKey(const uint8_t *key_bytes, size_t key_len) override
+    {
+        if (key_len == 0 || (key_len == blockKeyLen && memcmp(key_bytes, blockKey, key_len) == 0))
+            return;
+        if (!EVP_EncryptInit_ex(blockCtx, key_len == 16 ? EVP_aes_128_ecb() : EVP_aes_256_ecb(), NULL, key_bytes, NULL)) {
+            LOG_ERROR("OpenSSL AES key setup failed");
+            blockKeyLen = 0;
+            return;
+        }
+        EVP_CIPHER_CTX_set_padding(blockCtx, 0);
+        memcpy(blockKey, key_bytes, key_len);
+        blockKeyLen = key_len;
+    }
+
+    virtual void aesEncrypt(uint8_t *in, uint8_t *out) override
+    {
+        int outLen;
+        if (!EVP_EncryptUpdate(blockCtx, out, &outLen, in, 16))
+            LOG_ERROR("OpenSSL AES failed");
+    }
+
+    virtual bool setDHPublicKey(uint8_t *pubKey) override
+    {
+        if (!dhKey || memcmp(dhKeyBytes, private_key, sizeof(dhKeyBytes)) != 0) {
+            EVP_PKEY_free(dhKey);
+            dhKey = EVP_PKEY_new_raw_private_key(EVP_PKEY_X25519, NULL, private_key, sizeof(private_key));
+            memcpy(dhKeyBytes, private_key, sizeof(dhKeyBytes));
+        }
+        EVP_PKEY *peer = EVP_PKEY_new_raw_public_key(EVP_PKEY_X25519, NULL, pubKey, 32);
+        EVP_PKEY_CTX *ctx = dhKey ? EVP_PKEY_CTX_new(dhKey, NULL) : NULL;
+        size_t len = sizeof(shared_key);
+
+        // OpenSSL refuses an all zero shared secret, which is the weak key check of Curve25519::dh2()
+        bool ok = peer && ctx && EVP_PKEY_derive_init(ctx) > 0 && EVP_PKEY_derive_set_peer(ctx, peer) > 0 &&
+                  EVP_PKEY_derive(ctx, shared_key, &len) > 0 && len == sizeof(shared_key);
+        EVP_PKEY_CTX_free(ctx);
+        EVP_PKEY_free(peer);
+        if (!ok) {
+            memset(shared_key, 0, sizeof(shared_key));
+            LOG_WARN("Curve25519DH step 2 failed!");
+        }
+        return ok;
+    }
+#endif
+};
+
+CryptoEngine *crypto = new PortduinoCryptoEngine();
+
+#endif
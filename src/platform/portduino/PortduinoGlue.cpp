@@ -7,13 +7,18 @@
 
 #include "PortduinoGlue.h"
 #include "api/ServerAPI.h"
+#include "concurrency/ThreadTrace.h"
 #include "linux/gpio/LinuxGPIOPin.h"
+#include "mesh/FloodGuard.h"
+#include "mesh/PacketCapture.h"
+#include "mesh/PacketHistory.h"
 #include "meshUtils.h"
 #include "yaml-cpp/yaml.h"
 #include <Utility.h>
 #include <assert.h>
 #include <bluetooth/bluetooth.h>
 #include <bluetooth/hci.h>
+#include <csignal>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -34,6 +39,10 @@ Ch341Hal *ch341Hal = nullptr;
 char *configPath = nullptr;
 char *optionMac = nullptr;
 bool forceSimulated = false;
+volatile sig_atomic_t stopSignal = 0;
+char *replayPath = nullptr;
+float replaySpeed = 1;
+bool rescanI2C = false;
 
 // FIXME - move setBluetoothEnable into a HALPlatform class
 void setBluetoothEnable(bool enable)
@@ -50,6 +59,9 @@ void updateBatteryLevel(uint8_t level) NOT_IMPLEMENTED("updateBatteryLevel");
 
 int TCPPort = SERVER_API_DEFAULT_PORT;
 
+#define OPTION_REPLAY_SPEED 0x100 // Long option only
+#define OPTION_RESCAN_I2C 0x101   // Long option only
+
 static error_t parse_opt(int key, char *arg, struct argp_state *state)
 {
     switch (key) {
@@ -68,6 +80,16 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state)
     case 'h':
         optionMac = arg;
         break;
+    case 'r':
+        replayPath = arg;
+        break;
+    case OPTION_REPLAY_SPEED:
+        if (sscanf(arg, "%f", &replaySpeed) < 1 || replaySpeed < 0)
+            return ARGP_ERR_UNKNOWN;
+        break;
+    case OPTION_RESCAN_I2C:
+        rescanI2C = true;
+        break;
 
     case ARGP_KEY_ARG:
         return 0;
@@ -83,6 +105,11 @@ void portduinoCustomInit()
                                            {"config", 'c', "CONFIG_PATH", 0, "Full path of the .yaml config file to use."},
                                            {"hwid", 'h', "HWID", 0, "The mac address to assign to this virtual machine"},
                                            {"sim", 's', 0, 0, "Run in Simulated radio mode"},
+                                           {"replay", 'r', "CAPTURE", 0, "Feed the received frames of a capture to the router"},
+                                           {"replay-speed", OPTION_REPLAY_SPEED, "SPEED", 0,
+                                            "Replay at SPEED times the captured pace, 0 for as fast as possible (default 1)"},
+                                           {"rescan-i2c", OPTION_RESCAN_I2C, 0, 0,
+                                            "Forget the I2C devices found on previous boots and identify all of them again"},
                                            {0}};
     static void *childArguments;
     static char doc[] = "Meshtastic native build.";
@@ -135,6 +162,12 @@ void getMacAddr(uint8_t *dmac)
     }
 }
 
+/// SIGTERM and SIGINT ask loop() for a clean shutdown, a second one stops us right away
+static void handleStopSignal(int sig)
+{
+    stopSignal = sig;
+}
+
 /** apps run under portduino can optionally define a portduinoSetup() to
  * use portduino specific init code (such as gpioBind) to setup portduino on their host machine,
  * before running 'arduino' code.
@@ -142,6 +175,12 @@ void getMacAddr(uint8_t *dmac)
 void portduinoSetup()
 {
     printf("Set up Meshtastic on Portduino...\n");
+    struct sigaction stopAction = {};
+    stopAction.sa_handler = handleStopSignal;
+    stopAction.sa_flags = SA_RESETHAND;
+    sigaction(SIGTERM, &stopAction, NULL);
+    sigaction(SIGINT, &stopAction, NULL);
+
     int max_GPIO = 0;
     const configNames GPIO_lines[] = {cs_pin,
                                       irq_pin,
@@ -415,6 +454,21 @@ void portduinoSetup()
             exit(EXIT_FAILURE);
         }
     }
+    if (settingsStrings[threadTraceFilename] != "") {
+#if HAS_THREAD_PROFILER
+        if (!concurrency::threadTrace.open(settingsStrings[threadTraceFilename])) {
+            std::cout << "*** Cannot open thread trace file " << settingsStrings[threadTraceFilename] << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        std::atexit([] { concurrency::threadTrace.close(); });
+#else
+        std::cout << "*** Thread trace needs a build with HAS_THREAD_PROFILER" << std::endl;
+#endif
+    }
+    if (settingsStrings[packetCaptureFilename] != "" && !packetCapture.open(settingsStrings[packetCaptureFilename].c_str())) {
+        std::cout << "*** Cannot open packet capture file " << settingsStrings[packetCaptureFilename] << std::endl;
+        exit(EXIT_FAILURE);
+    }
 
     return;
 }
@@ -459,6 +513,8 @@ bool loadConfig(const char *configPath)
                 settingsMap[logoutputlevel] = level_error;
             }
             settingsStrings[traceFilename] = yamlConfig["Logging"]["TraceFile"].as<std::string>("");
+            settingsStrings[threadTraceFilename] = yamlConfig["Logging"]["ThreadTraceFile"].as<std::string>("");
+            settingsStrings[packetCaptureFilename] = yamlConfig["Logging"]["PacketCapture"].as<std::string>("");
             if (yamlConfig["Logging"]["AsciiLogs"]) {
                 // Default is !isatty(1) but can be set explicitly in config.yaml
                 settingsMap[ascii_logs] = yamlConfig["Logging"]["AsciiLogs"].as<bool>();
@@ -494,6 +550,21 @@ bool loadConfig(const char *configPath)
             if (settingsMap[dio3_tcxo_voltage] == 0 && yamlConfig["Lora"]["DIO3_TCXO_VOLTAGE"].as<bool>(false)) {
                 settingsMap[dio3_tcxo_voltage] = 1800; // default millivolts for "true"
             }
+            settingsMap[lora_adaptive_contention] = yamlConfig["Lora"]["AdaptiveContention"].as<bool>(false);
+            settingsMap[lora_coverage_suppression] = yamlConfig["Lora"]["CoverageSuppression"].as<int>(0);
+            // A packet record only keeps NUM_RELAYERS relayers, more could never be counted and would disable suppression
+            if (settingsMap[lora_coverage_suppression] < 0 || settingsMap[lora_coverage_suppression] > NUM_RELAYERS) {
+                int clamped = settingsMap[lora_coverage_suppression] < 0 ? 0 : NUM_RELAYERS;
+                std::cout << "Warning, CoverageSuppression " << settingsMap[lora_coverage_suppression] << " is outside 0.."
+                          << NUM_RELAYERS << ", using " << clamped << std::endl;
+                settingsMap[lora_coverage_suppression] = clamped;
+            }
+            settingsMap[flood_guard_local_per_minute] =
+                yamlConfig["Lora"]["FloodGuardLocalPerMinute"].as<int>(FLOOD_GUARD_LOCAL_PER_MINUTE);
+            settingsMap[flood_guard_local_burst] = yamlConfig["Lora"]["FloodGuardLocalBurst"].as<int>(FLOOD_GUARD_LOCAL_BURST);
+            settingsMap[flood_guard_relay_per_minute] =
+                yamlConfig["Lora"]["FloodGuardRelayPerMinute"].as<int>(FLOOD_GUARD_RELAY_PER_MINUTE);
+            settingsMap[flood_guard_relay_burst] = yamlConfig["Lora"]["FloodGuardRelayBurst"].as<int>(FLOOD_GUARD_RELAY_BURST);
 
             // backwards API compatibility and to globally set gpiochip once
             int defaultGpioChip = settingsMap[default_gpiochip] = yamlConfig["Lora"]["gpiochip"].as<int>(0);
@@ -687,6 +758,9 @@ bool loadConfig(const char *configPath)
             settingsStrings[mac_address].erase(
                 std::remove(settingsStrings[mac_address].begin(), settingsStrings[mac_address].end(), ':'),
                 settingsStrings[mac_address].end());
+
+            settingsStrings[shm_api_name] = (yamlConfig["General"]["SharedMemoryAPI"]).as<std::string>("");
+            settingsMap[udp_batch_msec] = (yamlConfig["General"]["UDPBatchMsec"]).as<int>(0);
         }
     } catch (YAML::Exception &e) {
         std::cout << "*** Exception " << e.what() << std::endl;
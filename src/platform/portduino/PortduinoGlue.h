@@ -1,4 +1,5 @@
 #pragma once
+#include <csignal>
 #include <fstream>
 #include <map>
 #include <unordered_map>
@@ -44,6 +45,12 @@ enum configNames {
     rf95_max_power,
     dio2_as_rf_switch,
     dio3_tcxo_voltage,
+    lora_adaptive_contention,
+    lora_coverage_suppression,
+    flood_guard_local_per_minute,
+    flood_guard_local_burst,
+    flood_guard_relay_per_minute,
+    flood_guard_relay_burst,
     use_simradio,
     use_autoconf,
     use_rf95,
@@ -96,6 +103,8 @@ enum configNames {
     pointerDevice,
     logoutputlevel,
     traceFilename,
+    threadTraceFilename,
+    packetCaptureFilename,
     webserver,
     webserverport,
     webserverrootpath,
@@ -107,6 +116,8 @@ enum configNames {
     config_directory,
     available_directory,
     mac_address,
+    shm_api_name,
+    udp_batch_msec,
     hostMetrics_interval,
     hostMetrics_channel,
     hostMetrics_user_command
@@ -118,7 +129,11 @@ enum { level_error, level_warn, level_info, level_debug, level_trace };
 extern std::map<configNames, int> settingsMap;
 extern std::map<configNames, std::string> settingsStrings;
 extern std::ofstream traceFile;
+extern char *replayPath;
+extern float replaySpeed;
+extern bool rescanI2C; // --rescan-i2c, see ScanI2CTwoWire::clearCache()
 extern Ch341Hal *ch341Hal;
+extern volatile sig_atomic_t stopSignal; // Set by SIGTERM or SIGINT, see powerCommandsCheck()
 int initGPIOPin(int pinNum, std::string gpioChipname, int line);
 bool loadConfig(const char *configPath);
 static bool ends_with(std::string_view str, std::string_view suffix);
@@ -1,5 +1,8 @@
 #include "SimRadio.h"
 #include "MeshService.h"
+#include "Metrics.h"
+#include "PacketCapture.h"
+#include "PacketTrace.h"
 #include "Router.h"
 
 SimRadio::SimRadio() : NotifiedWorkerThread("SimRadio")
@@ -19,6 +22,7 @@ ErrorCode SimRadio::send(meshtastic_MeshPacket *p)
         packetPool.release(p);
         return res;
     }
+    PACKET_TRACE(p, TX_QUEUED);
 
     // set (random) transmit delay to let others reconfigure their radio,
     // to avoid collisions and implement timing-based flooding
@@ -90,6 +94,7 @@ void SimRadio::completeSending()
         txGood++;
         if (!isFromUs(p))
             txRelay++;
+        PACKET_TRACE(p, TX_DONE);
         printPacket("Completed sending", p);
 
         // We are done sending that packet, release it
@@ -175,12 +180,16 @@ void SimRadio::onNotify(uint32_t notification)
             } else {
                 if (isChannelActive()) { // check if there is currently a LoRa packet on the channel
                     // LOG_DEBUG("Channel is active: set random delay");
+                    contentionWindow.onChannelBusy();
+                    PACKET_TRACE(txQueue.getFront(), TX_CAD_BUSY);
                     setTransmitDelay(); // reset random delay
                 } else {
+                    contentionWindow.onChannelIdle();
                     // Send any outgoing packets we have ready
                     meshtastic_MeshPacket *txp = txQueue.dequeue();
                     assert(txp);
                     startSend(txp);
+                    PACKET_TRACE(txp, TX_START);
                     // Packet has been sent, count it toward our TX airtime utilization.
                     uint32_t xmitMsec = getPacketTime(txp);
                     airTime->logAirtime(TX_LOG, xmitMsec);
@@ -203,6 +212,7 @@ void SimRadio::startSend(meshtastic_MeshPacket *txp)
     printPacket("Start low level send", txp);
     isReceiving = false;
     size_t numbytes = beginSending(txp);
+    packetCapture.writeFrame(PacketCapture::TX, (uint8_t *)&radioBuffer, numbytes, 0, 0);
     meshtastic_MeshPacket *p = packetPool.allocCopy(*txp);
     perhapsDecode(p);
     meshtastic_Compressed c = meshtastic_Compressed_init_default;
@@ -252,6 +262,7 @@ void SimRadio::startReceive(meshtastic_MeshPacket *p)
     if (isActivelyReceiving()) {
         LOG_WARN("Collision detected, dropping current and previous packet!");
         rxBad++;
+        contentionWindow.onReceived(true);
         airTime->logAirtime(RX_ALL_LOG, getPacketTime(receivingPacket));
         packetPool.release(receivingPacket);
         receivingPacket = nullptr;
@@ -291,6 +302,19 @@ meshtastic_QueueStatus SimRadio::getQueueStatus()
     return qs;
 }
 
+#if HAS_METRICS
+void SimRadio::registerMetrics()
+{
+    RadioInterface::registerMetrics();
+    metrics.addCounter("meshtastic_rx_good_total", "Packets received from the radio", &rxGood);
+    metrics.addCounter("meshtastic_rx_bad_total", "Corrupted or malformed packets received from the radio", &rxBad);
+    metrics.addCounter("meshtastic_tx_good_total", "Packets transmitted", &txGood);
+    metrics.addCounter("meshtastic_tx_relay_total", "Packets of other nodes transmitted", &txRelay);
+    metrics.addGauge("meshtastic_tx_queue_free", "Free slots in the TX queue",
+                     []() -> float { return SimRadio::instance->getQueueStatus().free; });
+}
+#endif
+
 void SimRadio::handleReceiveInterrupt()
 {
     if (receivingPacket == nullptr) {
@@ -304,12 +328,15 @@ void SimRadio::handleReceiveInterrupt()
 
     LOG_DEBUG("HANDLE RECEIVE INTERRUPT");
     rxGood++;
+    contentionWindow.onReceived(false);
 
     meshtastic_MeshPacket *mp = packetPool.allocCopy(*receivingPacket); // keep a copy in packetPool
     packetPool.release(receivingPacket);                                // release the original
     receivingPacket = nullptr;
+    packetCapture.writePacket(PacketCapture::RX, mp);
 
     printPacket("Lora RX", mp);
+    PACKET_TRACE(mp, RX);
 
     airTime->logAirtime(RX_LOG, getPacketTime(mp));
 
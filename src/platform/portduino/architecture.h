@@ -26,6 +26,31 @@
 #ifndef HAS_SENSOR
 #define HAS_SENSOR 1
 #endif
+#ifndef HAS_PACKET_TRACE
+#define HAS_PACKET_TRACE 1
+#endif
+#ifndef HAS_METRICS
+#define HAS_METRICS 1
+#endif
+#ifndef HAS_PHONEAPI_CACHE
+#define HAS_PHONEAPI_CACHE 1
+#endif
+#ifndef HAS_MEMORY_STATS
+#define HAS_MEMORY_STATS 1
+#endif
+#ifndef HAS_TELEMETRY_HISTORY
+#define HAS_TELEMETRY_HISTORY 1
+#endif
+#ifndef TELEMETRY_HISTORY_BYTES
+#define TELEMETRY_HISTORY_BYTES (2 * 1024 * 1024)
+#endif
+#ifndef PKI_SHARED_KEY_CACHE
+#define PKI_SHARED_KEY_CACHE 8
+#endif
+// OpenSSL comes with the web server dependencies, use it for AES, X25519 and SHA256 when it is there
+#if !defined(HAS_CUSTOM_CRYPTO_ENGINE) && __has_include(<openssl/evp.h>)
+#define HAS_CUSTOM_CRYPTO_ENGINE 1
+#endif
 #ifndef HAS_TRACKBALL
 #define HAS_TRACKBALL 1
 #define TB_DOWN (uint8_t) settingsMap[tbDownPin]
@@ -1,3 +1,4 @@
+#include "NodeDB.h"
 #include "buzz.h"
 #include "configuration.h"
 #include "graphics/Screen.h"
@@ -7,13 +8,23 @@
 #if defined(ARCH_PORTDUINO)
 #include "api/WiFiServerAPI.h"
 #include "input/LinuxInputImpl.h"
+#include "platform/portduino/PortduinoGlue.h"
 
 #endif
 
 void powerCommandsCheck()
 {
+#if defined(ARCH_PORTDUINO)
+    if (stopSignal && !shutdownAtMsec) {
+        LOG_INFO("Stop requested by signal %d", (int)stopSignal);
+        shutdownAtMsec = millis();
+    }
+#endif
+
     if (rebootAtMsec && millis() > rebootAtMsec) {
         LOG_INFO("Rebooting");
+        if (nodeDB)
+            nodeDB->flushPendingSaves();
         notifyReboot.notifyObservers(NULL);
 #if defined(ARCH_ESP32)
         ESP.restart();
@@ -48,6 +59,8 @@ void powerCommandsCheck()
 
     if (shutdownAtMsec && millis() > shutdownAtMsec) {
         LOG_INFO("Shut down from admin command");
+        if (nodeDB)
+            nodeDB->flushPendingSaves();
 #if defined(ARCH_NRF52) || defined(ARCH_ESP32) || defined(ARCH_RP2040)
         playShutdownMelody();
         power->shutdown();
@@ -226,6 +226,8 @@ void doDeepSleep(uint32_t msecToWake, bool skipPreflight = false, bool skipSaveN
 
     if (!skipSaveNodeDb) {
         nodeDB->saveToDisk();
+    } else {
+        nodeDB->flushPendingSaves(); // Settings that were just changed must survive anyway
     }
 
 #ifdef PIN_POWER_EN
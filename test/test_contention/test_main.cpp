@@ -0,0 +1,221 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include "mesh/ContentionWindow.h"
+#include <unity.h>
+
+#include <algorithm>
+#include <vector>
+
+#define CW_MIN 3
+#define CW_MAX 8
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_startsAtMinimum(void)
+{
+    ContentionWindow cw(CW_MIN, CW_MAX);
+    TEST_ASSERT_EQUAL_UINT16(1 << CW_MIN, cw.getWindowSlots());
+    TEST_ASSERT_EQUAL_UINT8(CW_MIN, cw.getCWsize());
+}
+
+void test_busyIncreasesMultiplicatively(void)
+{
+    ContentionWindow cw(CW_MIN, CW_MAX);
+    cw.onChannelBusy();
+    TEST_ASSERT_EQUAL_UINT16(16, cw.getWindowSlots());
+    cw.onReceived(true);
+    TEST_ASSERT_EQUAL_UINT16(32, cw.getWindowSlots());
+    for (int i = 0; i < 10; i++)
+        cw.onChannelBusy();
+    TEST_ASSERT_EQUAL_UINT16(1 << CW_MAX, cw.getWindowSlots());
+    TEST_ASSERT_EQUAL_UINT8(CW_MAX, cw.getCWsize());
+}
+
+void test_idleDecreasesAdditively(void)
+{
+    ContentionWindow cw(CW_MIN, CW_MAX);
+    cw.onChannelBusy();
+    cw.onChannelBusy(); // 32 slots
+    cw.onChannelIdle();
+    TEST_ASSERT_EQUAL_UINT16(28, cw.getWindowSlots());
+    TEST_ASSERT_EQUAL_UINT8(5, cw.getCWsize());
+    for (int i = 0; i < 20; i++)
+        cw.onChannelIdle();
+    TEST_ASSERT_EQUAL_UINT16(1 << CW_MIN, cw.getWindowSlots());
+}
+
+void test_duplicatesRaiseFloor(void)
+{
+    ContentionWindow cw(CW_MIN, CW_MAX);
+    for (int i = 0; i < 100; i++) {
+        cw.onReceived(false);
+        cw.onDuplicate();
+    }
+    for (int i = 0; i < 100; i++)
+        cw.onChannelIdle();
+    TEST_ASSERT_GREATER_THAN_UINT16(1 << CW_MIN, cw.getWindowSlots());
+    TEST_ASSERT_LESS_OR_EQUAL_UINT16(((1 << CW_MAX) + (1 << CW_MIN)) / 2, cw.getWindowSlots());
+
+    const ContentionWindow::Stats &stats = cw.getStats();
+    TEST_ASSERT_EQUAL_UINT32(100, stats.rxDupe);
+    TEST_ASSERT_GREATER_THAN_UINT16(0, stats.dupePermille);
+}
+
+/** Every duplicate counts once, so the ratio follows the share of duplicates */
+void test_duplicateRatio(void)
+{
+    ContentionWindow all(CW_MIN, CW_MAX);
+    ContentionWindow half(CW_MIN, CW_MAX);
+    for (int i = 0; i < 200; i++) {
+        all.onReceived(false);
+        all.onDuplicate();
+        half.onReceived(false);
+        if (i % 2)
+            half.onDuplicate();
+    }
+    TEST_ASSERT_GREATER_THAN_UINT16(900, all.getStats().dupePermille);
+    TEST_ASSERT_UINT16_WITHIN(100, 500, half.getStats().dupePermille);
+
+    // Duplicates that weren't received by the radio don't move it
+    ContentionWindow none(CW_MIN, CW_MAX);
+    for (int i = 0; i < 10; i++)
+        none.onDuplicate();
+    TEST_ASSERT_EQUAL_UINT16(0, none.getStats().dupePermille);
+    TEST_ASSERT_EQUAL_UINT32(10, none.getStats().rxDupe);
+}
+
+/*
+ * Slotted scenario comparing the current utilization based scheme against the adaptive one.
+ * All nodes hear each other, a packet occupies the channel for PACKET_SLOTS slots, nodes starting in the same slot collide
+ * (CAD can't see a transmission that started in the same slot).
+ */
+#define NUM_NODES 30
+#define PACKET_SLOTS 20
+#define SIM_SLOTS 200000
+#define UTIL_PERIOD 1000 // slots per channel utilization bucket, like the 10s buckets in AirTime
+#define UTIL_BUCKETS 6
+
+struct ScenarioResult {
+    uint32_t offered, delivered, collided, airtimeSlots;
+};
+
+struct SimNode {
+    ContentionWindow cw = ContentionWindow(CW_MIN, CW_MAX);
+    int32_t backoff = -1;
+    bool pending = false;
+};
+
+static uint32_t lcgState;
+static uint32_t simRandom(uint32_t n)
+{
+    lcgState = lcgState * 1103515245u + 12345u;
+    return (lcgState >> 8) % n;
+}
+
+static ScenarioResult runScenario(bool adaptive, uint32_t arrivalPerMillion)
+{
+    lcgState = 42;
+    std::vector<SimNode> nodes(NUM_NODES);
+    ScenarioResult r = {};
+    uint32_t busyUntil = 0, bucketBusy = 0;
+    uint32_t buckets[UTIL_BUCKETS] = {0};
+    float util = 0;
+
+    for (uint32_t slot = 0; slot < SIM_SLOTS; slot++) {
+        if (slot && slot % UTIL_PERIOD == 0) {
+            for (int i = UTIL_BUCKETS - 1; i > 0; i--)
+                buckets[i] = buckets[i - 1];
+            buckets[0] = bucketBusy;
+            bucketBusy = 0;
+            uint32_t sum = 0;
+            for (auto b : buckets)
+                sum += b;
+            util = 100.0f * sum / (UTIL_PERIOD * UTIL_BUCKETS);
+        }
+        bool busy = slot < busyUntil;
+        if (busy)
+            bucketBusy++;
+
+        std::vector<int> starters;
+        for (int i = 0; i < NUM_NODES; i++) {
+            SimNode &n = nodes[i];
+            if (!n.pending && simRandom(1000000) < arrivalPerMillion) {
+                n.pending = true;
+                n.backoff = -1;
+                r.offered++;
+            }
+            if (!n.pending)
+                continue;
+            if (n.backoff < 0) {
+                uint32_t window =
+                    adaptive ? n.cw.getWindowSlots() : (1u << (CW_MIN + (uint32_t)(util * (CW_MAX - CW_MIN) / 100)));
+                n.backoff = simRandom(window);
+            }
+            if (n.backoff > 0) {
+                n.backoff--;
+                continue;
+            }
+            if (busy) {
+                n.cw.onChannelBusy();
+                n.backoff = -1;
+                continue;
+            }
+            n.cw.onChannelIdle();
+            starters.push_back(i);
+        }
+
+        if (!starters.empty()) {
+            bool collided = starters.size() > 1;
+            busyUntil = slot + PACKET_SLOTS;
+            r.airtimeSlots += PACKET_SLOTS * starters.size();
+            for (int s : starters)
+                nodes[s].pending = false;
+            if (collided)
+                r.collided += starters.size();
+            else
+                r.delivered++;
+            for (int i = 0; i < NUM_NODES; i++)
+                if (std::find(starters.begin(), starters.end(), i) == starters.end())
+                    nodes[i].cw.onReceived(collided);
+        }
+    }
+    return r;
+}
+
+void test_scenarioDeliveryRatio(void)
+{
+    const uint32_t loads[] = {200, 500, 1000, 2000};
+    for (uint32_t load : loads) {
+        ScenarioResult fixed = runScenario(false, load);
+        ScenarioResult adaptive = runScenario(true, load);
+        float fixedRatio = (float)fixed.delivered / fixed.offered;
+        float adaptiveRatio = (float)adaptive.delivered / adaptive.offered;
+        LOG_INFO("load=%u/M fixed: delivery=%.3f collided=%u airtime=%u | adaptive: delivery=%.3f collided=%u airtime=%u", load,
+                 fixedRatio, fixed.collided, fixed.airtimeSlots, adaptiveRatio, adaptive.collided, adaptive.airtimeSlots);
+        TEST_ASSERT_TRUE(adaptiveRatio >= fixedRatio);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(fixed.collided, adaptive.collided);
+    }
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    RUN_TEST(test_startsAtMinimum);
+    RUN_TEST(test_busyIncreasesMultiplicatively);
+    RUN_TEST(test_idleDecreasesAdditively);
+    RUN_TEST(test_duplicatesRaiseFloor);
+    RUN_TEST(test_duplicateRatio);
+    RUN_TEST(test_scenarioDeliveryRatio);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -152,6 +152,112 @@ void test_PKC(void)
     TEST_ASSERT_EQUAL_MEMORY(expected_decrypted, decrypted, 10);
 }
 
+#if PKI_SHARED_KEY_CACHE
+static bool isCached(const uint8_t *publicKey)
+{
+    for (auto &cached : crypto->sharedKeyCache)
+        if (cached.lastUsed && memcmp(cached.publicKey, publicKey, 32) == 0)
+            return true;
+    return false;
+}
+
+/** Some public key other than the test vector, anything but a weak point will do */
+static void otherPublicKey(meshtastic_UserLite_public_key_t &key, uint8_t n)
+{
+    memset(key.bytes, 0x11, sizeof(key.bytes));
+    key.bytes[0] = n;
+    key.bytes[31] = 0x22;
+    key.size = 32;
+}
+
+void test_PKC_shared_key_cache(void)
+{
+    uint8_t private_key[32];
+    meshtastic_UserLite_public_key_t public_key;
+    meshtastic_UserLite_public_key_t weak_key;
+    uint8_t expected_shared[32];
+    uint8_t bytes[10] = {0};
+    uint8_t encrypted[64] __attribute__((__aligned__));
+
+    HexToBytes(public_key.bytes, "db18fc50eea47f00251cb784819a3cf5fc361882597f589f0d7ff820e8064457");
+    public_key.size = 32;
+    HexToBytes(weak_key.bytes, "ecffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f");
+    weak_key.size = 32;
+    HexToBytes(private_key, "a00330633e63522f8a4d81ec6d9d1e6617f6c8ffd3a4c698229537d44e522277");
+    HexToBytes(expected_shared, "777b1545c9d6f9a2");
+    crypto->setDHPrivateKey(private_key);
+
+    // The second packet to the same node takes the shared key from sharedKeyCache
+    TEST_ASSERT(crypto->encryptCurve25519(0, 0x0929, public_key, 1, sizeof(bytes), bytes, encrypted));
+    TEST_ASSERT(isCached(public_key.bytes));
+    memset(crypto->shared_key, 0, sizeof(crypto->shared_key));
+    TEST_ASSERT(crypto->encryptCurve25519(0, 0x0929, public_key, 2, sizeof(bytes), bytes, encrypted));
+    TEST_ASSERT_EQUAL_MEMORY(expected_shared, crypto->shared_key, 8);
+
+    // A weak key keeps failing
+    TEST_ASSERT_FALSE(crypto->encryptCurve25519(0, 0x0929, weak_key, 3, sizeof(bytes), bytes, encrypted));
+    TEST_ASSERT(isCached(weak_key.bytes));
+    TEST_ASSERT_FALSE(crypto->encryptCurve25519(0, 0x0929, weak_key, 4, sizeof(bytes), bytes, encrypted));
+}
+
+void test_PKC_shared_key_cache_lru(void)
+{
+    uint8_t private_key[32];
+    meshtastic_UserLite_public_key_t keys[PKI_SHARED_KEY_CACHE + 1];
+    uint8_t bytes[10] = {0};
+    uint8_t encrypted[64] __attribute__((__aligned__));
+
+    HexToBytes(private_key, "a00330633e63522f8a4d81ec6d9d1e6617f6c8ffd3a4c698229537d44e522277");
+    crypto->setDHPrivateKey(private_key);
+    for (int i = 0; i <= PKI_SHARED_KEY_CACHE; i++)
+        otherPublicKey(keys[i], i + 1);
+
+    for (int i = 0; i < PKI_SHARED_KEY_CACHE; i++)
+        TEST_ASSERT(crypto->encryptCurve25519(0, 0x0929, keys[i], i, sizeof(bytes), bytes, encrypted));
+    // Using the oldest again makes the second one the least recently used
+    TEST_ASSERT(crypto->encryptCurve25519(0, 0x0929, keys[0], 100, sizeof(bytes), bytes, encrypted));
+    TEST_ASSERT(crypto->encryptCurve25519(0, 0x0929, keys[PKI_SHARED_KEY_CACHE], 101, sizeof(bytes), bytes, encrypted));
+
+    TEST_ASSERT(isCached(keys[0].bytes));
+    TEST_ASSERT_FALSE(isCached(keys[1].bytes));
+    for (int i = 2; i <= PKI_SHARED_KEY_CACHE; i++)
+        TEST_ASSERT(isCached(keys[i].bytes));
+}
+
+/** None of the shared keys may be used with another private key */
+void test_PKC_shared_key_cache_private_key_change(void)
+{
+    uint8_t private_key[32];
+    meshtastic_UserLite_public_key_t public_key;
+    uint8_t expected_shared[32];
+    uint8_t bytes[10] = {0};
+    uint8_t encrypted[64] __attribute__((__aligned__));
+
+    HexToBytes(public_key.bytes, "db18fc50eea47f00251cb784819a3cf5fc361882597f589f0d7ff820e8064457");
+    public_key.size = 32;
+    HexToBytes(private_key, "a00330633e63522f8a4d81ec6d9d1e6617f6c8ffd3a4c698229537d44e522277");
+    HexToBytes(expected_shared, "777b1545c9d6f9a2");
+    crypto->setDHPrivateKey(private_key);
+    TEST_ASSERT(crypto->encryptCurve25519(0, 0x0929, public_key, 1, sizeof(bytes), bytes, encrypted));
+
+    private_key[0] ^= 0x40;
+    crypto->setDHPrivateKey(private_key);
+    TEST_ASSERT_FALSE(isCached(public_key.bytes));
+    TEST_ASSERT(crypto->encryptCurve25519(0, 0x0929, public_key, 2, sizeof(bytes), bytes, encrypted));
+    TEST_ASSERT(memcmp(expected_shared, crypto->shared_key, 8) != 0);
+
+    // Same when the key pair is regenerated, or the keys are cleared
+    uint8_t new_public[32];
+    private_key[0] ^= 0x40;
+    TEST_ASSERT(crypto->regeneratePublicKey(new_public, private_key));
+    TEST_ASSERT_FALSE(isCached(public_key.bytes));
+    TEST_ASSERT(crypto->encryptCurve25519(0, 0x0929, public_key, 3, sizeof(bytes), bytes, encrypted));
+    TEST_ASSERT_EQUAL_MEMORY(expected_shared, crypto->shared_key, 8);
+    crypto->clearKeys();
+    TEST_ASSERT_FALSE(isCached(public_key.bytes));
+}
+#endif
+
 void test_AES_CTR(void)
 {
     uint8_t expected[32];
@@ -178,6 +284,72 @@ void test_AES_CTR(void)
     TEST_ASSERT_EQUAL_MEMORY(expected, plain, 16);
 }
 
+/** The platform engine (OpenSSL on portduino) must give the same output as the generic one */
+void test_AES_CTR_matches_generic(void)
+{
+    static CryptoEngine generic;
+    uint8_t expected[MAX_BLOCKSIZE];
+    uint8_t bytes[MAX_BLOCKSIZE];
+    uint8_t nonce[16];
+    CryptoKey k;
+
+    for (int i = 0; i < 200; i++) {
+        k.length = (i & 1) ? 32 : 16;
+        for (int j = 0; j < k.length; j++)
+            k.bytes[j] = random(256);
+        for (int j = 0; j < 12; j++)
+            nonce[j] = random(256);
+        memset(nonce + 12, 0, 4); // Block counter, as initNonce() leaves it
+        size_t numBytes = 1 + random(MAX_BLOCKSIZE);
+        for (size_t j = 0; j < numBytes; j++)
+            bytes[j] = random(256);
+        memcpy(expected, bytes, numBytes);
+
+        uint8_t nonceCopy[16];
+        memcpy(nonceCopy, nonce, 16);
+        generic.encryptAESCtr(k, nonceCopy, numBytes, expected);
+        memcpy(nonceCopy, nonce, 16);
+        crypto->encryptAESCtr(k, nonceCopy, numBytes, bytes);
+        TEST_ASSERT_EQUAL_MEMORY(expected, bytes, numBytes);
+    }
+}
+
+void test_throughput(void)
+{
+    static CryptoEngine generic;
+    const int numPackets = 20000;
+    uint8_t bytes[237] = {0};
+    CryptoKey k;
+    k.length = 16;
+    HexToBytes(k.bytes, "d4f1bb3a20290759f0bcffabcf4e6901"); // The default channel key
+
+    uint32_t start = micros();
+    for (int i = 0; i < numPackets; i++) {
+        generic.initNonce(0x1234, i);
+        generic.encryptAESCtr(k, generic.nonce, sizeof(bytes), bytes);
+    }
+    float genericRate = numPackets * 1e6f / (micros() - start + 1);
+
+    start = micros();
+    for (int i = 0; i < numPackets; i++)
+        crypto->encryptPacket(0x1234, i, sizeof(bytes), bytes);
+    float rate = numPackets * 1e6f / (micros() - start + 1);
+    LOG_INFO("AES-CTR %u byte packets: %.0f packets/s, generic engine %.0f packets/s", sizeof(bytes), rate, genericRate);
+
+    uint8_t private_key[32];
+    meshtastic_UserLite_public_key_t public_key;
+    uint8_t encrypted[256];
+    HexToBytes(public_key.bytes, "db18fc50eea47f00251cb784819a3cf5fc361882597f589f0d7ff820e8064457");
+    public_key.size = 32;
+    HexToBytes(private_key, "a00330633e63522f8a4d81ec6d9d1e6617f6c8ffd3a4c698229537d44e522277");
+    crypto->setDHPrivateKey(private_key);
+    const int numPKC = 200;
+    start = micros();
+    for (int i = 0; i < numPKC; i++)
+        TEST_ASSERT(crypto->encryptCurve25519(0, 0x0929, public_key, i, 200, bytes, encrypted));
+    LOG_INFO("PKC 200 byte packets: %.0f packets/s", numPKC * 1e6f / (micros() - start + 1));
+}
+
 void setup()
 {
     // NOTE!!! Wait for >2 secs
@@ -192,6 +364,13 @@ void setup()
     RUN_TEST(test_DH25519);
     RUN_TEST(test_AES_CTR);
     RUN_TEST(test_PKC);
+#if PKI_SHARED_KEY_CACHE
+    RUN_TEST(test_PKC_shared_key_cache);
+    RUN_TEST(test_PKC_shared_key_cache_lru);
+    RUN_TEST(test_PKC_shared_key_cache_private_key_change);
+#endif
+    RUN_TEST(test_AES_CTR_matches_generic);
+    RUN_TEST(test_throughput);
     exit(UNITY_END()); // stop unit testing
 }
 
@@ -0,0 +1,290 @@
+#include "DebugConfiguration.h"
+#include "SPILock.h"
+#include "TestUtil.h"
+#include "mesh/NodeDB.h"
+#include "mesh/ReliableRouter.h"
+#include "mesh/SinglePortModule.h"
+#include "modules/RoutingModule.h"
+#include <unity.h>
+
+#include <list>
+#include <map>
+
+#define FLOODER 0x0bad0bad
+#define NUM_LEGIT_NODES 5
+#define FIRST_LEGIT_NODE 0x1000
+#define RUN_MSEC 2000
+#define LOCAL_PER_MINUTE 30
+#define LOCAL_BURST 10
+#define RELAY_PER_MINUTE 20
+#define RELAY_BURST 6
+
+// Counts what made it through the router to the modules, per sender
+class CountingModule : public SinglePortModule
+{
+  public:
+    std::map<NodeNum, uint32_t> received;
+
+    CountingModule() : SinglePortModule("counting", meshtastic_PortNum_PRIVATE_APP) {}
+
+  protected:
+    virtual ProcessMessage handleReceived(const meshtastic_MeshPacket &mp) override
+    {
+        received[mp.from]++;
+        return ProcessMessage::CONTINUE;
+    }
+};
+
+// Records the acks and naks the router would send
+class MockRoutingModule : public RoutingModule
+{
+  public:
+    void sendAckNak(meshtastic_Routing_Error err, NodeNum to, PacketId idFrom, ChannelIndex chIndex,
+                    uint8_t hopLimit = 0) override
+    {
+        ackNaks.emplace_back(err, idFrom);
+    }
+    std::list<std::pair<meshtastic_Routing_Error, PacketId>> ackNaks;
+
+  protected:
+    virtual bool wantPacket(const meshtastic_MeshPacket *p) override { return false; }
+};
+
+static CountingModule *counting;
+static MockRoutingModule *mockRoutingModule;
+
+static void setLimits(FloodGuard &guard)
+{
+    guard.setLimit(FloodGuard::LOCAL, LOCAL_PER_MINUTE, LOCAL_BURST);
+    guard.setLimit(FloodGuard::RELAY, RELAY_PER_MINUTE, RELAY_BURST);
+}
+
+void setUp(void)
+{
+    router->floodGuard.clear();
+    setLimits(router->floodGuard);
+    counting->received.clear();
+    mockRoutingModule->ackNaks.clear();
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+static void makePacket(meshtastic_MeshPacket &p, NodeNum from, NodeNum to = NODENUM_BROADCAST)
+{
+    static PacketId nextId = 1;
+    memset(&p, 0, sizeof(p));
+    p.from = from;
+    p.to = to;
+    p.id = nextId++;
+    p.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    p.decoded.portnum = meshtastic_PortNum_PRIVATE_APP;
+}
+
+/** Hand a packet to the router as if the radio received it */
+static void receive(const meshtastic_MeshPacket &p)
+{
+    router->enqueueReceivedMessage(packetPool.allocCopy(p));
+    router->runOnce();
+}
+
+static void receive(NodeNum from, NodeNum to = NODENUM_BROADCAST)
+{
+    meshtastic_MeshPacket p;
+    makePacket(p, from, to);
+    receive(p);
+}
+
+void test_offByDefault(void)
+{
+    FloodGuard guard;
+    TEST_ASSERT_FALSE(guard.isEnabled());
+    meshtastic_MeshPacket p;
+    for (int i = 0; i < 1000; i++) {
+        makePacket(p, FLOODER);
+        TEST_ASSERT_TRUE(guard.allow(&p));
+    }
+}
+
+void test_burstThenDrop(void)
+{
+    FloodGuard guard;
+    setLimits(guard);
+    meshtastic_MeshPacket p;
+    for (int i = 0; i < LOCAL_BURST; i++) {
+        makePacket(p, FLOODER);
+        TEST_ASSERT_TRUE(guard.allow(&p));
+    }
+    makePacket(p, FLOODER);
+    TEST_ASSERT_FALSE(guard.allow(&p));
+
+    const FloodGuard::Entry *e = guard.find(FLOODER);
+    TEST_ASSERT_NOT_NULL(e);
+    TEST_ASSERT_EQUAL_UINT32(1, e->buckets[FloodGuard::LOCAL].dropped);
+    TEST_ASSERT_EQUAL_UINT32(1, guard.dropped[FloodGuard::LOCAL]);
+
+    // Other senders have budgets of their own
+    makePacket(p, FIRST_LEGIT_NODE);
+    TEST_ASSERT_TRUE(guard.allow(&p));
+}
+
+/** Packets we would only relay don't eat the budget of packets for us */
+void test_separateBudgets(void)
+{
+    FloodGuard guard;
+    setLimits(guard);
+    meshtastic_MeshPacket p;
+    for (int i = 0; i < RELAY_BURST; i++) {
+        makePacket(p, FLOODER, FIRST_LEGIT_NODE);
+        TEST_ASSERT_TRUE(guard.allow(&p));
+    }
+    makePacket(p, FLOODER, FIRST_LEGIT_NODE);
+    TEST_ASSERT_FALSE(guard.allow(&p));
+    TEST_ASSERT_EQUAL_UINT32(1, guard.dropped[FloodGuard::RELAY]);
+
+    makePacket(p, FLOODER);
+    TEST_ASSERT_TRUE(guard.allow(&p));
+    TEST_ASSERT_EQUAL_UINT32(0, guard.dropped[FloodGuard::LOCAL]);
+}
+
+void test_refill(void)
+{
+    FloodGuard guard;
+    guard.setLimit(FloodGuard::LOCAL, 6000, 1); // One token per 10 msec
+    meshtastic_MeshPacket p;
+    makePacket(p, FLOODER);
+    TEST_ASSERT_TRUE(guard.allow(&p));
+    TEST_ASSERT_FALSE(guard.allow(&p));
+    delay(20);
+    TEST_ASSERT_TRUE(guard.allow(&p));
+}
+
+/** Cycling through spoofed senders doesn't evict a drained sender, which would reset its budget */
+void test_spoofedSendersDontEvict(void)
+{
+    FloodGuard guard;
+    setLimits(guard);
+    meshtastic_MeshPacket p;
+    for (int i = 0; i < LOCAL_BURST + 1; i++) {
+        makePacket(p, FLOODER);
+        guard.allow(&p);
+    }
+
+    for (NodeNum n = FIRST_LEGIT_NODE; n < FIRST_LEGIT_NODE + 10 * FLOOD_GUARD_TABLE_SIZE; n++) {
+        makePacket(p, n);
+        TEST_ASSERT_TRUE(guard.allow(&p));
+    }
+
+    makePacket(p, FLOODER);
+    TEST_ASSERT_FALSE(guard.allow(&p));
+    TEST_ASSERT_EQUAL_UINT32(2, guard.find(FLOODER)->buckets[FloodGuard::LOCAL].dropped);
+}
+
+/** A flooder that keeps the table full of drained spoofed senders doesn't starve the nodes that are not in it */
+void test_spoofedFloodDoesNotStarveOthers(void)
+{
+    FloodGuard guard;
+    setLimits(guard);
+    meshtastic_MeshPacket p;
+    uint32_t sent = 0, allowed = 0;
+    for (int round = 0; round < 10; round++) {
+        for (NodeNum n = FLOODER; n < FLOODER + 2 * FLOOD_GUARD_TABLE_SIZE; n++) {
+            for (int i = 0; i < LOCAL_BURST + 5; i++) {
+                makePacket(p, n);
+                guard.allow(&p);
+            }
+        }
+        for (NodeNum n = FIRST_LEGIT_NODE; n < FIRST_LEGIT_NODE + NUM_LEGIT_NODES; n++, sent++) {
+            makePacket(p, n);
+            if (guard.allow(&p))
+                allowed++;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(sent, allowed);
+}
+
+/**
+ * A want_ack DM to us that is dropped isn't answered, so a flooder can't make us transmit, and isn't recorded: when it is
+ * sent again after the budget refilled it is delivered rather than taken for a duplicate
+ */
+void test_droppedThenRetransmitted(void)
+{
+    router->floodGuard.setLimit(FloodGuard::LOCAL, 6000, 1); // One token per 10 msec
+    receive(FLOODER);
+
+    meshtastic_MeshPacket p;
+    makePacket(p, FLOODER, nodeDB->getNodeNum());
+    p.want_ack = true;
+    p.hop_start = 3;
+    p.hop_limit = 2; // Not a repeated transmission, their duplicates need the tx queue of an interface
+    receive(p);
+    TEST_ASSERT_EQUAL_UINT32(1, counting->received[FLOODER]);
+    TEST_ASSERT_EQUAL_UINT32(0, mockRoutingModule->ackNaks.size());
+    TEST_ASSERT_FALSE(router->wasSeenRecentlyNoUpdate(&p));
+
+    delay(20);
+    receive(p);
+    TEST_ASSERT_EQUAL_UINT32(2, counting->received[FLOODER]);
+    TEST_ASSERT_EQUAL_UINT32(0, mockRoutingModule->ackNaks.size());
+
+    // A real duplicate still doesn't spend the budget
+    uint32_t droppedBefore = router->floodGuard.dropped[FloodGuard::LOCAL];
+    receive(p);
+    TEST_ASSERT_EQUAL_UINT32(2, counting->received[FLOODER]);
+    TEST_ASSERT_EQUAL_UINT32(droppedBefore, router->floodGuard.dropped[FloodGuard::LOCAL]);
+}
+
+/**
+ * One node floods the router as fast as it can while a few others send at a normal rate. Everything of the normal nodes
+ * must reach the modules, of the flooder only its budget.
+ */
+void test_flooderDoesNotStarveOthers(void)
+{
+    router->floodGuard.setLimit(FloodGuard::LOCAL, 600, 5); // 10 per second
+
+    uint32_t droppedBefore = router->floodGuard.dropped[FloodGuard::LOCAL];
+    uint32_t flooded = 0, sent = 0;
+    uint32_t start = millis();
+    while (millis() - start < RUN_MSEC) {
+        for (int i = 0; i < 50; i++, flooded++)
+            receive(FLOODER);
+        for (NodeNum n = FIRST_LEGIT_NODE; n < FIRST_LEGIT_NODE + NUM_LEGIT_NODES; n++)
+            receive(n);
+        sent++;
+        delay(250); // 4 per second for each of the normal nodes
+    }
+    uint32_t elapsed = millis() - start;
+
+    for (NodeNum n = FIRST_LEGIT_NODE; n < FIRST_LEGIT_NODE + NUM_LEGIT_NODES; n++)
+        TEST_ASSERT_EQUAL_UINT32(sent, counting->received[n]);
+
+    uint32_t budget = 5 + elapsed / 100 + 1;
+    LOG_INFO("Flood guard: flooder sent %u, %u got through (budget %u)", flooded, counting->received[FLOODER], budget);
+    TEST_ASSERT_TRUE(counting->received[FLOODER] <= budget);
+    TEST_ASSERT_EQUAL_UINT32(flooded - counting->received[FLOODER],
+                             router->floodGuard.dropped[FloodGuard::LOCAL] - droppedBefore);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    initSPI();
+    nodeDB = new NodeDB();
+    router = new ReliableRouter();
+    routingModule = mockRoutingModule = new MockRoutingModule();
+    counting = new CountingModule();
+    UNITY_BEGIN();
+    RUN_TEST(test_offByDefault);
+    RUN_TEST(test_burstThenDrop);
+    RUN_TEST(test_separateBudgets);
+    RUN_TEST(test_refill);
+    RUN_TEST(test_spoofedSendersDontEvict);
+    RUN_TEST(test_spoofedFloodDoesNotStarveOthers);
+    RUN_TEST(test_droppedThenRetransmitted);
+    RUN_TEST(test_flooderDoesNotStarveOthers);
+    exit(UNITY_END());
+}
+
+void loop() {}
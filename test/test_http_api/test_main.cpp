@@ -0,0 +1,401 @@
+#include "DebugConfiguration.h"
+#include "SPILock.h"
+#include "TestUtil.h"
+#include "mesh/MeshService.h"
+#include "mesh/NodeDB.h"
+#include "mesh/Router.h"
+#include "mesh/raspihttp/PiWebServer.h"
+#include <unity.h>
+
+#if defined(PORTDUINO_LINUX_HARDWARE) && __has_include(<ulfius.h>) && !defined(U_DISABLE_CURL)
+#include "gps/RTC.h"
+#include "mesh-pb-constants.h"
+#include "platform/portduino/PortduinoGlue.h"
+
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <vector>
+
+#define TEST_PORT 19443
+#define NUM_NODES 500
+#define FIRST_NODE 0x10000
+#define SYNC_TIMEOUT_MSEC 60000
+#define STREAM_IDLE_MSEC 200
+#define WEB_ROOT "/tmp/test_http_api_www"
+#define BENCH_FILE_SIZE (256 * 1024)
+#define BENCH_REQUESTS 300
+
+// What a client got out of one full sync
+struct SyncResult {
+    uint32_t nonce;
+    uint32_t frames = 0;
+    uint32_t nodes = 0;
+    uint32_t requests = 0;
+    bool complete = false;
+    uint32_t startMsec = 0;
+    uint32_t elapsedMsec = 0;
+};
+
+// Splits a streamed FromRadio response into its frames
+struct FrameParser {
+    SyncResult *result;
+    std::vector<uint8_t> pending;
+    bool bad = false;
+};
+
+// What a client got for a static file
+struct StaticResponse {
+    long status = -1;
+    std::string body;
+    std::string etag;
+    std::string encoding;
+    std::string cacheControl;
+};
+
+static uint32_t pollingMsec, streamingMsec;
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+static std::string url(const char *path)
+{
+    return std::string("https://localhost:") + std::to_string(TEST_PORT) + path;
+}
+
+static void countFromRadio(SyncResult &r, const uint8_t *bytes, size_t length)
+{
+    static meshtastic_FromRadio fr;
+    r.frames++;
+    if (!pb_decode_from_bytes(bytes, length, &meshtastic_FromRadio_msg, &fr))
+        return;
+    if (fr.which_payload_variant == meshtastic_FromRadio_node_info_tag) {
+        r.nodes++;
+    } else if (fr.which_payload_variant == meshtastic_FromRadio_config_complete_id_tag && fr.config_complete_id == r.nonce) {
+        r.complete = true;
+        r.elapsedMsec = millis() - r.startMsec;
+    }
+}
+
+/** PUT raw bytes to the ToRadio endpoint, returns the HTTP status */
+static long putToRadio(const uint8_t *bytes, size_t length)
+{
+    struct _u_request req;
+    struct _u_response res;
+    ulfius_init_request(&req);
+    ulfius_init_response(&res);
+    std::string u = url("/api/v1/toradio");
+    ulfius_set_request_properties(&req, U_OPT_HTTP_VERB, "PUT", U_OPT_HTTP_URL, u.c_str(), U_OPT_CHECK_SERVER_CERTIFICATE, 0,
+                                  U_OPT_BINARY_BODY, bytes, length, U_OPT_NONE);
+    long status = ulfius_send_http_request(&req, &res) == U_OK ? res.status : -1;
+    ulfius_clean_response(&res);
+    ulfius_clean_request(&req);
+    return status;
+}
+
+static void startSync(SyncResult &r, uint32_t nonce)
+{
+    meshtastic_ToRadio tr = meshtastic_ToRadio_init_zero;
+    tr.which_payload_variant = meshtastic_ToRadio_want_config_id_tag;
+    tr.want_config_id = nonce;
+    uint8_t buf[MAX_TO_FROM_RADIO_SIZE];
+    size_t len = pb_encode_to_bytes(buf, sizeof(buf), &meshtastic_ToRadio_msg, &tr);
+
+    r.nonce = nonce;
+    r.startMsec = millis();
+    TEST_ASSERT_EQUAL(200, putToRadio(buf, len));
+}
+
+/** Like the web client does it, one GET for every FromRadio */
+static void pollingSync(SyncResult &r)
+{
+    std::string u = url("/api/v1/fromradio");
+    while (!r.complete && millis() - r.startMsec < SYNC_TIMEOUT_MSEC) {
+        struct _u_request req;
+        struct _u_response res;
+        ulfius_init_request(&req);
+        ulfius_init_response(&res);
+        ulfius_set_request_properties(&req, U_OPT_HTTP_VERB, "GET", U_OPT_HTTP_URL, u.c_str(), U_OPT_CHECK_SERVER_CERTIFICATE, 0,
+                                      U_OPT_NONE);
+        if (ulfius_send_http_request(&req, &res) == U_OK && res.binary_body_length > 0)
+            countFromRadio(r, (const uint8_t *)res.binary_body, res.binary_body_length);
+        r.requests++;
+        ulfius_clean_response(&res);
+        ulfius_clean_request(&req);
+    }
+}
+
+static size_t onStreamBody(void *contents, size_t size, size_t nmemb, void *user_data)
+{
+    FrameParser *parser = (FrameParser *)user_data;
+    const uint8_t *bytes = (const uint8_t *)contents;
+    parser->pending.insert(parser->pending.end(), bytes, bytes + size * nmemb);
+
+    size_t pos = 0;
+    while (pos + FROMRADIO_STREAM_HEADER <= parser->pending.size()) {
+        const uint8_t *frame = parser->pending.data() + pos;
+        if (frame[0] != FROMRADIO_STREAM_START1 || frame[1] != FROMRADIO_STREAM_START2) {
+            parser->bad = true;
+            break;
+        }
+        size_t len = (frame[2] << 8) | frame[3];
+        if (pos + FROMRADIO_STREAM_HEADER + len > parser->pending.size())
+            break;
+        countFromRadio(*parser->result, frame + FROMRADIO_STREAM_HEADER, len);
+        pos += FROMRADIO_STREAM_HEADER + len;
+    }
+    parser->pending.erase(parser->pending.begin(), parser->pending.begin() + pos);
+    return size * nmemb;
+}
+
+/** One GET that streams until the PhoneAPI has been idle for idleMsec */
+static bool streamingGet(SyncResult &r, uint32_t idleMsec, FrameParser &parser)
+{
+    struct _u_request req;
+    struct _u_response res;
+    ulfius_init_request(&req);
+    ulfius_init_response(&res);
+    std::string u = url("/api/v1/fromradio?all=true&timeout=") + std::to_string(idleMsec);
+    ulfius_set_request_properties(&req, U_OPT_HTTP_VERB, "GET", U_OPT_HTTP_URL, u.c_str(), U_OPT_CHECK_SERVER_CERTIFICATE, 0,
+                                  U_OPT_NONE);
+    parser.result = &r;
+    bool ok = ulfius_send_http_streaming_request(&req, &res, onStreamBody, &parser) == U_OK && res.status == 200;
+    r.requests++;
+    ulfius_clean_response(&res);
+    ulfius_clean_request(&req);
+    return ok;
+}
+
+/** A body larger than any ToRadio is refused instead of being cut off */
+void test_toRadioTooLarge(void)
+{
+    uint8_t buf[MAX_TO_FROM_RADIO_SIZE + 1] = {};
+    TEST_ASSERT_EQUAL(413, putToRadio(buf, sizeof(buf)));
+}
+
+void test_pollingSync(void)
+{
+    SyncResult r;
+    startSync(r, 1001);
+    pollingSync(r);
+
+    TEST_ASSERT_TRUE(r.complete);
+    TEST_ASSERT_TRUE(r.nodes >= NUM_NODES);
+    pollingMsec = r.elapsedMsec;
+    LOG_INFO("Polling sync: %u frames, %u nodes, %u requests in %u msec", r.frames, r.nodes, r.requests, r.elapsedMsec);
+}
+
+void test_streamingSync(void)
+{
+    SyncResult r;
+    FrameParser parser;
+    startSync(r, 1002);
+    TEST_ASSERT_TRUE(streamingGet(r, STREAM_IDLE_MSEC, parser));
+
+    TEST_ASSERT_FALSE(parser.bad);
+    TEST_ASSERT_TRUE(parser.pending.empty());
+    TEST_ASSERT_TRUE(r.complete);
+    TEST_ASSERT_TRUE(r.nodes >= NUM_NODES);
+    streamingMsec = r.elapsedMsec;
+    LOG_INFO("Streaming sync: %u frames, %u nodes, %u requests in %u msec", r.frames, r.nodes, r.requests, r.elapsedMsec);
+
+    TEST_ASSERT_TRUE(streamingMsec < pollingMsec);
+}
+
+/** With nothing to send the stream ends once the idle time is up */
+void test_streamEndsWhenIdle(void)
+{
+    SyncResult r;
+    FrameParser parser;
+    r.startMsec = millis();
+    TEST_ASSERT_TRUE(streamingGet(r, STREAM_IDLE_MSEC, parser));
+    uint32_t elapsed = millis() - r.startMsec;
+
+    TEST_ASSERT_EQUAL_UINT32(0, r.frames);
+    TEST_ASSERT_TRUE(elapsed >= STREAM_IDLE_MSEC);
+    TEST_ASSERT_TRUE(elapsed < STREAM_IDLE_MSEC + 2000);
+}
+
+static void writeFile(const char *path, const std::string &content)
+{
+    FILE *f = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    fwrite(content.data(), 1, content.size(), f);
+    fclose(f);
+}
+
+static StaticResponse getStatic(const char *path, const char *ifNoneMatch = NULL, bool acceptGzip = false)
+{
+    StaticResponse r;
+    struct _u_request req;
+    struct _u_response res;
+    ulfius_init_request(&req);
+    ulfius_init_response(&res);
+    std::string u = url(path);
+    ulfius_set_request_properties(&req, U_OPT_HTTP_VERB, "GET", U_OPT_HTTP_URL, u.c_str(), U_OPT_CHECK_SERVER_CERTIFICATE, 0,
+                                  U_OPT_NONE);
+    if (ifNoneMatch)
+        u_map_put(req.map_header, "If-None-Match", ifNoneMatch);
+    if (acceptGzip)
+        u_map_put(req.map_header, "Accept-Encoding", "gzip, deflate");
+    if (ulfius_send_http_request(&req, &res) == U_OK) {
+        r.status = res.status;
+        r.body.assign((const char *)res.binary_body, res.binary_body_length);
+        const char *h;
+        if ((h = u_map_get_case(res.map_header, "ETag")) != NULL)
+            r.etag = h;
+        if ((h = u_map_get_case(res.map_header, "Content-Encoding")) != NULL)
+            r.encoding = h;
+        if ((h = u_map_get_case(res.map_header, "Cache-Control")) != NULL)
+            r.cacheControl = h;
+    }
+    ulfius_clean_response(&res);
+    ulfius_clean_request(&req);
+    return r;
+}
+
+void test_staticETag(void)
+{
+    StaticResponse r = getStatic("/bench.js");
+    TEST_ASSERT_EQUAL(200, r.status);
+    TEST_ASSERT_EQUAL(BENCH_FILE_SIZE, r.body.size());
+    TEST_ASSERT_FALSE(r.etag.empty());
+    TEST_ASSERT_EQUAL_STRING(STATIC_FILE_CACHE_CONTROL, r.cacheControl.c_str());
+
+    StaticResponse again = getStatic("/bench.js", r.etag.c_str());
+    TEST_ASSERT_EQUAL(304, again.status);
+    TEST_ASSERT_EQUAL(0, again.body.size());
+
+    TEST_ASSERT_EQUAL(200, getStatic("/bench.js", "\"0000000000000000\"").status);
+    TEST_ASSERT_EQUAL_STRING(STATIC_FILE_CACHE_CONTROL_PAGE, getStatic("/index.html").cacheControl.c_str());
+}
+
+void test_staticGzip(void)
+{
+    StaticResponse plain = getStatic("/bench.js");
+    StaticResponse gzip = getStatic("/bench.js", NULL, true);
+    TEST_ASSERT_EQUAL(200, gzip.status);
+    TEST_ASSERT_EQUAL_STRING("gzip", gzip.encoding.c_str());
+    TEST_ASSERT_EQUAL_STRING("pretend this is gzip", gzip.body.c_str());
+    TEST_ASSERT_TRUE(plain.etag != gzip.etag);
+    TEST_ASSERT_TRUE(plain.encoding.empty());
+
+    // No .gz next to it, the plain file it is
+    TEST_ASSERT_TRUE(getStatic("/index.html", NULL, true).encoding.empty());
+}
+
+/** A file changed on disk is served again once the cache looked at it */
+void test_staticReload(void)
+{
+    StaticResponse before = getStatic("/index.html");
+    writeFile(WEB_ROOT "/index.html", "<html>changed, and longer</html>");
+    delay(WEB_FILE_CACHE_CHECK_MSEC + 100);
+    StaticResponse after = getStatic("/index.html");
+    TEST_ASSERT_EQUAL_STRING("<html>changed, and longer</html>", after.body.c_str());
+    TEST_ASSERT_TRUE(before.etag != after.etag);
+}
+
+/** Requests per second and CPU time per request (client and server, same process) for one way of serving */
+static void benchStatic(const char *name)
+{
+    struct rusage before, after;
+    getrusage(RUSAGE_SELF, &before);
+    uint32_t start = millis();
+    for (int i = 0; i < BENCH_REQUESTS; i++)
+        TEST_ASSERT_EQUAL(200, getStatic("/bench.js").status);
+    uint32_t elapsed = millis() - start;
+    getrusage(RUSAGE_SELF, &after);
+
+    uint64_t cpuUsec = (after.ru_utime.tv_sec - before.ru_utime.tv_sec) * 1000000ULL +
+                       (after.ru_utime.tv_usec - before.ru_utime.tv_usec) +
+                       (after.ru_stime.tv_sec - before.ru_stime.tv_sec) * 1000000ULL +
+                       (after.ru_stime.tv_usec - before.ru_stime.tv_usec);
+    LOG_INFO("Static %s: %u requests of %u bytes in %u msec, %u requests/s, %u usec CPU per request", name, BENCH_REQUESTS,
+             BENCH_FILE_SIZE, elapsed, (uint32_t)(BENCH_REQUESTS * 1000ULL / (elapsed ? elapsed : 1)),
+             (uint32_t)(cpuUsec / BENCH_REQUESTS));
+}
+
+void test_staticBenchmark(void)
+{
+    WebFileCache &cache = piwebServerThread->fileCache;
+
+    cache.enabled = false;
+    benchStatic("from disk");
+    cache.enabled = true;
+
+    uint32_t hits = cache.hits;
+    benchStatic("from cache");
+    TEST_ASSERT_TRUE(cache.hits - hits >= BENCH_REQUESTS - 1);
+}
+
+static void fillNodeDB()
+{
+    for (NodeNum n = FIRST_NODE; n < FIRST_NODE + NUM_NODES; n++) {
+        meshtastic_NodeInfoLite *info = nodeDB->getOrCreateMeshNode(n);
+        info->has_user = true;
+        snprintf(info->user.long_name, sizeof(info->user.long_name), "Simulated node %u", n - FIRST_NODE);
+        snprintf(info->user.short_name, sizeof(info->user.short_name), "%04x", n & 0xffff);
+        info->last_heard = getTime();
+        info->snr = 5.5;
+    }
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    initSPI();
+    settingsMap[maxnodes] = NUM_NODES + 10;
+    settingsMap[webserverport] = TEST_PORT;
+    settingsStrings[webserverrootpath] = WEB_ROOT;
+    settingsStrings[websslkeypath] = "/tmp/test_http_api_key.pem";
+    settingsStrings[websslcertpath] = "/tmp/test_http_api_cert.pem";
+    nodeDB = new NodeDB();
+    router = new Router();
+    service = new MeshService();
+    fillNodeDB();
+    mkdir(WEB_ROOT, 0755);
+    writeFile(WEB_ROOT "/index.html", "<html>mesh</html>");
+    writeFile(WEB_ROOT "/bench.js", std::string(BENCH_FILE_SIZE, 'x'));
+    writeFile(WEB_ROOT "/bench.js.gz", "pretend this is gzip");
+    piwebServerThread = new PiWebServerThread();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_toRadioTooLarge);
+    RUN_TEST(test_pollingSync);
+    RUN_TEST(test_streamingSync);
+    RUN_TEST(test_streamEndsWhenIdle);
+    RUN_TEST(test_staticETag);
+    RUN_TEST(test_staticGzip);
+    RUN_TEST(test_staticReload);
+    RUN_TEST(test_staticBenchmark);
+    exit(UNITY_END());
+}
+
+#else
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    TEST_MESSAGE("No ulfius with HTTP client support, nothing to test");
+    exit(UNITY_END());
+}
+#endif
+
+void loop() {}
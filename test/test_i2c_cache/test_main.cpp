@@ -0,0 +1,189 @@
+#include "DebugConfiguration.h"
+#include "FSCommon.h"
+#include "SPILock.h"
+#include "SafeFile.h"
+#include "TestUtil.h"
+#include "concurrency/LockGuard.h"
+#include "detect/ScanI2CTwoWire.h"
+#include <unity.h>
+
+#if !MESHTASTIC_EXCLUDE_I2C && defined(FSCom)
+#include <set>
+
+#define I2C_CACHE_FILE "/prefs/i2c.dat"
+#define I2C_CACHE_MAGIC 0x49324331
+#define NUM_ADDRESSES (120 - 8) // What a full scan probes
+
+// The presence pass stops at the first address that differs from the cache
+#define PROBES_UNTIL(address) ((address) - 8 + 1)
+
+// No known device lives at these, so scanPort() only finds them present without probing registers
+#define DEVICE_A 0x0b
+#define DEVICE_B 0x0c
+#define DEVICE_C 0x0e
+
+/** A scanner on a simulated bus, counting the presence probes */
+class FakeBusScanner : public ScanI2CTwoWire
+{
+  public:
+    std::set<uint8_t> present;
+    mutable uint32_t probes = 0;
+
+    explicit FakeBusScanner(std::set<uint8_t> devices) : present(devices) {}
+
+  protected:
+    virtual uint8_t probePresence(TwoWire *, uint8_t address) const override
+    {
+        probes++;
+        return present.count(address) ? 0 : 2;
+    }
+};
+
+/** Boot with the given devices on the bus, returns the number of presence probes */
+static uint32_t boot(std::set<uint8_t> devices, bool *cacheLoaded = NULL, bool *cacheWritten = NULL)
+{
+    FakeBusScanner scanner(devices);
+    bool loaded = scanner.loadCache();
+    scanner.scanPortCached(ScanI2C::I2CPort::WIRE);
+    bool written = scanner.saveCache();
+    if (cacheLoaded)
+        *cacheLoaded = loaded;
+    if (cacheWritten)
+        *cacheWritten = written;
+    return scanner.probes;
+}
+
+void setUp(void)
+{
+    concurrency::LockGuard g(spiLock);
+    FSCom.remove(I2C_CACHE_FILE);
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_noCacheFullScan(void)
+{
+    bool loaded, written;
+    TEST_ASSERT_EQUAL_UINT32(NUM_ADDRESSES, boot({DEVICE_A, DEVICE_B}, &loaded, &written));
+    TEST_ASSERT_FALSE(loaded);
+    TEST_ASSERT_TRUE(written);
+}
+
+/** Same devices as last boot: one presence pass and only the cached addresses identified again, no rewrite */
+void test_cacheReused(void)
+{
+    boot({DEVICE_A, DEVICE_B});
+    bool loaded, written;
+    TEST_ASSERT_EQUAL_UINT32(NUM_ADDRESSES + 2, boot({DEVICE_A, DEVICE_B}, &loaded, &written));
+    TEST_ASSERT_TRUE(loaded);
+    TEST_ASSERT_FALSE(written);
+}
+
+void test_newDeviceInvalidates(void)
+{
+    boot({DEVICE_A, DEVICE_B});
+    bool written;
+    TEST_ASSERT_EQUAL_UINT32(PROBES_UNTIL(DEVICE_C) + NUM_ADDRESSES, boot({DEVICE_A, DEVICE_B, DEVICE_C}, NULL, &written));
+    TEST_ASSERT_TRUE(written);
+
+    // The new set is what the next boot reuses
+    TEST_ASSERT_EQUAL_UINT32(NUM_ADDRESSES + 3, boot({DEVICE_A, DEVICE_B, DEVICE_C}, NULL, &written));
+    TEST_ASSERT_FALSE(written);
+}
+
+void test_removedDeviceInvalidates(void)
+{
+    boot({DEVICE_A, DEVICE_B});
+    bool written;
+    TEST_ASSERT_EQUAL_UINT32(PROBES_UNTIL(DEVICE_B) + NUM_ADDRESSES, boot({DEVICE_A}, NULL, &written));
+    TEST_ASSERT_TRUE(written);
+}
+
+/** After clearCache() the next boot identifies everything again, as with --rescan-i2c */
+void test_clearCacheRescans(void)
+{
+    boot({DEVICE_A, DEVICE_B});
+    TEST_ASSERT_TRUE(ScanI2CTwoWire::clearCache());
+    TEST_ASSERT_FALSE(ScanI2CTwoWire::clearCache());
+    bool loaded, written;
+    TEST_ASSERT_EQUAL_UINT32(NUM_ADDRESSES, boot({DEVICE_A, DEVICE_B}, &loaded, &written));
+    TEST_ASSERT_FALSE(loaded);
+    TEST_ASSERT_TRUE(written);
+}
+
+/** Detection changes between firmware versions, so a cache of another version is not used */
+void test_otherFirmwareIgnored(void)
+{
+    {
+        concurrency::LockGuard g(spiLock);
+        FSCom.mkdir("/prefs");
+    }
+    SafeFile f(I2C_CACHE_FILE);
+    uint32_t magic = I2C_CACHE_MAGIC;
+    const char version[] = "0.0.1.old";
+    uint8_t entry[3] = {(uint8_t)ScanI2C::I2CPort::WIRE, DEVICE_A, ScanI2C::DeviceType::NONE};
+    f.write((uint8_t *)&magic, sizeof(magic));
+    f.write((const uint8_t *)version, sizeof(version));
+    f.write((uint8_t)1);
+    f.write(entry, sizeof(entry));
+    TEST_ASSERT_TRUE(f.close());
+
+    bool loaded, written;
+    TEST_ASSERT_EQUAL_UINT32(NUM_ADDRESSES, boot({DEVICE_A}, &loaded, &written));
+    TEST_ASSERT_FALSE(loaded);
+    TEST_ASSERT_TRUE(written);
+}
+
+void test_corruptIgnored(void)
+{
+    boot({DEVICE_A, DEVICE_B});
+    {
+        concurrency::LockGuard g(spiLock);
+        auto f = FSCom.open(I2C_CACHE_FILE, FILE_O_WRITE);
+        f.write((const uint8_t *)"garbage", 7);
+        f.close();
+    }
+    bool loaded;
+    TEST_ASSERT_EQUAL_UINT32(NUM_ADDRESSES, boot({DEVICE_A, DEVICE_B}, &loaded));
+    TEST_ASSERT_FALSE(loaded);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    initSPI();
+    UNITY_BEGIN();
+    RUN_TEST(test_noCacheFullScan);
+    RUN_TEST(test_cacheReused);
+    RUN_TEST(test_newDeviceInvalidates);
+    RUN_TEST(test_removedDeviceInvalidates);
+    RUN_TEST(test_clearCacheRescans);
+    RUN_TEST(test_otherFirmwareIgnored);
+    RUN_TEST(test_corruptIgnored);
+    exit(UNITY_END());
+}
+
+#else
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    TEST_MESSAGE("No I2C device cache on this platform");
+    exit(UNITY_END());
+}
+#endif
+
+void loop() {}
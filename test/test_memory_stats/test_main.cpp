@@ -0,0 +1,105 @@
+#include "MeshTypes.h"
+#include "configuration.h"
+#include "memGet.h"
+
+#include "TestUtil.h"
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_newCountedToScope(void)
+{
+    uint32_t bytes = memGet.getTagBytes(MemTag::NodeDB);
+    uint32_t objects = memGet.getTagObjects(MemTag::NodeDB);
+
+    std::vector<uint8_t> *v;
+    {
+        MemTagScope memTag(MemTag::NodeDB);
+        v = new std::vector<uint8_t>(1000);
+    }
+    TEST_ASSERT_EQUAL_UINT32(bytes + sizeof(*v) + 1000, memGet.getTagBytes(MemTag::NodeDB));
+    TEST_ASSERT_EQUAL_UINT32(objects + 2, memGet.getTagObjects(MemTag::NodeDB));
+
+    // Freed outside of the scope, still taken off the tag it was counted to
+    delete v;
+    TEST_ASSERT_EQUAL_UINT32(bytes, memGet.getTagBytes(MemTag::NodeDB));
+    TEST_ASSERT_EQUAL_UINT32(objects, memGet.getTagObjects(MemTag::NodeDB));
+}
+
+void test_nestedScopes(void)
+{
+    uint32_t mqttBytes = memGet.getTagBytes(MemTag::MQTT);
+    uint32_t screenBytes = memGet.getTagBytes(MemTag::Screen);
+
+    MemTagScope outer(MemTag::MQTT);
+    char *a = new char[100];
+    char *b;
+    {
+        MemTagScope inner(MemTag::Screen);
+        b = new char[200];
+    }
+    char *c = new char[300];
+    TEST_ASSERT_EQUAL_UINT32(mqttBytes + 400, memGet.getTagBytes(MemTag::MQTT));
+    TEST_ASSERT_EQUAL_UINT32(screenBytes + 200, memGet.getTagBytes(MemTag::Screen));
+
+    delete[] a;
+    delete[] b;
+    delete[] c;
+    TEST_ASSERT_EQUAL_UINT32(mqttBytes, memGet.getTagBytes(MemTag::MQTT));
+    TEST_ASSERT_EQUAL_UINT32(screenBytes, memGet.getTagBytes(MemTag::Screen));
+}
+
+/** Scopes are per thread, allocations of other threads keep their own tag */
+void test_scopeIsPerThread(void)
+{
+    uint32_t routerBytes = memGet.getTagBytes(MemTag::Router);
+
+    MemTagScope memTag(MemTag::Router);
+    char *p = NULL;
+    std::thread other([&p]() { p = new char[500]; });
+    other.join();
+    TEST_ASSERT_EQUAL_UINT32(routerBytes, memGet.getTagBytes(MemTag::Router));
+    delete[] p;
+}
+
+void test_poolCounted(void)
+{
+    MemoryDynamic<meshtastic_MeshPacket> pool(MemTag::Router);
+    uint32_t bytes = memGet.getTagBytes(MemTag::Router);
+    uint32_t objects = memGet.getTagObjects(MemTag::Router);
+
+    meshtastic_MeshPacket *p1 = pool.allocZeroed();
+    meshtastic_MeshPacket *p2 = pool.allocZeroed();
+    TEST_ASSERT_EQUAL_UINT32(bytes + 2 * sizeof(meshtastic_MeshPacket), memGet.getTagBytes(MemTag::Router));
+    TEST_ASSERT_EQUAL_UINT32(objects + 2, memGet.getTagObjects(MemTag::Router));
+
+    pool.release(p1);
+    pool.release(p2);
+    TEST_ASSERT_EQUAL_UINT32(bytes, memGet.getTagBytes(MemTag::Router));
+    TEST_ASSERT_EQUAL_UINT32(objects, memGet.getTagObjects(MemTag::Router));
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+#if HAS_MEMORY_STATS
+    RUN_TEST(test_newCountedToScope);
+    RUN_TEST(test_nestedScopes);
+    RUN_TEST(test_scopeIsPerThread);
+    RUN_TEST(test_poolCounted);
+#endif
+    exit(UNITY_END());
+}
+
+void loop() {}
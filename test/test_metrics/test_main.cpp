@@ -0,0 +1,131 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include "mesh/Metrics.h"
+#include <unity.h>
+
+#if HAS_METRICS
+
+static uint32_t rxGood = 7;
+static uint32_t rxBad = 2;
+static float queueFree = 12;
+
+static uint32_t buckets[3] = {1, 2, 3};
+static uint32_t samples = 6;
+static uint64_t sumMsec = 1500;
+
+static uint32_t bucketLimit(uint8_t bucket)
+{
+    return 1UL << bucket;
+}
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_counterAndGauge(void)
+{
+    Metrics m;
+    TEST_ASSERT_TRUE(m.addCounter("test_rx_total", "Received", &rxGood, "result=\"good\""));
+    TEST_ASSERT_TRUE(m.addGauge("test_queue_free", "Free slots", []() -> float { return queueFree; }));
+    TEST_ASSERT_TRUE(m.addCounter("test_rx_total", "Received", &rxBad, "result=\"bad\""));
+    TEST_ASSERT_EQUAL_UINT8(3, m.size());
+
+    std::string out;
+    m.writePrometheus(out);
+    // Series of one name are grouped under a single header, in registration order
+    TEST_ASSERT_EQUAL_STRING("# HELP test_rx_total Received\n"
+                             "# TYPE test_rx_total counter\n"
+                             "test_rx_total{result=\"good\"} 7\n"
+                             "test_rx_total{result=\"bad\"} 2\n"
+                             "# HELP test_queue_free Free slots\n"
+                             "# TYPE test_queue_free gauge\n"
+                             "test_queue_free 12\n",
+                             out.c_str());
+}
+
+void test_histogram(void)
+{
+    Metrics m;
+    Metrics::Histogram h = {buckets, 3, &bucketLimit, 0.001f, &samples, &sumMsec, 0.001f};
+    TEST_ASSERT_TRUE(m.addHistogram("test_latency_seconds", "Latency", h, "stage=\"rx\""));
+
+    std::string out;
+    m.writePrometheus(out);
+    // Buckets are cumulative, the last one is +Inf
+    TEST_ASSERT_EQUAL_STRING("# HELP test_latency_seconds Latency\n"
+                             "# TYPE test_latency_seconds histogram\n"
+                             "test_latency_seconds_bucket{stage=\"rx\",le=\"0.001\"} 1\n"
+                             "test_latency_seconds_bucket{stage=\"rx\",le=\"0.002\"} 3\n"
+                             "test_latency_seconds_bucket{stage=\"rx\",le=\"+Inf\"} 6\n"
+                             "test_latency_seconds_sum{stage=\"rx\"} 1.5\n"
+                             "test_latency_seconds_count{stage=\"rx\"} 6\n",
+                             out.c_str());
+}
+
+void test_full(void)
+{
+    Metrics m;
+    for (int i = 0; i < METRICS_MAX; i++)
+        TEST_ASSERT_TRUE(m.addCounter("test_total", "Counter", &rxGood));
+    TEST_ASSERT_FALSE(m.addCounter("test_total", "Counter", &rxGood));
+    TEST_ASSERT_EQUAL_UINT8(METRICS_MAX, m.size());
+}
+
+/** Other threads only see what the main thread last rendered */
+void test_snapshot(void)
+{
+    static uint32_t value = 1;
+    metrics.addCounter("test_snapshot_total", "Snapshot", &value);
+    MetricsSnapshot snapshot;
+
+    std::string out;
+    snapshot.get(out);
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, out.find("test_snapshot_total 1\n"));
+
+    value = 2;
+    snapshot.get(out);
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, out.find("test_snapshot_total 1\n"));
+
+    snapshot.update();
+    snapshot.get(out);
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, out.find("test_snapshot_total 2\n"));
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    RUN_TEST(test_counterAndGauge);
+    RUN_TEST(test_histogram);
+    RUN_TEST(test_full);
+    RUN_TEST(test_snapshot);
+    exit(UNITY_END());
+}
+
+#else
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    TEST_MESSAGE("No metrics on this platform");
+    exit(UNITY_END());
+}
+#endif
+
+void loop() {}
@@ -0,0 +1,192 @@
+#include "DebugConfiguration.h"
+#include "SPILock.h"
+#include "TestUtil.h"
+#include "mesh/NodeDB.h"
+#include "mesh/SinglePortModule.h"
+#include <unity.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// About as many modules as a full portduino build registers, most of them on one portnum
+#define BENCH_PORT_MODULES 30
+#define BENCH_ANY_PORT_MODULES 6
+#define BENCH_PACKETS 200000
+#define BENCH_FIRST_PORT meshtastic_PortNum_PRIVATE_APP
+
+static std::string calls;
+
+class DispatchTestModule : public SinglePortModule
+{
+    bool anyPort;
+
+  public:
+    ProcessMessage result = ProcessMessage::CONTINUE;
+
+    DispatchTestModule(const char *_name, meshtastic_PortNum port, bool _anyPort = false)
+        : SinglePortModule(_name, port), anyPort(_anyPort)
+    {
+    }
+
+    void bindTo(const char *channelName) { boundChannel = channelName; }
+
+  protected:
+    // An any portnum module with the wantPacket() of SinglePortModule is what every module looked like to the old linear walk
+    virtual meshtastic_PortNum getPortNum() override { return anyPort ? meshtastic_PortNum_UNKNOWN_APP : ourPortNum; }
+
+    virtual ProcessMessage handleReceived(const meshtastic_MeshPacket &mp) override
+    {
+        calls += name;
+        return result;
+    }
+};
+
+void setUp(void)
+{
+    calls.clear();
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+static void makePacket(meshtastic_MeshPacket &p, meshtastic_PortNum port, ChannelIndex channel = 0)
+{
+    memset(&p, 0, sizeof(p));
+    p.from = 0x11223344;
+    p.to = NODENUM_BROADCAST;
+    p.id = 1;
+    p.channel = channel;
+    p.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    p.decoded.portnum = port;
+}
+
+/** Modules on the portnum and the any portnum ones must still be called in registration order */
+void test_registrationOrder(void)
+{
+    DispatchTestModule a("a", meshtastic_PortNum_PRIVATE_APP);
+    DispatchTestModule b("b", meshtastic_PortNum_PRIVATE_APP, true);
+    DispatchTestModule c("c", meshtastic_PortNum_ATAK_FORWARDER);
+    DispatchTestModule d("d", meshtastic_PortNum_PRIVATE_APP);
+
+    meshtastic_MeshPacket p;
+    makePacket(p, meshtastic_PortNum_PRIVATE_APP);
+    MeshModule::callModules(p);
+    TEST_ASSERT_EQUAL_STRING("abd", calls.c_str());
+
+    calls.clear();
+    makePacket(p, meshtastic_PortNum_ATAK_FORWARDER);
+    MeshModule::callModules(p);
+    TEST_ASSERT_EQUAL_STRING("c", calls.c_str());
+}
+
+void test_stopEndsDispatch(void)
+{
+    DispatchTestModule a("a", meshtastic_PortNum_PRIVATE_APP);
+    DispatchTestModule b("b", meshtastic_PortNum_PRIVATE_APP, true);
+    a.result = ProcessMessage::STOP;
+
+    meshtastic_MeshPacket p;
+    makePacket(p, meshtastic_PortNum_PRIVATE_APP);
+    MeshModule::callModules(p);
+    TEST_ASSERT_EQUAL_STRING("a", calls.c_str());
+}
+
+/** A module registered after the tables were built must be called too */
+void test_lateRegistration(void)
+{
+    DispatchTestModule a("a", meshtastic_PortNum_PRIVATE_APP);
+    meshtastic_MeshPacket p;
+    makePacket(p, meshtastic_PortNum_PRIVATE_APP);
+    MeshModule::callModules(p);
+
+    DispatchTestModule b("b", meshtastic_PortNum_PRIVATE_APP);
+    calls.clear();
+    MeshModule::callModules(p);
+    TEST_ASSERT_EQUAL_STRING("ab", calls.c_str());
+}
+
+/** The bound channel is resolved to indices again whenever the channels change */
+void test_boundChannel(void)
+{
+    meshtastic_Channel ch = channels.getByIndex(1);
+    ch.role = meshtastic_Channel_Role_SECONDARY;
+    strcpy(ch.settings.name, "bench");
+    channels.setChannel(ch);
+
+    DispatchTestModule a("a", meshtastic_PortNum_PRIVATE_APP);
+    a.bindTo("Bench");
+
+    meshtastic_MeshPacket p;
+    makePacket(p, meshtastic_PortNum_PRIVATE_APP, 1);
+    MeshModule::callModules(p);
+    TEST_ASSERT_EQUAL_STRING("a", calls.c_str());
+
+    calls.clear();
+    makePacket(p, meshtastic_PortNum_PRIVATE_APP, 0);
+    MeshModule::callModules(p);
+    TEST_ASSERT_EQUAL_STRING("", calls.c_str());
+
+    strcpy(ch.settings.name, "other");
+    channels.setChannel(ch);
+    makePacket(p, meshtastic_PortNum_PRIVATE_APP, 1);
+    MeshModule::callModules(p);
+    TEST_ASSERT_EQUAL_STRING("", calls.c_str());
+
+    ch.role = meshtastic_Channel_Role_DISABLED;
+    ch.settings.name[0] = '\0';
+    channels.setChannel(ch);
+}
+
+/** Dispatch cost per packet with BENCH_PORT_MODULES + BENCH_ANY_PORT_MODULES modules, each packet wanted by one of them */
+static double dispatchNsPerPacket(bool declarePorts)
+{
+    std::vector<DispatchTestModule *> set;
+    for (int i = 0; i < BENCH_PORT_MODULES; i++)
+        set.push_back(new DispatchTestModule("", (meshtastic_PortNum)(BENCH_FIRST_PORT + i), !declarePorts));
+    for (int i = 0; i < BENCH_ANY_PORT_MODULES; i++)
+        set.push_back(new DispatchTestModule("", meshtastic_PortNum_MAX, true));
+
+    meshtastic_MeshPacket p;
+    makePacket(p, BENCH_FIRST_PORT);
+    MeshModule::callModules(p); // Build the tables outside of the measurement
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_PACKETS; i++) {
+        p.decoded.portnum = (meshtastic_PortNum)(BENCH_FIRST_PORT + i % BENCH_PORT_MODULES);
+        MeshModule::callModules(p);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (auto m : set)
+        delete m;
+    return seconds * 1e9 / BENCH_PACKETS;
+}
+
+void test_dispatchCost(void)
+{
+    double linear = dispatchNsPerPacket(false);
+    double table = dispatchNsPerPacket(true);
+
+    LOG_INFO("Module dispatch: linear walk %.0f ns/packet, portnum table %.0f ns/packet (x%.1f)", linear, table,
+             linear / table);
+    TEST_ASSERT_TRUE(table < linear);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    initSPI();
+    nodeDB = new NodeDB();
+    UNITY_BEGIN();
+    RUN_TEST(test_registrationOrder);
+    RUN_TEST(test_stopEndsDispatch);
+    RUN_TEST(test_lateRegistration);
+    RUN_TEST(test_boundChannel);
+    RUN_TEST(test_dispatchCost);
+    exit(UNITY_END());
+}
+
+void loop() {}
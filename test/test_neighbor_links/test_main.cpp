@@ -0,0 +1,197 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include "mesh/FloodingRouter.h"
+#include "mesh/NeighborLinkTable.h"
+#include "platform/portduino/PortduinoGlue.h"
+#include <unity.h>
+
+#define ORIGIN 0x1234
+#define STRONG_A 0xa1
+#define STRONG_B 0xb2
+#define WEAK 0xc3
+#define SHORT_AGE_MSEC 50
+
+// Exposes the coverage suppression decision of FloodingRouter
+class TestRouter : public FloodingRouter
+{
+  public:
+    using FloodingRouter::isCoveredByNeighbors;
+    using FloodingRouter::shouldFilterReceived;
+
+    NeighborLinkTable &links() { return neighborLinks; }
+};
+
+static TestRouter *testRouter;
+
+void setUp(void)
+{
+    settingsMap[lora_coverage_suppression] = 2;
+    testRouter->links() = NeighborLinkTable();
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+static void makePacket(meshtastic_MeshPacket &p, uint8_t relayer, float snr, PacketId id = 1)
+{
+    memset(&p, 0, sizeof(p));
+    p.from = ORIGIN;
+    p.to = NODENUM_BROADCAST;
+    p.id = id;
+    p.relay_node = relayer;
+    p.rx_snr = snr;
+    p.rx_rssi = -80;
+    p.hop_limit = 2;
+    p.which_payload_variant = meshtastic_MeshPacket_encrypted_tag;
+}
+
+static void hear(NeighborLinkTable &links, uint8_t relayer, float snr, int times)
+{
+    meshtastic_MeshPacket p;
+    for (int i = 0; i < times; i++) {
+        makePacket(p, relayer, snr);
+        links.record(&p);
+    }
+}
+
+void test_becomesStrong(void)
+{
+    NeighborLinkTable links;
+    hear(links, STRONG_A, 6, NEIGHBOR_STRONG_MIN_HEARD - 1);
+    TEST_ASSERT_FALSE(links.isStrong(STRONG_A));
+    hear(links, STRONG_A, 6, 1);
+    TEST_ASSERT_TRUE(links.isStrong(STRONG_A));
+    TEST_ASSERT_EQUAL_UINT16(NEIGHBOR_STRONG_MIN_HEARD, links.find(STRONG_A)->heardCount);
+
+    hear(links, WEAK, -10, 10);
+    TEST_ASSERT_FALSE(links.isStrong(WEAK));
+    TEST_ASSERT_EQUAL_UINT8(2, links.size());
+}
+
+/** Packets that did not come over LoRa carry no link quality */
+void test_ignoresNonLoRa(void)
+{
+    NeighborLinkTable links;
+    meshtastic_MeshPacket p;
+    makePacket(p, STRONG_A, 6);
+    p.via_mqtt = true;
+    links.record(&p);
+    makePacket(p, NO_RELAY_NODE, 6);
+    links.record(&p);
+    makePacket(p, STRONG_A, 0);
+    p.rx_rssi = 0;
+    links.record(&p);
+    TEST_ASSERT_EQUAL_UINT8(0, links.size());
+}
+
+void test_evictsLeastRecentlyHeard(void)
+{
+    NeighborLinkTable links;
+    for (int i = 0; i < NEIGHBOR_LINK_TABLE_SIZE; i++) {
+        hear(links, i + 1, 6, 1);
+        delay(1);
+    }
+    TEST_ASSERT_EQUAL_UINT8(NEIGHBOR_LINK_TABLE_SIZE, links.size());
+    hear(links, 1, 6, 1); // Relayer 1 is now the most recent, 2 the least
+    delay(1);
+    hear(links, 0xf0, 6, 1);
+    TEST_ASSERT_EQUAL_UINT8(NEIGHBOR_LINK_TABLE_SIZE, links.size());
+    TEST_ASSERT_NULL(links.find(2));
+    TEST_ASSERT_NOT_NULL(links.find(1));
+    TEST_ASSERT_NOT_NULL(links.find(0xf0));
+}
+
+/** A relayer not heard for longer than the maximum age is no longer strong, and starts over when heard again */
+void test_aging(void)
+{
+    NeighborLinkTable links(SHORT_AGE_MSEC);
+    hear(links, STRONG_A, 6, 5);
+    TEST_ASSERT_TRUE(links.isStrong(STRONG_A));
+
+    delay(SHORT_AGE_MSEC * 2);
+    TEST_ASSERT_TRUE(links.isStale(*links.find(STRONG_A)));
+    TEST_ASSERT_FALSE(links.isStrong(STRONG_A));
+
+    hear(links, STRONG_A, -10, 1);
+    const NeighborLinkTable::Entry *e = links.find(STRONG_A);
+    TEST_ASSERT_EQUAL_UINT16(1, e->heardCount);
+    TEST_ASSERT_EQUAL_INT16(-40, e->snrQ2); // Not averaged with the old samples
+    TEST_ASSERT_FALSE(links.isStrong(STRONG_A));
+}
+
+/** Receive the same packet relayed by the given relayer, as the radio would hand it to the router */
+static void receive(uint8_t relayer, float snr, PacketId id)
+{
+    meshtastic_MeshPacket p;
+    makePacket(p, relayer, snr, id);
+    testRouter->shouldFilterReceived(&p);
+}
+
+void test_suppressedWhenCovered(void)
+{
+    hear(testRouter->links(), STRONG_A, 6, 5);
+    hear(testRouter->links(), STRONG_B, 8, 5);
+    hear(testRouter->links(), WEAK, -12, 5);
+
+    meshtastic_MeshPacket p;
+    makePacket(p, STRONG_A, 6, 100);
+    receive(STRONG_A, 6, 100);
+    TEST_ASSERT_FALSE(testRouter->isCoveredByNeighbors(&p)); // Only one strong relayer so far
+    receive(WEAK, -12, 100);
+    TEST_ASSERT_FALSE(testRouter->isCoveredByNeighbors(&p)); // Weak relayers don't count
+    receive(STRONG_B, 8, 100);
+    TEST_ASSERT_TRUE(testRouter->isCoveredByNeighbors(&p));
+
+    // Other packets are judged by their own relayers
+    makePacket(p, STRONG_A, 6, 101);
+    receive(STRONG_A, 6, 101);
+    TEST_ASSERT_FALSE(testRouter->isCoveredByNeighbors(&p));
+}
+
+void test_notSuppressedWhenDisabled(void)
+{
+    settingsMap[lora_coverage_suppression] = 0;
+    hear(testRouter->links(), STRONG_A, 6, 5);
+    hear(testRouter->links(), STRONG_B, 8, 5);
+
+    meshtastic_MeshPacket p;
+    makePacket(p, STRONG_A, 6, 200);
+    receive(STRONG_A, 6, 200);
+    receive(STRONG_B, 8, 200);
+    TEST_ASSERT_FALSE(testRouter->isCoveredByNeighbors(&p));
+}
+
+/** Neighbors that went quiet no longer suppress our rebroadcast */
+void test_notSuppressedByStaleNeighbors(void)
+{
+    testRouter->links() = NeighborLinkTable(SHORT_AGE_MSEC);
+    hear(testRouter->links(), STRONG_A, 6, 5);
+    hear(testRouter->links(), STRONG_B, 8, 5);
+    delay(SHORT_AGE_MSEC * 2);
+
+    meshtastic_MeshPacket p;
+    makePacket(p, STRONG_A, 6, 300);
+    receive(STRONG_A, 6, 300);
+    receive(STRONG_B, 8, 300);
+    TEST_ASSERT_FALSE(testRouter->isCoveredByNeighbors(&p));
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    nodeDB = new NodeDB();
+    testRouter = new TestRouter();
+    UNITY_BEGIN();
+    RUN_TEST(test_becomesStrong);
+    RUN_TEST(test_ignoresNonLoRa);
+    RUN_TEST(test_evictsLeastRecentlyHeard);
+    RUN_TEST(test_aging);
+    RUN_TEST(test_suppressedWhenCovered);
+    RUN_TEST(test_notSuppressedWhenDisabled);
+    RUN_TEST(test_notSuppressedByStaleNeighbors);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,232 @@
+#include "DebugConfiguration.h"
+#include "SPILock.h"
+#include "TestUtil.h"
+#include "mesh/MeshService.h"
+#include "mesh/NodeDB.h"
+#include "mesh/PhoneAPI.h"
+#include <unity.h>
+
+#include <algorithm>
+#include <vector>
+#ifdef ARCH_PORTDUINO
+#include <thread>
+#endif
+
+#define FIRST_NODE 0x1000
+#define NUM_NODES 5
+#define MAX_FRAMES 500
+#define LEGACY_NONCE 0x1234
+
+// A client link that is always up
+class TestPhoneAPI : public PhoneAPI
+{
+  protected:
+    virtual bool checkIsConnected() override { return true; }
+};
+
+/** What one config download brought */
+struct Download {
+    std::vector<NodeNum> nodes;   // NodeInfos with a user or position
+    std::vector<NodeNum> removed; // NodeInfos with nothing but the num
+    bool gotMyInfo = false;       // Full config, not only nodes
+    uint32_t completeId = 0;
+};
+
+static TestPhoneAPI *api;
+
+static Download download(PhoneAPI &phone, uint32_t nonce)
+{
+    meshtastic_ToRadio toRadio = meshtastic_ToRadio_init_zero;
+    toRadio.which_payload_variant = meshtastic_ToRadio_want_config_id_tag;
+    toRadio.want_config_id = nonce;
+    uint8_t buf[MAX_TO_FROM_RADIO_SIZE];
+    size_t len = pb_encode_to_bytes(buf, sizeof(buf), &meshtastic_ToRadio_msg, &toRadio);
+    phone.handleToRadio(buf, len);
+
+    Download d;
+    for (int i = 0; i < MAX_FRAMES && d.completeId == 0; i++) {
+        len = phone.getFromRadio(buf);
+        if (len == 0) // a state without a frame to send
+            continue;
+        meshtastic_FromRadio fromRadio = meshtastic_FromRadio_init_zero;
+        TEST_ASSERT_TRUE(pb_decode_from_bytes(buf, len, &meshtastic_FromRadio_msg, &fromRadio));
+        switch (fromRadio.which_payload_variant) {
+        case meshtastic_FromRadio_my_info_tag:
+            d.gotMyInfo = true;
+            break;
+        case meshtastic_FromRadio_node_info_tag:
+            if (fromRadio.node_info.has_user || fromRadio.node_info.has_position)
+                d.nodes.push_back(fromRadio.node_info.num);
+            else
+                d.removed.push_back(fromRadio.node_info.num);
+            break;
+        case meshtastic_FromRadio_config_complete_id_tag:
+            d.completeId = fromRadio.config_complete_id;
+            break;
+        }
+    }
+    TEST_ASSERT_NOT_EQUAL(0, d.completeId);
+    phone.close();
+    // Our own node comes first, and again with the others when it changed
+    std::sort(d.nodes.begin(), d.nodes.end());
+    d.nodes.erase(std::unique(d.nodes.begin(), d.nodes.end()), d.nodes.end());
+    return d;
+}
+
+static void moveNode(NodeNum n, int32_t latitude)
+{
+    meshtastic_Position pos = meshtastic_Position_init_default;
+    pos.has_latitude_i = true;
+    pos.has_longitude_i = true;
+    pos.latitude_i = latitude;
+    pos.longitude_i = 1;
+    pos.time = 1700000000;
+    nodeDB->updatePosition(n, pos);
+}
+
+static bool contains(const std::vector<NodeNum> &nodes, NodeNum n)
+{
+    return std::find(nodes.begin(), nodes.end(), n) != nodes.end();
+}
+
+void setUp(void)
+{
+    for (NodeNum n = FIRST_NODE; n < FIRST_NODE + NUM_NODES; n++)
+        moveNode(n, 100);
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+/** The first sync gets every node and a token instead of the nonce */
+void test_firstSyncGetsEverything(void)
+{
+    Download d = download(*api, SPECIAL_NONCE_NODES_SYNC);
+    TEST_ASSERT_FALSE(d.gotMyInfo);
+    TEST_ASSERT_NOT_EQUAL(SPECIAL_NONCE_NODES_SYNC, d.completeId);
+    for (NodeNum n = FIRST_NODE; n < FIRST_NODE + NUM_NODES; n++)
+        TEST_ASSERT_TRUE(contains(d.nodes, n));
+    TEST_ASSERT_TRUE(contains(d.nodes, nodeDB->getNodeNum()));
+}
+
+/** Nothing changed: only our own node, and a fresh token */
+void test_tokenHit(void)
+{
+    uint32_t token = download(*api, SPECIAL_NONCE_NODES_SYNC).completeId;
+    Download d = download(*api, token);
+    TEST_ASSERT_FALSE(d.gotMyInfo);
+    TEST_ASSERT_EQUAL_UINT32(1, d.nodes.size());
+    TEST_ASSERT_EQUAL_UINT32(nodeDB->getNodeNum(), d.nodes[0]);
+    TEST_ASSERT_EQUAL_UINT32(0, d.removed.size());
+    TEST_ASSERT_NOT_EQUAL(token, d.completeId);
+}
+
+/** A client that doesn't know about sync tokens gets the full config and its own nonce back */
+void test_unknownTokenMisses(void)
+{
+    Download d = download(*api, LEGACY_NONCE);
+    TEST_ASSERT_TRUE(d.gotMyInfo);
+    TEST_ASSERT_EQUAL_UINT32(LEGACY_NONCE, d.completeId);
+    for (NodeNum n = FIRST_NODE; n < FIRST_NODE + NUM_NODES; n++)
+        TEST_ASSERT_TRUE(contains(d.nodes, n));
+}
+
+void test_changedNodeSent(void)
+{
+    uint32_t token = download(*api, SPECIAL_NONCE_NODES_SYNC).completeId;
+    moveNode(FIRST_NODE + 2, 200);
+    Download d = download(*api, token);
+    TEST_ASSERT_EQUAL_UINT32(2, d.nodes.size());
+    TEST_ASSERT_TRUE(contains(d.nodes, FIRST_NODE + 2));
+    TEST_ASSERT_TRUE(contains(d.nodes, nodeDB->getNodeNum()));
+
+    // The next token is up to date with that change
+    d = download(*api, d.completeId);
+    TEST_ASSERT_EQUAL_UINT32(1, d.nodes.size());
+}
+
+void test_removedNodeSent(void)
+{
+    uint32_t token = download(*api, SPECIAL_NONCE_NODES_SYNC).completeId;
+    nodeDB->removeNodeByNum(FIRST_NODE + 3);
+    Download d = download(*api, token);
+    TEST_ASSERT_EQUAL_UINT32(1, d.removed.size());
+    TEST_ASSERT_EQUAL_UINT32(FIRST_NODE + 3, d.removed[0]);
+    TEST_ASSERT_FALSE(contains(d.nodes, FIRST_NODE + 3));
+}
+
+/** A client may reconnect over another transport, tokens are shared by all PhoneAPIs */
+void test_tokenSharedByInstances(void)
+{
+    uint32_t token = download(*api, SPECIAL_NONCE_NODES_SYNC).completeId;
+    TestPhoneAPI other;
+    Download d = download(other, token);
+    TEST_ASSERT_FALSE(d.gotMyInfo);
+    TEST_ASSERT_EQUAL_UINT32(1, d.nodes.size());
+}
+
+/** Bytes past the terminator of a string are not part of the node */
+void test_stringTailIsNoChange(void)
+{
+    meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(FIRST_NODE);
+    strcpy(node->user.long_name, "Node");
+    node->has_user = true;
+    uint32_t seq = nodeDB->updateChangeSeqs();
+    uint32_t nodeSeq = nodeDB->getChangeSeq(FIRST_NODE);
+
+    node->user.long_name[sizeof(node->user.long_name) - 2] = 'x';
+    TEST_ASSERT_EQUAL_UINT32(seq, nodeDB->updateChangeSeqs());
+    TEST_ASSERT_EQUAL_UINT32(nodeSeq, nodeDB->getChangeSeq(FIRST_NODE));
+
+    memset(node->user.long_name, 0, sizeof(node->user.long_name));
+    node->has_user = false;
+}
+
+#ifdef ARCH_PORTDUINO
+/** Clients of the HTTP API start their downloads on the web server threads, at the same time */
+void test_concurrentSyncs(void)
+{
+    bool ok[4];
+    std::thread threads[4];
+    for (int t = 0; t < 4; t++) {
+        ok[t] = true;
+        threads[t] = std::thread([t, &ok]() {
+            for (int i = 0; i < 500; i++) {
+                uint32_t seq = nodeDB->updateChangeSeqs();
+                if (!nodeDB->canSyncSince(seq) || nodeDB->getChangeSeq(FIRST_NODE) == UINT32_MAX)
+                    ok[t] = false;
+            }
+        });
+    }
+    for (int t = 0; t < 4; t++) {
+        threads[t].join();
+        TEST_ASSERT_TRUE(ok[t]);
+    }
+}
+#endif
+
+void setup()
+{
+    initializeTestEnvironment();
+    initSPI();
+    nodeDB = new NodeDB();
+    service = new MeshService();
+    api = new TestPhoneAPI();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_firstSyncGetsEverything);
+    RUN_TEST(test_tokenHit);
+    RUN_TEST(test_unknownTokenMisses);
+    RUN_TEST(test_changedNodeSent);
+    RUN_TEST(test_removedNodeSent);
+    RUN_TEST(test_tokenSharedByInstances);
+    RUN_TEST(test_stringTailIsNoChange);
+#ifdef ARCH_PORTDUINO
+    RUN_TEST(test_concurrentSyncs);
+#endif
+    exit(UNITY_END());
+}
+
+void loop() {}
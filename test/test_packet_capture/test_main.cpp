@@ -0,0 +1,236 @@
+#include "DebugConfiguration.h"
+#include "SPILock.h"
+#include "TestUtil.h"
+#include "mesh/NodeDB.h"
+#include "mesh/PacketCapture.h"
+#include "mesh/Router.h"
+#include "mesh/SinglePortModule.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include <set>
+
+#define CAPTURE_PATH "/tmp/test_packet_capture.pcap"
+#define FIRST_NODE 0x1000
+#define NUM_PACED 10
+#define PACE_MSEC 20
+#define REPLAY_SPEED 2
+#define NUM_BENCHMARK 500
+
+// Collects the senders of what made it through the router to the modules
+class CountingModule : public SinglePortModule
+{
+  public:
+    std::set<NodeNum> received;
+
+    CountingModule() : SinglePortModule("counting", meshtastic_PortNum_PRIVATE_APP) {}
+
+  protected:
+    virtual ProcessMessage handleReceived(const meshtastic_MeshPacket &mp) override
+    {
+        received.insert(mp.from);
+        return ProcessMessage::CONTINUE;
+    }
+};
+
+static CountingModule *counting;
+
+void setUp(void)
+{
+    counting->received.clear();
+}
+
+void tearDown(void)
+{
+    packetCapture.close();
+}
+
+static void makePacket(meshtastic_MeshPacket &p, NodeNum from, PacketId id)
+{
+    memset(&p, 0, sizeof(p));
+    p.from = from;
+    p.to = NODENUM_BROADCAST;
+    p.id = id;
+    p.hop_limit = 3;
+    p.hop_start = 3;
+    p.rx_snr = -4.5;
+    p.rx_rssi = -110;
+    p.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    p.decoded.portnum = meshtastic_PortNum_PRIVATE_APP;
+    p.decoded.payload.size = snprintf((char *)p.decoded.payload.bytes, sizeof(p.decoded.payload.bytes), "hello %u", id);
+}
+
+/** Run the replay and the router until the capture is done, as the main loop would */
+static void runReplay(PacketReplay &replay)
+{
+    while (!replay.isDone()) {
+        int32_t msec = replay.runOnce();
+        router->runOnce();
+        if (msec > 0)
+            delay(msec);
+    }
+}
+
+void test_roundTrip(void)
+{
+    TEST_ASSERT_TRUE(packetCapture.open(CAPTURE_PATH));
+
+    // A frame as the radio has it
+    RadioBuffer buf = {};
+    buf.header.from = FIRST_NODE;
+    buf.header.to = NODENUM_BROADCAST;
+    buf.header.id = 42;
+    buf.header.flags = 3 | PACKET_FLAGS_WANT_ACK_MASK | (5 << PACKET_FLAGS_HOP_START_SHIFT);
+    buf.header.channel = 8;
+    buf.header.relay_node = 0x34;
+    memcpy(buf.payload, "\x01\x02\x03\x04\x05", 5);
+    packetCapture.writeFrame(PacketCapture::RX, (uint8_t *)&buf, sizeof(PacketHeader) + 5, 6.25, -97);
+    packetCapture.writeFrame(PacketCapture::TX, (uint8_t *)&buf, sizeof(PacketHeader) + 5, 0, 0);
+    meshtastic_MeshPacket p;
+    makePacket(p, FIRST_NODE + 1, 43);
+    packetCapture.writePacket(PacketCapture::RX, &p);
+    TEST_ASSERT_EQUAL_UINT32(3, packetCapture.framesWritten);
+    packetCapture.close();
+
+    PacketCapture::Reader reader;
+    PacketCapture::Frame frame;
+    TEST_ASSERT_TRUE(reader.open(CAPTURE_PATH));
+
+    TEST_ASSERT_TRUE(reader.next(frame));
+    TEST_ASSERT_EQUAL_UINT8(PacketCapture::RX, frame.header.direction);
+    TEST_ASSERT_EQUAL(sizeof(PacketHeader) + 5, frame.length);
+    TEST_ASSERT_EQUAL_MEMORY(&buf, frame.data, frame.length);
+    TEST_ASSERT_TRUE(frame.usec > 0);
+    meshtastic_MeshPacket *mp = PacketCapture::toPacket(frame);
+    TEST_ASSERT_NOT_NULL(mp);
+    TEST_ASSERT_EQUAL_UINT32(FIRST_NODE, mp->from);
+    TEST_ASSERT_EQUAL_UINT32(42, mp->id);
+    TEST_ASSERT_EQUAL_UINT8(3, mp->hop_limit);
+    TEST_ASSERT_EQUAL_UINT8(5, mp->hop_start);
+    TEST_ASSERT_TRUE(mp->want_ack);
+    TEST_ASSERT_EQUAL_UINT8(8, mp->channel);
+    TEST_ASSERT_EQUAL_UINT8(0x34, mp->relay_node);
+    TEST_ASSERT_EQUAL_FLOAT(6.25, mp->rx_snr);
+    TEST_ASSERT_EQUAL_INT32(-97, mp->rx_rssi);
+    TEST_ASSERT_EQUAL(meshtastic_MeshPacket_encrypted_tag, mp->which_payload_variant);
+    TEST_ASSERT_EQUAL(5, mp->encrypted.size);
+    TEST_ASSERT_EQUAL_MEMORY("\x01\x02\x03\x04\x05", mp->encrypted.bytes, 5);
+    packetPool.release(mp);
+
+    TEST_ASSERT_TRUE(reader.next(frame));
+    TEST_ASSERT_EQUAL_UINT8(PacketCapture::TX, frame.header.direction);
+
+    // The simulator's decoded packets come back decoded
+    TEST_ASSERT_TRUE(reader.next(frame));
+    TEST_ASSERT_EQUAL_UINT8(PacketCapture::DECODED, frame.header.flags);
+    mp = PacketCapture::toPacket(frame);
+    TEST_ASSERT_NOT_NULL(mp);
+    TEST_ASSERT_EQUAL_UINT32(FIRST_NODE + 1, mp->from);
+    TEST_ASSERT_EQUAL_FLOAT(-4.5, mp->rx_snr);
+    TEST_ASSERT_EQUAL(meshtastic_MeshPacket_decoded_tag, mp->which_payload_variant);
+    TEST_ASSERT_EQUAL(meshtastic_PortNum_PRIVATE_APP, mp->decoded.portnum);
+    TEST_ASSERT_EQUAL_STRING_LEN("hello 43", (char *)mp->decoded.payload.bytes, mp->decoded.payload.size);
+    packetPool.release(mp);
+
+    TEST_ASSERT_FALSE(reader.next(frame));
+    TEST_ASSERT_EQUAL_UINT32(0, reader.skipped);
+}
+
+void test_notACapture(void)
+{
+    FILE *f = fopen(CAPTURE_PATH, "wb");
+    fputs("this is not a pcap file at all", f);
+    fclose(f);
+    PacketCapture::Reader reader;
+    TEST_ASSERT_FALSE(reader.open(CAPTURE_PATH));
+    PacketReplay replay(CAPTURE_PATH, 1);
+    TEST_ASSERT_TRUE(replay.isDone());
+}
+
+/** Received frames reach the modules in order at the captured pace sped up, what we sent is skipped */
+void test_replayPace(void)
+{
+    TEST_ASSERT_TRUE(packetCapture.open(CAPTURE_PATH));
+    meshtastic_MeshPacket p;
+    for (int i = 0; i < NUM_PACED; i++) {
+        if (i > 0)
+            delay(PACE_MSEC);
+        makePacket(p, FIRST_NODE + i, 100 + i);
+        packetCapture.writePacket(PacketCapture::RX, &p);
+    }
+    packetCapture.writePacket(PacketCapture::TX, &p);
+    packetCapture.close();
+
+    PacketReplay replay(CAPTURE_PATH, REPLAY_SPEED);
+    uint32_t start = millis();
+    runReplay(replay);
+    uint32_t elapsed = millis() - start;
+
+    uint32_t expected = (NUM_PACED - 1) * PACE_MSEC / REPLAY_SPEED;
+    LOG_INFO("Packet replay: %u frames captured over %u msec, replayed in %u msec", NUM_PACED, (NUM_PACED - 1) * PACE_MSEC,
+             elapsed);
+    TEST_ASSERT_EQUAL_UINT32(NUM_PACED, replay.framesReplayed);
+    TEST_ASSERT_EQUAL_UINT32(1, replay.framesSkipped);
+    TEST_ASSERT_EQUAL(NUM_PACED, counting->received.size());
+    TEST_ASSERT_TRUE(elapsed >= expected - 2);
+    TEST_ASSERT_TRUE(elapsed < (NUM_PACED - 1) * PACE_MSEC);
+}
+
+/** Replay as fast as the router takes it, the measure of CPU cost per received frame */
+void test_replayBenchmark(void)
+{
+    TEST_ASSERT_TRUE(packetCapture.open(CAPTURE_PATH));
+    meshtastic_MeshPacket p;
+    for (int i = 0; i < NUM_BENCHMARK; i++) {
+        makePacket(p, FIRST_NODE + i, 1000 + i);
+        packetCapture.writePacket(PacketCapture::RX, &p);
+    }
+    packetCapture.close();
+
+    PacketReplay replay(CAPTURE_PATH, 0);
+    uint32_t start = millis();
+    runReplay(replay);
+    uint32_t elapsed = millis() - start;
+
+    LOG_INFO("Packet replay: %u frames as fast as possible in %u msec, %.0f frames/s", replay.framesReplayed, elapsed,
+             replay.framesReplayed * 1000.0 / (elapsed ? elapsed : 1));
+    TEST_ASSERT_EQUAL_UINT32(NUM_BENCHMARK, replay.framesReplayed);
+    TEST_ASSERT_EQUAL(NUM_BENCHMARK, counting->received.size());
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    initSPI();
+    nodeDB = new NodeDB();
+    router = new Router();
+    counting = new CountingModule();
+    UNITY_BEGIN();
+    RUN_TEST(test_roundTrip);
+    RUN_TEST(test_notACapture);
+    RUN_TEST(test_replayPace);
+    RUN_TEST(test_replayBenchmark);
+    exit(UNITY_END());
+}
+
+#else
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    TEST_MESSAGE("No packet capture on this platform");
+    exit(UNITY_END());
+}
+#endif
+
+void loop() {}
@@ -0,0 +1,154 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include "mesh/PacketTrace.h"
+#include <unity.h>
+
+#if HAS_PACKET_TRACE
+
+#define NODE 0x1234
+#define STEP_MSEC 20
+
+void setUp(void)
+{
+    packetTrace.clear();
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+static void makePacket(meshtastic_MeshPacket &p, PacketId id)
+{
+    memset(&p, 0, sizeof(p));
+    p.from = NODE;
+    p.id = id;
+}
+
+void test_firstMarkOnlyCounts(void)
+{
+    meshtastic_MeshPacket p;
+    makePacket(p, 1);
+    PACKET_TRACE(&p, RX);
+    const PacketTrace::StageStats &s = packetTrace.getStats(PacketTrace::RX);
+    TEST_ASSERT_EQUAL_UINT32(1, s.count);
+    TEST_ASSERT_EQUAL_UINT32(0, s.samples);
+}
+
+void test_latencySincePreviousStage(void)
+{
+    meshtastic_MeshPacket p;
+    makePacket(p, 2);
+    PACKET_TRACE(&p, RX);
+    delay(STEP_MSEC);
+    PACKET_TRACE(&p, RX_QUEUED);
+
+    const PacketTrace::StageStats &s = packetTrace.getStats(PacketTrace::RX_QUEUED);
+    TEST_ASSERT_EQUAL_UINT32(1, s.samples);
+    TEST_ASSERT_TRUE(s.maxUsec >= STEP_MSEC * 1000);
+    TEST_ASSERT_EQUAL_UINT64(s.maxUsec, s.sumUsec);
+    // 20ms falls in the [16, 32) bucket
+    TEST_ASSERT_EQUAL_UINT32(1, s.buckets[5]);
+    TEST_ASSERT_EQUAL_UINT32(32, packetTrace.percentileMsec(PacketTrace::RX_QUEUED, 50));
+}
+
+/** TX_START covers the whole TX queue dwell time, CAD backoff included */
+void test_txStartIncludesBackoff(void)
+{
+    meshtastic_MeshPacket p;
+    makePacket(p, 3);
+    PACKET_TRACE(&p, TX_QUEUED);
+    delay(STEP_MSEC);
+    PACKET_TRACE(&p, TX_CAD_BUSY);
+    delay(STEP_MSEC);
+    PACKET_TRACE(&p, TX_CAD_BUSY);
+    delay(STEP_MSEC);
+    PACKET_TRACE(&p, TX_START);
+
+    const PacketTrace::StageStats &busy = packetTrace.getStats(PacketTrace::TX_CAD_BUSY);
+    TEST_ASSERT_EQUAL_UINT32(2, busy.samples);
+    TEST_ASSERT_TRUE(busy.maxUsec >= 2 * STEP_MSEC * 1000); // Second backoff, still measured from TX_QUEUED
+
+    const PacketTrace::StageStats &start = packetTrace.getStats(PacketTrace::TX_START);
+    TEST_ASSERT_EQUAL_UINT32(1, start.samples);
+    TEST_ASSERT_TRUE(start.maxUsec >= 3 * STEP_MSEC * 1000);
+}
+
+/** TX_DONE ends the lifecycle, a later mark of the same packet starts a new one */
+void test_txDoneEndsLifecycle(void)
+{
+    meshtastic_MeshPacket p;
+    makePacket(p, 4);
+    PACKET_TRACE(&p, TX_START);
+    PACKET_TRACE(&p, TX_DONE);
+    TEST_ASSERT_EQUAL_UINT32(1, packetTrace.getStats(PacketTrace::TX_DONE).samples);
+
+    PACKET_TRACE(&p, RX);
+    TEST_ASSERT_EQUAL_UINT32(1, packetTrace.getStats(PacketTrace::RX).count);
+    TEST_ASSERT_EQUAL_UINT32(0, packetTrace.getStats(PacketTrace::RX).samples);
+}
+
+/** Only PACKET_TRACE_INFLIGHT packets are followed, the least recently marked one is evicted */
+void test_evictsLeastRecentlyMarked(void)
+{
+    meshtastic_MeshPacket p;
+    for (PacketId id = 10; id < 10 + PACKET_TRACE_INFLIGHT + 1; id++) {
+        makePacket(p, id);
+        PACKET_TRACE(&p, RX);
+        delayMicroseconds(10);
+    }
+
+    // The second packet is still followed
+    makePacket(p, 11);
+    PACKET_TRACE(&p, RX_QUEUED);
+    TEST_ASSERT_EQUAL_UINT32(1, packetTrace.getStats(PacketTrace::RX_QUEUED).samples);
+
+    // The first one was evicted by the last one, its next mark starts over
+    makePacket(p, 10);
+    PACKET_TRACE(&p, RX_QUEUED);
+    TEST_ASSERT_EQUAL_UINT32(1, packetTrace.getStats(PacketTrace::RX_QUEUED).samples);
+    TEST_ASSERT_EQUAL_UINT32(2, packetTrace.getStats(PacketTrace::RX_QUEUED).count);
+}
+
+void test_ignoresZeroId(void)
+{
+    meshtastic_MeshPacket p;
+    makePacket(p, 0);
+    PACKET_TRACE(&p, RX);
+    TEST_ASSERT_EQUAL_UINT32(0, packetTrace.getStats(PacketTrace::RX).count);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    RUN_TEST(test_firstMarkOnlyCounts);
+    RUN_TEST(test_latencySincePreviousStage);
+    RUN_TEST(test_txStartIncludesBackoff);
+    RUN_TEST(test_txDoneEndsLifecycle);
+    RUN_TEST(test_evictsLeastRecentlyMarked);
+    RUN_TEST(test_ignoresZeroId);
+    exit(UNITY_END());
+}
+
+#else
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    TEST_MESSAGE("No packet trace on this platform");
+    exit(UNITY_END());
+}
+#endif
+
+void loop() {}
@@ -0,0 +1,136 @@
+#include "DebugConfiguration.h"
+#include "SPILock.h"
+#include "TestUtil.h"
+#include "mesh/MeshService.h"
+#include "mesh/NodeDB.h"
+#include "modules/AdminModule.h"
+#include <unity.h>
+
+#include <functional>
+
+#define BURST_SIZE 10
+
+// Used to feed admin messages to the module as if they came from a local client
+class AdminModuleUnitTest : public AdminModule
+{
+  public:
+    using AdminModule::handleReceivedProtobuf;
+};
+
+static AdminModuleUnitTest *admin;
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+// Keep running the loop until either conditionMet returns true or timeoutMsec elapse.
+static bool loopUntil(std::function<bool()> conditionMet, uint32_t timeoutMsec)
+{
+    uint32_t start = millis();
+    while (millis() - start < timeoutMsec) {
+        long delayMsec = concurrency::mainController.runOrDelay();
+        if (conditionMet())
+            return true;
+        concurrency::mainDelay.delay(std::min(delayMsec, 5L));
+    }
+    return false;
+}
+
+static void sendAdmin(meshtastic_AdminMessage &msg)
+{
+    meshtastic_MeshPacket mp = meshtastic_MeshPacket_init_zero;
+    mp.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    mp.decoded.portnum = meshtastic_PortNum_ADMIN_APP;
+    admin->handleReceivedProtobuf(mp, &msg);
+}
+
+static void setTelemetryInterval(uint32_t interval)
+{
+    meshtastic_AdminMessage msg = meshtastic_AdminMessage_init_zero;
+    msg.which_payload_variant = meshtastic_AdminMessage_set_module_config_tag;
+    msg.set_module_config.which_payload_variant = meshtastic_ModuleConfig_telemetry_tag;
+    msg.set_module_config.payload_variant.telemetry = moduleConfig.telemetry;
+    msg.set_module_config.payload_variant.telemetry.device_update_interval = interval;
+    sendAdmin(msg);
+}
+
+/** A client setting one field per message must cause one write, with the last value */
+void test_burstIsWrittenOnce(void)
+{
+    uint32_t writes = nodeDB->fileWrites;
+    uint32_t avoided = nodeDB->writesAvoided;
+    uint32_t bytes = nodeDB->bytesWritten;
+
+    for (uint32_t i = 1; i <= BURST_SIZE; i++)
+        setTelemetryInterval(1800 + i);
+    TEST_ASSERT_EQUAL_UINT32(writes, nodeDB->fileWrites);
+
+    TEST_ASSERT_TRUE(loopUntil([writes]() { return nodeDB->fileWrites != writes; }, SAVE_MAX_DELAY_MSEC + 1000));
+    TEST_ASSERT_EQUAL_UINT32(writes + 1, nodeDB->fileWrites);
+    TEST_ASSERT_EQUAL_UINT32(avoided + BURST_SIZE - 1, nodeDB->writesAvoided);
+    TEST_ASSERT_TRUE(nodeDB->bytesWritten > bytes);
+
+    meshtastic_LocalModuleConfig saved = meshtastic_LocalModuleConfig_init_zero;
+    TEST_ASSERT_EQUAL_INT(LoadFileResult::LOAD_SUCCESS,
+                          nodeDB->loadProto(moduleConfigFileName, meshtastic_LocalModuleConfig_size,
+                                            sizeof(meshtastic_LocalModuleConfig), &meshtastic_LocalModuleConfig_msg, &saved));
+    TEST_ASSERT_EQUAL_UINT32(1800 + BURST_SIZE, saved.telemetry.device_update_interval);
+
+    // Nothing else is written later on
+    loopUntil([]() { return false; }, SAVE_QUIET_WINDOW_MSEC + 500);
+    TEST_ASSERT_EQUAL_UINT32(writes + 1, nodeDB->fileWrites);
+}
+
+/** Every dirty segment is written once */
+void test_segmentsOfBurst(void)
+{
+    uint32_t writes = nodeDB->fileWrites;
+
+    for (uint32_t i = 1; i <= BURST_SIZE; i++) {
+        setTelemetryInterval(3600 + i);
+        meshtastic_AdminMessage msg = meshtastic_AdminMessage_init_zero;
+        msg.which_payload_variant = meshtastic_AdminMessage_set_channel_tag;
+        msg.set_channel = channels.getByIndex(0);
+        sendAdmin(msg);
+    }
+
+    TEST_ASSERT_TRUE(loopUntil([writes]() { return nodeDB->fileWrites != writes; }, SAVE_MAX_DELAY_MSEC + 1000));
+    TEST_ASSERT_EQUAL_UINT32(writes + 2, nodeDB->fileWrites);
+}
+
+/** A reboot must not lose what is still waiting for its quiet window */
+void test_flushBeforeReboot(void)
+{
+    uint32_t writes = nodeDB->fileWrites;
+
+    setTelemetryInterval(7200);
+    TEST_ASSERT_EQUAL_UINT32(writes, nodeDB->fileWrites);
+    TEST_ASSERT_TRUE(nodeDB->flushPendingSaves());
+    TEST_ASSERT_EQUAL_UINT32(writes + 1, nodeDB->fileWrites);
+
+    loopUntil([]() { return false; }, SAVE_QUIET_WINDOW_MSEC + 500);
+    TEST_ASSERT_EQUAL_UINT32(writes + 1, nodeDB->fileWrites);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    initSPI();
+    nodeDB = new NodeDB();
+    service = new MeshService();
+    admin = new AdminModuleUnitTest();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_burstIsWrittenOnce);
+    RUN_TEST(test_segmentsOfBurst);
+    RUN_TEST(test_flushBeforeReboot);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,146 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include "mesh/NodeDB.h"
+#include "mesh/PhoneAPI.h"
+#include "mesh/PhoneAPICache.h"
+#include <unity.h>
+
+#if HAS_PHONEAPI_CACHE
+#include <thread>
+
+#define FRAME_ID 42
+#define NUM_THREADS 4
+#define ROUNDS 20000
+
+static const uint8_t frame[] = {0x12, 0x34, 0x56, 0x78, 0x9a};
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_hitWithSameFingerprint(void)
+{
+    PhoneAPICache cache;
+    uint8_t buf[MAX_TO_FROM_RADIO_SIZE];
+    TEST_ASSERT_EQUAL_UINT32(0, cache.get(PhoneAPICache::CONFIG, FRAME_ID, 7, buf));
+    cache.put(PhoneAPICache::CONFIG, FRAME_ID, 7, frame, sizeof(frame));
+
+    TEST_ASSERT_EQUAL_UINT32(sizeof(frame), cache.get(PhoneAPICache::CONFIG, FRAME_ID, 7, buf));
+    TEST_ASSERT_EQUAL_MEMORY(frame, buf, sizeof(frame));
+    TEST_ASSERT_EQUAL_UINT32(1, cache.getHits());
+    TEST_ASSERT_EQUAL_UINT32(1, cache.getMisses());
+
+    // Same id of the other kind is another frame
+    TEST_ASSERT_EQUAL_UINT32(0, cache.get(PhoneAPICache::NODEINFO, FRAME_ID, 7, buf));
+}
+
+void test_missWithOtherFingerprint(void)
+{
+    PhoneAPICache cache;
+    uint8_t buf[MAX_TO_FROM_RADIO_SIZE];
+    cache.put(PhoneAPICache::NODEINFO, FRAME_ID, 7, frame, sizeof(frame));
+    TEST_ASSERT_EQUAL_UINT32(0, cache.get(PhoneAPICache::NODEINFO, FRAME_ID, 8, buf));
+
+    // A newer frame replaces the old one
+    cache.put(PhoneAPICache::NODEINFO, FRAME_ID, 8, frame, 2);
+    TEST_ASSERT_EQUAL_UINT32(2, cache.get(PhoneAPICache::NODEINFO, FRAME_ID, 8, buf));
+    TEST_ASSERT_EQUAL_UINT32(0, cache.get(PhoneAPICache::NODEINFO, FRAME_ID, 7, buf));
+}
+
+/** A change to the config anywhere invalidates the config frames */
+void test_configChangeInvalidates(void)
+{
+    uint32_t before = PhoneAPICache::configFingerprint();
+    TEST_ASSERT_NOT_EQUAL(0, before);
+    TEST_ASSERT_EQUAL_UINT32(before, PhoneAPICache::configFingerprint());
+
+    config.lora.hop_limit++;
+    uint32_t after = PhoneAPICache::configFingerprint();
+    config.lora.hop_limit--;
+    TEST_ASSERT_NOT_EQUAL(before, after);
+
+    moduleConfig.telemetry.device_update_interval++;
+    after = PhoneAPICache::configFingerprint();
+    moduleConfig.telemetry.device_update_interval--;
+    TEST_ASSERT_NOT_EQUAL(before, after);
+    TEST_ASSERT_EQUAL_UINT32(before, PhoneAPICache::configFingerprint());
+}
+
+/** A change to a node invalidates its NodeInfo frame */
+void test_nodeChangeInvalidates(void)
+{
+    meshtastic_NodeInfoLite node = meshtastic_NodeInfoLite_init_zero;
+    node.num = 0x1234;
+    uint32_t before = PhoneAPICache::fingerprint(&node, sizeof(node));
+    node.last_heard = 1;
+    TEST_ASSERT_NOT_EQUAL(before, PhoneAPICache::fingerprint(&node, sizeof(node)));
+}
+
+/** Clients on the web server threads and the main thread use the cache at the same time */
+void test_concurrentClients(void)
+{
+    static PhoneAPICache cache;
+    bool ok[NUM_THREADS];
+    std::thread threads[NUM_THREADS];
+    for (int t = 0; t < NUM_THREADS; t++) {
+        ok[t] = true;
+        threads[t] = std::thread([t, &ok]() {
+            uint8_t buf[MAX_TO_FROM_RADIO_SIZE];
+            uint8_t mine[8];
+            for (uint32_t i = 0; i < ROUNDS; i++) {
+                uint32_t id = i % (MAX_NUM_NODES + 100); // Also runs into the size limit
+                // Every thread stores its own content under its own fingerprint
+                memset(mine, t, sizeof(mine));
+                cache.put(PhoneAPICache::NODEINFO, id, t + 1, mine, sizeof(mine));
+                size_t len = cache.get(PhoneAPICache::NODEINFO, id, t + 1, buf);
+                if (len != 0 && (len != sizeof(mine) || memcmp(buf, mine, len) != 0))
+                    ok[t] = false;
+            }
+        });
+    }
+    for (int t = 0; t < NUM_THREADS; t++) {
+        threads[t].join();
+        TEST_ASSERT_TRUE(ok[t]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(NUM_THREADS * ROUNDS, cache.getHits() + cache.getMisses());
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    RUN_TEST(test_hitWithSameFingerprint);
+    RUN_TEST(test_missWithOtherFingerprint);
+    RUN_TEST(test_configChangeInvalidates);
+    RUN_TEST(test_nodeChangeInvalidates);
+    RUN_TEST(test_concurrentClients);
+    exit(UNITY_END());
+}
+
+#else
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    TEST_MESSAGE("No PhoneAPI cache on this platform");
+    exit(UNITY_END());
+}
+#endif
+
+void loop() {}
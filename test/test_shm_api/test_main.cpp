@@ -0,0 +1,272 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include "mesh-pb-constants.h"
+#include "mesh/api/ShmPacketAPI.h"
+#include <unity.h>
+
+#ifdef PORTDUINO_LINUX_HARDWARE
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+#define SHM_NAME "/meshtasticd_test_shm_api"
+#define SOCKET_PATH "/tmp" SHM_NAME ".sock"
+
+/** The real transport, recording the ToRadio protobufs it hands to the phone API instead of acting on them */
+class TestShmPacketAPI : public ShmPacketAPI
+{
+  public:
+    std::vector<std::vector<uint8_t>> received;
+
+    using ShmPacketAPI::checkIsConnected;
+
+    TestShmPacketAPI() : ShmPacketAPI(SHM_NAME) { TEST_ASSERT_TRUE(init()); }
+
+    virtual bool handleToRadio(const uint8_t *buf, size_t len) override
+    {
+        received.emplace_back(buf, buf + len);
+        return false;
+    }
+};
+
+/** What an out of tree client sees */
+struct Client {
+    int fd = -1;
+    int fromRadioEvent = -1;
+    int toRadioEvent = -1;
+    ShmPacketRegion *region = NULL;
+};
+
+static TestShmPacketAPI *api;
+static Client client;
+
+static void connectClient(Client &c)
+{
+    c.fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, SOCKET_PATH, sizeof(addr.sun_path) - 1);
+    TEST_ASSERT_EQUAL_INT(0, connect(c.fd, (struct sockaddr *)&addr, sizeof(addr)));
+
+    api->runOnce(); // Accepts and sends the eventfds
+
+    int fds[2];
+    char control[CMSG_SPACE(sizeof(fds))] = {};
+    char version;
+    struct iovec iov = {&version, sizeof(version)};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    TEST_ASSERT_EQUAL_INT(1, recvmsg(c.fd, &msg, 0));
+    TEST_ASSERT_EQUAL_INT(SHM_PACKET_API_VERSION, version);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    TEST_ASSERT_NOT_NULL(cmsg);
+    TEST_ASSERT_EQUAL_INT(SCM_RIGHTS, cmsg->cmsg_type);
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    c.fromRadioEvent = fds[0];
+    c.toRadioEvent = fds[1];
+
+    int shmFd = shm_open(SHM_NAME, O_RDWR, 0);
+    TEST_ASSERT_TRUE(shmFd >= 0);
+    void *p = mmap(NULL, sizeof(ShmPacketRegion), PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    close(shmFd);
+    TEST_ASSERT_TRUE(p != MAP_FAILED);
+    c.region = (ShmPacketRegion *)p;
+}
+
+static void disconnectClient(Client &c)
+{
+    if (c.fd < 0)
+        return;
+    close(c.fd);
+    close(c.fromRadioEvent);
+    close(c.toRadioEvent);
+    munmap(c.region, sizeof(ShmPacketRegion));
+    c = Client();
+}
+
+/** Publish a slot of the given length and content, as a client would */
+static void sendSlot(uint32_t length, const uint8_t *data, size_t dataLen)
+{
+    ShmPacketSlot *slot = client.region->toRadio.beginWrite();
+    TEST_ASSERT_NOT_NULL(slot);
+    memcpy(slot->data, data, dataLen);
+    slot->length = length;
+    client.region->toRadio.commitWrite();
+}
+
+static size_t encodeHeartbeat(uint8_t *buf)
+{
+    meshtastic_ToRadio toRadio = meshtastic_ToRadio_init_zero;
+    toRadio.which_payload_variant = meshtastic_ToRadio_heartbeat_tag;
+    return pb_encode_to_bytes(buf, MAX_TO_FROM_RADIO_SIZE, &meshtastic_ToRadio_msg, &toRadio);
+}
+
+void setUp(void)
+{
+    connectClient(client);
+    api->received.clear();
+    api->toRadioInvalid = 0;
+}
+
+void tearDown(void)
+{
+    disconnectClient(client);
+    api->runOnce(); // Notices the disconnect
+}
+
+void test_regionHeader(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(SHM_PACKET_API_MAGIC, client.region->magic);
+    TEST_ASSERT_EQUAL_UINT32(SHM_PACKET_API_VERSION, client.region->version);
+    TEST_ASSERT_EQUAL_UINT32(MAX_TO_FROM_RADIO_SIZE, client.region->slotSize);
+}
+
+/** No other user may connect or map the segment */
+void test_permissions(void)
+{
+    struct stat st;
+    TEST_ASSERT_EQUAL_INT(0, stat(SOCKET_PATH, &st));
+    TEST_ASSERT_EQUAL_UINT32(0, st.st_mode & S_IRWXO);
+    TEST_ASSERT_EQUAL_INT(0, stat("/dev/shm" SHM_NAME, &st));
+    TEST_ASSERT_EQUAL_UINT32(0, st.st_mode & S_IRWXO);
+}
+
+void test_toRadioDecodedFromPrivateCopy(void)
+{
+    uint8_t buf[MAX_TO_FROM_RADIO_SIZE];
+    size_t len = encodeHeartbeat(buf);
+    sendSlot(len, buf, len);
+    api->runOnce();
+
+    TEST_ASSERT_EQUAL_UINT32(1, api->received.size());
+    TEST_ASSERT_EQUAL_UINT32(len, api->received[0].size());
+    TEST_ASSERT_EQUAL_MEMORY(buf, api->received[0].data(), len);
+    TEST_ASSERT_EQUAL_UINT32(0, client.region->toRadio.size());
+}
+
+/** A slot claiming more bytes than it holds is dropped, the next one is still handled */
+void test_invalidLengthDropped(void)
+{
+    uint8_t buf[MAX_TO_FROM_RADIO_SIZE];
+    size_t len = encodeHeartbeat(buf);
+    sendSlot(MAX_TO_FROM_RADIO_SIZE + 1, buf, len);
+    sendSlot(UINT32_MAX, buf, len);
+    sendSlot(len, buf, len);
+    api->runOnce();
+
+    TEST_ASSERT_EQUAL_UINT32(2, api->toRadioInvalid);
+    TEST_ASSERT_EQUAL_UINT32(1, api->received.size());
+    TEST_ASSERT_EQUAL_UINT32(len, api->received[0].size());
+}
+
+/** A client that keeps publishing can't keep us in one run */
+void test_boundedPerRun(void)
+{
+    uint8_t buf[MAX_TO_FROM_RADIO_SIZE];
+    size_t len = encodeHeartbeat(buf);
+    for (int i = 0; i < SHM_TORADIO_SLOTS; i++)
+        sendSlot(len, buf, len);
+    // Pretend many more were published, as a misbehaving client could
+    client.region->toRadio.head.store(client.region->toRadio.tail.load() + 1000);
+    api->runOnce();
+    TEST_ASSERT_EQUAL_UINT32(SHM_TORADIO_SLOTS, api->received.size());
+}
+
+void test_nothingForDisconnectedPhoneAPI(void)
+{
+    api->runOnce();
+    TEST_ASSERT_EQUAL_UINT32(0, client.region->fromRadio.size());
+}
+
+/** Wait up to a second for the wait thread to make the API due */
+static bool becomesDue()
+{
+    for (int i = 0; i < 100; i++) {
+        if (api->shouldRun(millis()))
+            return true;
+        delay(10);
+    }
+    return false;
+}
+
+/** An idle API sleeps until the client signals ToRadio slots or connects */
+void test_idleWaitsForClient(void)
+{
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, api->runOnce());
+    api->setInterval(INT32_MAX); // As OSThread::run() would
+    TEST_ASSERT_FALSE(api->shouldRun(millis()));
+
+    uint8_t buf[MAX_TO_FROM_RADIO_SIZE];
+    size_t len = encodeHeartbeat(buf);
+    sendSlot(len, buf, len);
+    uint64_t one = 1;
+    TEST_ASSERT_EQUAL_INT(sizeof(one), write(client.toRadioEvent, &one, sizeof(one)));
+    TEST_ASSERT_TRUE(becomesDue());
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, api->runOnce());
+    TEST_ASSERT_EQUAL_UINT32(1, api->received.size());
+
+    // A new client after a disconnect
+    api->setInterval(INT32_MAX);
+    disconnectClient(client);
+    TEST_ASSERT_TRUE(becomesDue());
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, api->runOnce());
+    TEST_ASSERT_FALSE(api->checkIsConnected());
+    connectClient(client);
+    TEST_ASSERT_TRUE(api->checkIsConnected());
+}
+
+void test_clientDisconnect(void)
+{
+    TEST_ASSERT_TRUE(api->checkIsConnected());
+    disconnectClient(client);
+    api->runOnce();
+    TEST_ASSERT_FALSE(api->checkIsConnected());
+    connectClient(client);
+    TEST_ASSERT_TRUE(api->checkIsConnected());
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    api = new TestShmPacketAPI();
+    UNITY_BEGIN();
+    RUN_TEST(test_regionHeader);
+    RUN_TEST(test_permissions);
+    RUN_TEST(test_toRadioDecodedFromPrivateCopy);
+    RUN_TEST(test_invalidLengthDropped);
+    RUN_TEST(test_boundedPerRun);
+    RUN_TEST(test_nothingForDisconnectedPhoneAPI);
+    RUN_TEST(test_clientDisconnect);
+    RUN_TEST(test_idleWaitsForClient);
+    delete api;
+    exit(UNITY_END());
+}
+
+#else
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    TEST_MESSAGE("No shared memory API on this platform");
+    exit(UNITY_END());
+}
+#endif
+
+void loop() {}
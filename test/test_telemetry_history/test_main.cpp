@@ -0,0 +1,234 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include "mesh/TelemetryHistory.h"
+#include <unity.h>
+
+#if HAS_TELEMETRY_HISTORY
+#include <algorithm>
+#include <chrono>
+
+#define NODE 0x1234
+#define START_TIME 1699999200 // A multiple of 15 minutes, so periods start at it
+#define NUM_NODES 250
+#define FIRST_NODE 0x10000
+#define REPORT_SECS 60
+#define SIM_HOURS 24
+
+static TelemetryHistory::Sample samples[TELEMETRY_HISTORY_MAX_SAMPLES];
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_roundTrip(void)
+{
+    TelemetryHistory history(64 * 1024);
+    history.record(NODE, TelemetryHistory::VOLTAGE, START_TIME, 3.712);
+    history.record(NODE, TelemetryHistory::VOLTAGE, START_TIME + 30, 3.698);
+    history.record(NODE, TelemetryHistory::VOLTAGE, START_TIME + 45, 4.2);
+    history.record(NODE, TelemetryHistory::TEMPERATURE, START_TIME, -12.34);
+
+    size_t n = history.query(NODE, TelemetryHistory::VOLTAGE, TelemetryHistory::RAW, samples, TELEMETRY_HISTORY_MAX_SAMPLES);
+    TEST_ASSERT_EQUAL(3, n);
+    TEST_ASSERT_EQUAL_UINT32(START_TIME, samples[0].time);
+    TEST_ASSERT_FLOAT_WITHIN(0.0005, 3.712, samples[0].value);
+    TEST_ASSERT_EQUAL_UINT32(START_TIME + 30, samples[1].time);
+    TEST_ASSERT_FLOAT_WITHIN(0.0005, 3.698, samples[1].value);
+    TEST_ASSERT_FLOAT_WITHIN(0.0005, 4.2, samples[2].value);
+
+    n = history.query(NODE, TelemetryHistory::TEMPERATURE, TelemetryHistory::RAW, samples, TELEMETRY_HISTORY_MAX_SAMPLES);
+    TEST_ASSERT_EQUAL(1, n);
+    TEST_ASSERT_FLOAT_WITHIN(0.005, -12.34, samples[0].value);
+
+    TEST_ASSERT_EQUAL(0, history.query(NODE + 1, TelemetryHistory::VOLTAGE, TelemetryHistory::RAW, samples, 10));
+    TEST_ASSERT_EQUAL(2, history.getNumSeries());
+}
+
+void test_recordTelemetry(void)
+{
+    TelemetryHistory history(64 * 1024);
+    meshtastic_Telemetry t = meshtastic_Telemetry_init_zero;
+    t.which_variant = meshtastic_Telemetry_device_metrics_tag;
+    t.variant.device_metrics.has_battery_level = true;
+    t.variant.device_metrics.battery_level = 87;
+    t.variant.device_metrics.has_voltage = true;
+    t.variant.device_metrics.voltage = 4.01;
+    history.record(NODE, t, START_TIME);
+
+    TEST_ASSERT_EQUAL_UINT32((1 << TelemetryHistory::BATTERY_LEVEL) | (1 << TelemetryHistory::VOLTAGE), history.metricsOf(NODE));
+    TEST_ASSERT_EQUAL(1, history.query(NODE, TelemetryHistory::BATTERY_LEVEL, TelemetryHistory::RAW, samples, 1));
+    TEST_ASSERT_EQUAL_FLOAT(87, samples[0].value);
+}
+
+/** Samples close in time and value take a few bytes each, so a tier holds many more than it would uncompressed */
+void test_deltaCompression(void)
+{
+    TelemetryHistory history(64 * 1024);
+    for (uint32_t i = 0; i < 1000; i++)
+        history.record(NODE, TelemetryHistory::VOLTAGE, START_TIME + i * 10, 3.7 + (i % 3) * 0.001);
+
+    size_t n = history.query(NODE, TelemetryHistory::VOLTAGE, TelemetryHistory::RAW, samples, TELEMETRY_HISTORY_MAX_SAMPLES);
+    size_t uncompressed = TELEMETRY_HISTORY_BLOCKS * TELEMETRY_HISTORY_BLOCK_SIZE / 8; // uint32_t time and value
+    LOG_INFO("Telemetry history: %u raw samples in %u bytes", n, TELEMETRY_HISTORY_BLOCKS * TELEMETRY_HISTORY_BLOCK_SIZE);
+    TEST_ASSERT_TRUE(n >= 3 * uncompressed);
+
+    // The newest ones are kept, in order
+    TEST_ASSERT_EQUAL_UINT32(START_TIME + 999 * 10, samples[n - 1].time);
+    for (size_t i = 1; i < n; i++)
+        TEST_ASSERT_EQUAL_UINT32(samples[i - 1].time + 10, samples[i].time);
+
+    // Asking for fewer gives the newest
+    TEST_ASSERT_EQUAL(5, history.query(NODE, TelemetryHistory::VOLTAGE, TelemetryHistory::RAW, samples, 5));
+    TEST_ASSERT_EQUAL_UINT32(START_TIME + 999 * 10, samples[4].time);
+}
+
+void test_downsampling(void)
+{
+    TelemetryHistory history(64 * 1024);
+    // Every 10 seconds for half an hour, the value is the minute
+    for (uint32_t secs = 0; secs < 30 * 60; secs += 10)
+        history.record(NODE, TelemetryHistory::TEMPERATURE, START_TIME + secs, secs / 60);
+
+    size_t n =
+        history.query(NODE, TelemetryHistory::TEMPERATURE, TelemetryHistory::ONE_MINUTE, samples, TELEMETRY_HISTORY_MAX_SAMPLES);
+    TEST_ASSERT_EQUAL(30, n); // The last minute is still in progress but included
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT_EQUAL_UINT32(START_TIME + i * 60, samples[i].time);
+        TEST_ASSERT_FLOAT_WITHIN(0.01, i, samples[i].value);
+    }
+
+    n = history.query(NODE, TelemetryHistory::TEMPERATURE, TelemetryHistory::FIFTEEN_MINUTES, samples,
+                      TELEMETRY_HISTORY_MAX_SAMPLES);
+    TEST_ASSERT_EQUAL(2, n);
+    TEST_ASSERT_EQUAL_UINT32(START_TIME, samples[0].time);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 7, samples[0].value); // Average of minutes 0..14
+    TEST_ASSERT_EQUAL_UINT32(START_TIME + 15 * 60, samples[1].time);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 21.5, samples[1].value); // Minutes 15..28 so far, the 29th is still pending below
+}
+
+void test_evictsLeastRecentlyUpdated(void)
+{
+    size_t bytesPerSeries;
+    {
+        TelemetryHistory sizing(64 * 1024);
+        bytesPerSeries = sizing.getMemoryUsage() / sizing.getMaxSeries();
+    }
+    TelemetryHistory history(2 * bytesPerSeries);
+    TEST_ASSERT_EQUAL(2, history.getMaxSeries());
+
+    history.record(1, TelemetryHistory::VOLTAGE, START_TIME, 3.7);
+    delay(2);
+    history.record(2, TelemetryHistory::VOLTAGE, START_TIME, 3.7);
+    delay(2);
+    history.record(1, TelemetryHistory::VOLTAGE, START_TIME + 60, 3.7);
+    delay(2);
+    history.record(3, TelemetryHistory::VOLTAGE, START_TIME, 3.7);
+
+    TEST_ASSERT_EQUAL_UINT32(1, history.evicted);
+    TEST_ASSERT_NOT_EQUAL(0, history.metricsOf(1));
+    TEST_ASSERT_EQUAL_UINT32(0, history.metricsOf(2));
+    TEST_ASSERT_NOT_EQUAL(0, history.metricsOf(3));
+    TEST_ASSERT_EQUAL(2, history.query(1, TelemetryHistory::VOLTAGE, TelemetryHistory::RAW, samples, 10));
+}
+
+/**
+ * 250 nodes sending device and environment telemetry every minute for a simulated day, into the history of this
+ * platform's size
+ */
+void test_250NodesReporting(void)
+{
+    TelemetryHistory history(TELEMETRY_HISTORY_BYTES);
+    meshtastic_Telemetry device = meshtastic_Telemetry_init_zero;
+    device.which_variant = meshtastic_Telemetry_device_metrics_tag;
+    meshtastic_DeviceMetrics &dm = device.variant.device_metrics;
+    dm.has_battery_level = dm.has_voltage = dm.has_channel_utilization = dm.has_air_util_tx = true;
+    meshtastic_Telemetry env = meshtastic_Telemetry_init_zero;
+    env.which_variant = meshtastic_Telemetry_environment_metrics_tag;
+    meshtastic_EnvironmentMetrics &em = env.variant.environment_metrics;
+    em.has_temperature = em.has_relative_humidity = em.has_barometric_pressure = true;
+
+    uint32_t reports = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t secs = 0; secs < SIM_HOURS * 3600; secs += REPORT_SECS) {
+        for (uint32_t i = 0; i < NUM_NODES; i++) {
+            uint32_t wobble = (secs / REPORT_SECS + i) % 7;
+            dm.battery_level = 100 - (secs / 3600) % 100;
+            dm.voltage = 3.9 + wobble * 0.002;
+            dm.channel_utilization = 10 + wobble * 0.5;
+            dm.air_util_tx = 1.5 + wobble * 0.1;
+            em.temperature = 20 + wobble * 0.1 + i % 5;
+            em.relative_humidity = 55 + wobble;
+            em.barometric_pressure = 1013.2 + wobble * 0.1;
+            history.record(FIRST_NODE + i, device, START_TIME + secs);
+            history.record(FIRST_NODE + i, env, START_TIME + secs);
+            reports += 2;
+        }
+    }
+    double elapsedUsec = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    uint32_t samplesRecorded = reports / 2 * 7;
+
+    LOG_INFO("Telemetry history: %u reports, %u samples in %.0f msec, %.3f usec per sample", reports, samplesRecorded,
+             elapsedUsec / 1000, elapsedUsec / samplesRecorded);
+    LOG_INFO("Telemetry history: %u of %u series, %u bytes (ceiling %u), %u bytes per series", history.getNumSeries(),
+             history.getMaxSeries(), history.getMemoryUsage(), TELEMETRY_HISTORY_BYTES,
+             history.getMemoryUsage() / history.getMaxSeries());
+
+    TEST_ASSERT_TRUE(history.getMemoryUsage() <= TELEMETRY_HISTORY_BYTES);
+    size_t expectedSeries = std::min<size_t>(NUM_NODES * 7, history.getMaxSeries());
+    TEST_ASSERT_EQUAL(expectedSeries, history.getNumSeries());
+
+    if (history.getMaxSeries() >= NUM_NODES * 7) {
+        TEST_ASSERT_EQUAL_UINT32(0, history.evicted);
+        // Every node has 15 minute averages up to the period in progress
+        for (uint32_t i = 0; i < NUM_NODES; i++) {
+            size_t n = history.query(FIRST_NODE + i, TelemetryHistory::TEMPERATURE, TelemetryHistory::FIFTEEN_MINUTES, samples,
+                                     TELEMETRY_HISTORY_MAX_SAMPLES);
+            TEST_ASSERT_TRUE(n > 0);
+            TEST_ASSERT_EQUAL_UINT32(START_TIME + SIM_HOURS * 3600 - 15 * 60, samples[n - 1].time);
+        }
+        size_t n = history.query(FIRST_NODE, TelemetryHistory::VOLTAGE, TelemetryHistory::FIFTEEN_MINUTES, samples,
+                                 TELEMETRY_HISTORY_MAX_SAMPLES);
+        LOG_INFO("Telemetry history: %u samples of 15 minutes (%u hours)", n, n / 4);
+    }
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    RUN_TEST(test_roundTrip);
+    RUN_TEST(test_recordTelemetry);
+    RUN_TEST(test_deltaCompression);
+    RUN_TEST(test_downsampling);
+    RUN_TEST(test_evictsLeastRecentlyUpdated);
+    RUN_TEST(test_250NodesReporting);
+    exit(UNITY_END());
+}
+
+#else
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    TEST_MESSAGE("No telemetry history on this platform");
+    exit(UNITY_END());
+}
+#endif
+
+void loop() {}
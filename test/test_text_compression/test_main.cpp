@@ -0,0 +1,87 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include "mesh-pb-constants.h"
+#include "mesh/TextCompression.h"
+#include "mesh/compression/unishox2.h"
+#include <unity.h>
+
+// Typical channel chatter, from one word acks to messages close to the payload limit
+static const char *corpus[] = {
+    "ok",
+    "Test 123",
+    "On my way, ETA 15 min",
+    "Hello from the hill, anyone copy?",
+    "Battery at 20%, switching to solar",
+    "Ich bin gleich da! Wo seid ihr?",
+    "Meet at the trailhead parking lot at 9:00 tomorrow",
+    "https://meshtastic.org/docs/overview",
+    "Signal report: SNR -7.5, RSSI -112 from the repeater on the ridge",
+    "Can you relay this to base camp? Weather is turning bad up here and we are heading down.",
+    "Node 3 is back online after the firmware update, please check if your messages arrive now.",
+    "Water station at mile 12 is out of cups. Runners are asking for more electrolytes and ice as well, can "
+    "somebody from the north aid station drive over?",
+    "\xf0\x9f\x91\x8d",
+};
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+/** Text compressed the way a client does it comes back unchanged */
+void test_decompressClientText(void)
+{
+    char compressed[256];
+    uint8_t text[meshtastic_Constants_DATA_PAYLOAD_LEN];
+    for (const char *message : corpus) {
+        int len = strlen(message);
+        int compressedLen = unishox2_compress(message, len, compressed, sizeof(compressed), USX_PSET_DFLT);
+        TEST_ASSERT_TRUE(compressedLen > 0);
+        size_t textLen = TextCompression::decompress((const uint8_t *)compressed, compressedLen, text, sizeof(text));
+        TEST_ASSERT_EQUAL_UINT32(len, textLen);
+        TEST_ASSERT_EQUAL_MEMORY(message, text, len);
+    }
+}
+
+/** Text that doesn't fit the output is refused instead of truncated */
+void test_tooLargeRefused(void)
+{
+    char compressed[256];
+    uint8_t text[16];
+    const char *message = corpus[9];
+    int compressedLen = unishox2_compress(message, strlen(message), compressed, sizeof(compressed), USX_PSET_DFLT);
+    TEST_ASSERT_EQUAL_UINT32(0, TextCompression::decompress((const uint8_t *)compressed, compressedLen, text, sizeof(text)));
+    TEST_ASSERT_EQUAL_UINT32(0, TextCompression::decompress((const uint8_t *)compressed, 0, text, sizeof(text)));
+}
+
+/** A corrupt payload must not overflow the output */
+void test_garbageInput(void)
+{
+    uint8_t garbage[meshtastic_Constants_DATA_PAYLOAD_LEN];
+    uint8_t text[32 + 1];
+    for (uint32_t round = 0; round < 1000; round++) {
+        for (size_t i = 0; i < sizeof(garbage); i++)
+            garbage[i] = random(256);
+        text[32] = 0xa5;
+        size_t textLen = TextCompression::decompress(garbage, 1 + random(sizeof(garbage)), text, 32);
+        TEST_ASSERT_TRUE(textLen <= 32);
+        TEST_ASSERT_EQUAL_UINT8(0xa5, text[32]);
+    }
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    RUN_TEST(test_decompressClientText);
+    RUN_TEST(test_tooLargeRefused);
+    RUN_TEST(test_garbageInput);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,134 @@
+#include "DebugConfiguration.h"
+#include "SerialConsole.h"
+#include "TestUtil.h"
+#include "concurrency/OSThread.h"
+#include <unity.h>
+
+#if HAS_THREAD_PROFILER
+using namespace concurrency;
+
+// millis() moves on between setting a thread up and coalescing
+#define MSEC_TOLERANCE 2
+
+/** A thread of mainController due in dueMsec, that may run up to slack msecs late */
+class TestThread : public OSThread
+{
+  public:
+    TestThread(const char *name, uint32_t dueMsec, uint32_t slack) : OSThread(name)
+    {
+        slackMsec = slack;
+        setIntervalFromNow(dueMsec);
+    }
+
+  protected:
+    virtual int32_t runOnce() override { return RUN_SAME; }
+};
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+/** A thread with enough slack waits for the next one, which gets the wakeup once the loop slept until then */
+void test_waitsForLaterThread(void)
+{
+    TestThread a("a", 100, 0);
+    TestThread b("b", 50, 80);
+    TEST_ASSERT_INT_WITHIN(MSEC_TOLERANCE, 100, OSThread::coalesceDelay(50));
+    TEST_ASSERT_EQUAL_UINT32(0, a.wakeups);
+
+    OSThread::sleptFullDelay();
+    TEST_ASSERT_EQUAL_UINT32(1, a.wakeups);
+    TEST_ASSERT_EQUAL_UINT32(0, b.wakeups);
+
+    // One sleep, one wakeup
+    OSThread::sleptFullDelay();
+    TEST_ASSERT_EQUAL_UINT32(1, a.wakeups);
+}
+
+/** Not enough slack to reach the next thread: sleep only until the end of the window */
+void test_windowEndsBeforeLaterThread(void)
+{
+    TestThread a("a", 100, 0);
+    TestThread b("b", 50, 30);
+    TEST_ASSERT_INT_WITHIN(MSEC_TOLERANCE, 80, OSThread::coalesceDelay(50));
+    OSThread::sleptFullDelay();
+    TEST_ASSERT_EQUAL_UINT32(0, a.wakeups);
+    TEST_ASSERT_EQUAL_UINT32(1, b.wakeups);
+}
+
+void test_disabledIgnored(void)
+{
+    TestThread a("a", 100, 0);
+    TestThread b("b", 50, 0);
+    b.disable();
+    TEST_ASSERT_INT_WITHIN(MSEC_TOLERANCE, 100, OSThread::coalesceDelay(50));
+    OSThread::sleptFullDelay();
+    TEST_ASSERT_EQUAL_UINT32(1, a.wakeups);
+}
+
+/** The loop doesn't sleep for a thread that is already due */
+void test_noWakeupWhenDue(void)
+{
+    TestThread a("a", 0, 0);
+    TEST_ASSERT_EQUAL_INT(0, OSThread::coalesceDelay(0));
+    OSThread::sleptFullDelay();
+    TEST_ASSERT_EQUAL_UINT32(0, a.wakeups);
+}
+
+/** What loop() does: only a sleep that wasn't cut short by an interrupt counts */
+void test_noWakeupWhenInterrupted(void)
+{
+    TestThread a("a", 5, 0);
+    mainDelay.interrupt();
+    if (mainDelay.delay(OSThread::coalesceDelay(5)))
+        OSThread::sleptFullDelay();
+    TEST_ASSERT_EQUAL_UINT32(0, a.wakeups);
+
+    a.setIntervalFromNow(5);
+    if (mainDelay.delay(OSThread::coalesceDelay(5)))
+        OSThread::sleptFullDelay();
+    TEST_ASSERT_EQUAL_UINT32(1, a.wakeups);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    // Only the threads of the tests may decide how long to sleep
+    console->disable();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_waitsForLaterThread);
+    RUN_TEST(test_windowEndsBeforeLaterThread);
+    RUN_TEST(test_disabledIgnored);
+    RUN_TEST(test_noWakeupWhenDue);
+    RUN_TEST(test_noWakeupWhenInterrupted);
+    exit(UNITY_END());
+}
+
+#else
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    TEST_MESSAGE("No thread profiler on this platform");
+    exit(UNITY_END());
+}
+#endif
+
+void loop() {}
@@ -0,0 +1,133 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include "concurrency/ThreadTrace.h"
+#include <unity.h>
+
+#if HAS_THREAD_PROFILER && defined(ARCH_PORTDUINO)
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#define TRACE_PATH "/tmp/meshtasticd_test_thread_trace.json"
+#define SMALL_MAX_BYTES 1000
+
+using concurrency::ThreadTrace;
+
+static std::string readFile(const std::string &path)
+{
+    std::ifstream f(path);
+    std::stringstream s;
+    s << f.rdbuf();
+    return s.str();
+}
+
+static uint32_t countEvents(const std::string &json)
+{
+    uint32_t n = 0;
+    for (size_t at = json.find("\"ph\":\"X\""); at != std::string::npos; at = json.find("\"ph\":\"X\"", at + 1))
+        n++;
+    return n;
+}
+
+/** A complete JSON array of events, without the trailing comma that JSON parsers reject */
+static void assertValidTrace(const std::string &json)
+{
+    TEST_ASSERT_TRUE(json.rfind("[\n", 0) == 0);
+    TEST_ASSERT_TRUE(json.size() >= 4 && json.compare(json.size() - 3, 3, "\n]\n") == 0);
+    TEST_ASSERT_EQUAL(std::string::npos, json.find(",\n]"));
+    TEST_ASSERT_EQUAL(std::string::npos, json.find("},{"));
+}
+
+void setUp(void)
+{
+    std::remove(TRACE_PATH);
+    std::remove(TRACE_PATH ".1");
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_emptyTraceIsValid(void)
+{
+    ThreadTrace trace;
+    TEST_ASSERT_TRUE(trace.open(TRACE_PATH));
+    trace.close();
+    TEST_ASSERT_EQUAL_STRING("[\n\n]\n", readFile(TRACE_PATH).c_str());
+}
+
+void test_terminatedOnClose(void)
+{
+    ThreadTrace trace;
+    TEST_ASSERT_TRUE(trace.open(TRACE_PATH));
+    trace.add("a", 1000, 10);
+    trace.add("b", 2000, 20);
+    TEST_ASSERT_TRUE(trace.isOpen());
+    trace.close();
+    TEST_ASSERT_FALSE(trace.isOpen());
+
+    std::string json = readFile(TRACE_PATH);
+    assertValidTrace(json);
+    TEST_ASSERT_EQUAL_UINT32(2, countEvents(json));
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, json.find("{\"name\":\"b\",\"ph\":\"X\",\"ts\":2000,\"dur\":20,\"pid\":1,\"tid\":1}"));
+
+    // Closing again doesn't add another terminator
+    trace.close();
+    TEST_ASSERT_EQUAL_STRING(json.c_str(), readFile(TRACE_PATH).c_str());
+}
+
+/** A long trace is rotated, the file and the one before it stay small and valid */
+void test_rotated(void)
+{
+    ThreadTrace trace;
+    TEST_ASSERT_TRUE(trace.open(TRACE_PATH, SMALL_MAX_BYTES));
+    const uint32_t numEvents = 100;
+    for (uint32_t i = 0; i < numEvents; i++)
+        trace.add("thread", i * 1000, 10);
+    trace.close();
+
+    std::string current = readFile(TRACE_PATH);
+    std::string previous = readFile(TRACE_PATH ".1");
+    assertValidTrace(current);
+    assertValidTrace(previous);
+    // One event can take a file past the limit before it is rotated
+    TEST_ASSERT_LESS_THAN(SMALL_MAX_BYTES + 100, previous.size());
+    TEST_ASSERT_LESS_THAN(SMALL_MAX_BYTES + 100, current.size());
+    TEST_ASSERT_LESS_THAN(numEvents, countEvents(current) + countEvents(previous));
+
+    // The newest event is in the current file
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, current.find("\"ts\":99000,"));
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    RUN_TEST(test_emptyTraceIsValid);
+    RUN_TEST(test_terminatedOnClose);
+    RUN_TEST(test_rotated);
+    exit(UNITY_END());
+}
+
+#else
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    TEST_MESSAGE("No thread trace on this platform");
+    exit(UNITY_END());
+}
+#endif
+
+void loop() {}
@@ -0,0 +1,182 @@
+#include "PointerQueue.h"
+#include "TypedQueue.h"
+
+#include "TestUtil.h"
+#include <atomic>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+#define NUM_PRODUCERS 4
+#define ITEMS_PER_PRODUCER 100000
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_capacity(void)
+{
+    TypedQueue<uint32_t> q(5); // Rounded up to 8
+    TEST_ASSERT_TRUE(q.isEmpty());
+    TEST_ASSERT_EQUAL_INT(8, q.numFree());
+
+    for (uint32_t i = 0; i < 8; i++)
+        TEST_ASSERT_TRUE(q.enqueue(i, 0));
+    TEST_ASSERT_FALSE(q.enqueue(8, 0));
+    TEST_ASSERT_EQUAL_INT(0, q.numFree());
+    TEST_ASSERT_EQUAL_INT(8, q.numUsed());
+
+    uint32_t v;
+    for (uint32_t i = 0; i < 8; i++) {
+        TEST_ASSERT_TRUE(q.dequeue(&v, 0));
+        TEST_ASSERT_EQUAL_UINT32(i, v);
+    }
+    TEST_ASSERT_FALSE(q.dequeue(&v, 0));
+    TEST_ASSERT_TRUE(q.isEmpty());
+}
+
+void test_wrapAround(void)
+{
+    PointerQueue<uint32_t> q(4);
+    static uint32_t values[3];
+    for (uint32_t i = 0; i < 1000; i++) {
+        for (uint32_t j = 0; j < 3; j++)
+            TEST_ASSERT_TRUE(q.enqueue(&values[j], 0));
+        for (uint32_t j = 0; j < 3; j++)
+            TEST_ASSERT_EQUAL_PTR(&values[j], q.dequeuePtr(0));
+        TEST_ASSERT_NULL(q.dequeuePtr(0));
+    }
+}
+
+/**
+ * Several producer threads against one consumer: every item must come out exactly once, and items of one producer in the
+ * order they were enqueued.
+ */
+void test_multipleProducers(void)
+{
+    TypedQueue<uint32_t> q(32);
+    std::vector<std::thread> producers;
+    for (uint32_t id = 0; id < NUM_PRODUCERS; id++) {
+        producers.emplace_back([&q, id]() {
+            for (uint32_t seq = 0; seq < ITEMS_PER_PRODUCER;) {
+                if (q.enqueue((id << 24) | seq, 0))
+                    seq++;
+                else
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    uint32_t next[NUM_PRODUCERS] = {};
+    uint32_t received = 0;
+    bool inOrder = true;
+    while (received < NUM_PRODUCERS * ITEMS_PER_PRODUCER) {
+        uint32_t v;
+        if (!q.dequeue(&v, 0)) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint32_t id = v >> 24;
+        inOrder &= id < NUM_PRODUCERS && (v & 0xffffff) == next[id];
+        if (id < NUM_PRODUCERS)
+            next[id]++;
+        received++;
+    }
+    for (auto &t : producers)
+        t.join();
+
+    TEST_ASSERT_TRUE(inOrder);
+    for (uint32_t id = 0; id < NUM_PRODUCERS; id++)
+        TEST_ASSERT_EQUAL_UINT32(ITEMS_PER_PRODUCER, next[id]);
+    TEST_ASSERT_TRUE(q.isEmpty());
+}
+
+/**
+ * Producers dropping the oldest entry when the queue is full, like Router::enqueueReceivedMessage() does, so that consumers
+ * run on several threads too. Nothing may be lost or duplicated.
+ */
+void test_dropOldestWhenFull(void)
+{
+    TypedQueue<uint32_t> q(16);
+    std::atomic<uint32_t> dropped{0};
+    std::vector<std::thread> producers;
+    for (uint32_t id = 0; id < NUM_PRODUCERS; id++) {
+        producers.emplace_back([&q, &dropped, id]() {
+            for (uint32_t seq = 0; seq < ITEMS_PER_PRODUCER; seq++) {
+                uint32_t old;
+                while (!q.enqueue((id << 24) | seq, 0)) {
+                    if (q.dequeue(&old, 0))
+                        dropped++;
+                }
+            }
+        });
+    }
+
+    uint32_t received = 0;
+    std::atomic<bool> done{false};
+    std::thread consumer([&]() {
+        uint32_t v;
+        while (!done) {
+            if (q.dequeue(&v, 0))
+                received++;
+        }
+        while (q.dequeue(&v, 0))
+            received++;
+    });
+    for (auto &t : producers)
+        t.join();
+    done = true;
+    consumer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(NUM_PRODUCERS * ITEMS_PER_PRODUCER, received + dropped);
+}
+
+class QueueReader : public concurrency::OSThread
+{
+  public:
+    QueueReader() : concurrency::OSThread("QueueReader") {}
+
+  protected:
+    int32_t runOnce() override { return disable(); }
+};
+
+/** An enqueue from another thread must cut the sleep of the main loop short */
+void test_readerWakeup(void)
+{
+    TypedQueue<uint32_t> q(4);
+    QueueReader reader;
+    q.setReader(&reader);
+    concurrency::mainDelay.delay(0); // Forget earlier wakeups
+
+    std::thread producer([&q]() {
+        delay(50);
+        q.enqueue(1, 0);
+    });
+    uint32_t start = millis();
+    bool timedOut = concurrency::mainDelay.delay(5000);
+    producer.join();
+
+    TEST_ASSERT_FALSE(timedOut);
+    TEST_ASSERT_TRUE(millis() - start < 1000);
+    TEST_ASSERT_FALSE(q.isEmpty());
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    RUN_TEST(test_capacity);
+    RUN_TEST(test_wrapAround);
+    RUN_TEST(test_multipleProducers);
+    RUN_TEST(test_dropOldestWhenFull);
+    RUN_TEST(test_readerWakeup);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,156 @@
+#include "DebugConfiguration.h"
+#include "SPILock.h"
+#include "TestUtil.h"
+#include "mesh/NodeDB.h"
+#include "mesh/Router.h"
+#include "mesh/udp/UdpMulticastHandler.h"
+#include <unity.h>
+
+#include <functional>
+#include <list>
+
+#define BATCH_DELAY_MSEC 50
+#define BATCH_PACKETS 5
+#define SETTLE_MSEC 200
+
+// Captures what the UDP handlers pass on, instead of decrypting and handling it
+class MockRouter : public Router
+{
+  public:
+    void enqueueReceivedMessage(meshtastic_MeshPacket *p) override
+    {
+        packets.emplace_back(*p);
+        packetPool.release(p);
+    }
+
+    /// As if the packet came in over LoRa first
+    void receivedOverLoRa(const meshtastic_MeshPacket *p) { wasSeenRecently(p); }
+
+    std::list<meshtastic_MeshPacket> packets;
+};
+
+static MockRouter *mockRouter;
+
+// Two bridging nodes on the same host and multicast group
+static UdpMulticastHandler *nodeA, *nodeB;
+
+void setUp(void)
+{
+    mockRouter->packets.clear();
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+// Keep running the loop until either conditionMet returns true or timeoutMsec elapse.
+static bool loopUntil(std::function<bool()> conditionMet, uint32_t timeoutMsec)
+{
+    uint32_t start = millis();
+    while (millis() - start < timeoutMsec) {
+        long delayMsec = concurrency::mainController.runOrDelay();
+        if (conditionMet())
+            return true;
+        concurrency::mainDelay.delay(std::min(delayMsec, 5L));
+    }
+    return conditionMet();
+}
+
+static void makePacket(meshtastic_MeshPacket &p)
+{
+    static PacketId nextId = 1;
+    memset(&p, 0, sizeof(p));
+    p.from = 0x11223344;
+    p.to = NODENUM_BROADCAST;
+    p.id = nextId++;
+    p.hop_limit = 3;
+    p.which_payload_variant = meshtastic_MeshPacket_encrypted_tag;
+    p.encrypted.size = 16;
+    memset(p.encrypted.bytes, 0x5a, p.encrypted.size);
+}
+
+/** What one node sends reaches the other once, its own copy coming back over loopback is dropped */
+void test_forwardsToOtherNode(void)
+{
+    uint32_t bReceived = nodeB->rxPackets;
+    meshtastic_MeshPacket p;
+    makePacket(p);
+    TEST_ASSERT_TRUE(nodeA->onSend(&p));
+
+    TEST_ASSERT_TRUE(loopUntil([]() { return !mockRouter->packets.empty(); }, 2000));
+    loopUntil([]() { return false; }, SETTLE_MSEC);
+    TEST_ASSERT_EQUAL(1, mockRouter->packets.size());
+    TEST_ASSERT_EQUAL_UINT32(p.id, mockRouter->packets.front().id);
+    TEST_ASSERT_EQUAL_UINT32(bReceived + 1, nodeB->rxPackets);
+}
+
+/** A packet LoRa brought in first is dropped before the router sees it again */
+void test_dropsCopiesOfLoRaPackets(void)
+{
+    uint32_t bDupe = nodeB->rxDupe;
+    meshtastic_MeshPacket p;
+    makePacket(p);
+    mockRouter->receivedOverLoRa(&p);
+    TEST_ASSERT_TRUE(nodeA->onSend(&p));
+
+    TEST_ASSERT_TRUE(loopUntil([bDupe]() { return nodeB->rxDupe != bDupe; }, 2000));
+    TEST_ASSERT_TRUE(mockRouter->packets.empty());
+}
+
+/** The same packet bridged twice (by two LAN nodes) is only passed on once */
+void test_dropsCopiesFromSeveralNodes(void)
+{
+    uint32_t bDupe = nodeB->rxDupe;
+    meshtastic_MeshPacket p;
+    makePacket(p);
+    TEST_ASSERT_TRUE(nodeA->onSend(&p));
+    TEST_ASSERT_TRUE(nodeA->onSend(&p));
+
+    TEST_ASSERT_TRUE(loopUntil([bDupe]() { return nodeB->rxDupe != bDupe; }, 2000));
+    loopUntil([]() { return false; }, SETTLE_MSEC);
+    TEST_ASSERT_EQUAL(1, mockRouter->packets.size());
+}
+
+void test_batching(void)
+{
+    uint32_t aDatagrams = nodeA->txDatagrams;
+    uint32_t bDatagrams = nodeB->rxDatagrams;
+    nodeA->setBatchDelay(BATCH_DELAY_MSEC);
+
+    meshtastic_MeshPacket p;
+    for (int i = 0; i < BATCH_PACKETS; i++) {
+        makePacket(p);
+        TEST_ASSERT_TRUE(nodeA->onSend(&p));
+    }
+    TEST_ASSERT_EQUAL_UINT32(aDatagrams, nodeA->txDatagrams); // Nothing sent before the delay is up
+
+    TEST_ASSERT_TRUE(loopUntil([]() { return mockRouter->packets.size() == BATCH_PACKETS; }, 2000));
+    TEST_ASSERT_EQUAL_UINT32(aDatagrams + 1, nodeA->txDatagrams);
+    TEST_ASSERT_EQUAL_UINT32(bDatagrams + 1, nodeB->rxDatagrams);
+    TEST_ASSERT_EQUAL_UINT32(p.id, mockRouter->packets.back().id);
+
+    nodeA->setBatchDelay(0);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    initSPI();
+    nodeDB = new NodeDB();
+    router = mockRouter = new MockRouter();
+    nodeA = new UdpMulticastHandler();
+    nodeB = new UdpMulticastHandler();
+    UNITY_BEGIN();
+    if (!nodeA->start() || !nodeB->start()) {
+        TEST_MESSAGE("No UDP multicast on this host");
+        exit(UNITY_END());
+    }
+    RUN_TEST(test_forwardsToOtherNode);
+    RUN_TEST(test_dropsCopiesOfLoRaPackets);
+    RUN_TEST(test_dropsCopiesFromSeveralNodes);
+    RUN_TEST(test_batching);
+    exit(UNITY_END());
+}
+
+void loop() {}